@@ -0,0 +1,108 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Bulk mode scaling benchmark. Evaluates short expressions, whose evaluation stacks are 
+// only a few values deep, in bulk mode with an increasing number of OpenMP threads and 
+// reports the rows evaluated per second together with the speedup over one thread. 
+// Each expression is measured with the stacks padded to whole cache lines and with the 
+// stacks packed back to back (ParserBase::EnableStackPadding(false)). Short stacks of 
+// neighbouring threads sharing a cache line show up as poorer scaling of the packed layout.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#ifdef MUP_USE_OPENMP
+	#include <omp.h>
+#endif
+
+#include "muParser.h"
+
+using namespace mu;
+
+int main(int, char**)
+{
+	const int nRows = 4096;
+	const int nRounds = 2000;
+	const char_type* szExpr[] = { _T("a*b+c"), _T("a<b ? a*c : b*c"), _T("sin(a)*b + c^2") };
+
+	std::vector<value_type> vA(nRows), vB(nRows), vC(nRows), vRes(nRows);
+	for (int i = 0; i < nRows; ++i)
+	{
+		vA[i] = (value_type)i / nRows;
+		vB[i] = 1 - vA[i];
+		vC[i] = (value_type)(i % 7);
+	}
+
+	Parser p;
+	p.DefineVar(_T("a"), &vA[0]);
+	p.DefineVar(_T("b"), &vB[0]);
+	p.DefineVar(_T("c"), &vC[0]);
+
+#ifdef MUP_USE_OPENMP
+	const int nMaxThreads = std::min(omp_get_max_threads(), 16);
+#else
+	const int nMaxThreads = 1;
+#endif
+
+	for (const char_type* szFormula : szExpr)
+	{
+		p.SetExpr(szFormula);
+		mu::console() << szFormula << _T("\n");
+
+		for (bool bPadding : { true, false })
+		{
+			p.EnableStackPadding(bPadding);
+			mu::console() << (bPadding ? _T(" padded stacks\n") : _T(" packed stacks\n"));
+
+			double fRowsPerSec1 = 0;
+			for (int nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2)
+			{
+#ifdef MUP_USE_OPENMP
+				omp_set_num_threads(nThreads);
+#endif
+				p.Eval(&vRes[0], nRows);
+
+				auto t0 = std::chrono::steady_clock::now();
+				for (int k = 0; k < nRounds; ++k)
+					p.Eval(&vRes[0], nRows);
+
+				auto t1 = std::chrono::steady_clock::now();
+				double fRowsPerSec = (double)nRows * nRounds / std::chrono::duration<double>(t1 - t0).count();
+				if (nThreads == 1)
+					fRowsPerSec1 = fRowsPerSec;
+
+				mu::console() << _T("  ") << nThreads << _T(" threads: ") << fRowsPerSec << _T(" rows/s, speedup ")
+					<< fRowsPerSec / fRowsPerSec1 << _T(" (checksum ") << vRes[nRows / 2] << _T(")\n");
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Compile throughput benchmark. Compiles a set of generated formulas mixing variables, 
+// numeric literals, functions, the ternary operator and comma separated results, and 
+// reports the number of formulas compiled per second. The same formulas are then compiled
+// with ParserBase::CompileBatch, written into a bundle of precompiled expressions and loaded 
+// from it for comparison.
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "muParser.h"
+#include "muParserBundle.h"
+
+using namespace mu;
+
+static string_type CreateFormula(unsigned& nSeed)
+{
+	const char_type* szTerm[] = {
+		_T("a*sin(b)"), _T("(a+b)^2"), _T("sqrt(c)*1.5"), _T("min(a, b, c)"), _T("a>b ? c : 2.25e-3"),
+		_T("cos(a*3.14159)"), _T("-b/7"), _T("sum(a, 2, c)"), _T("exp(-c)"), _T("abs(a-b)*0.001") };
+
+	stringstream_type ss;
+	int nTerms = 4 + (int)(nSeed % 12);
+	for (int i = 0; i < nTerms; ++i)
+	{
+		nSeed = nSeed * 1103515245 + 12345;
+		if (i)
+			ss << ((nSeed & 0x100) ? _T(" + ") : _T(" * "));
+
+		ss << szTerm[(nSeed >> 16) % 10];
+	}
+
+	if (nSeed & 0x200)
+		ss << _T(", a*b");
+
+	return ss.str();
+}
+
+int main(int, char**)
+{
+	const int nFormulas = 10000;
+	const int nRounds = 5;
+
+	std::vector<string_type> vFormula;
+	unsigned nSeed = 42;
+	for (int i = 0; i < nFormulas; ++i)
+		vFormula.push_back(CreateFormula(nSeed));
+
+	value_type a = 1, b = 2, c = 3;
+	Parser p;
+	p.DefineVar(_T("a"), &a);
+	p.DefineVar(_T("b"), &b);
+	p.DefineVar(_T("c"), &c);
+
+	value_type fSum = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < nRounds; ++k)
+	{
+		for (const auto& sFormula : vFormula)
+		{
+			p.SetExpr(sFormula);
+			fSum += p.Eval();
+		}
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+	double fSec = std::chrono::duration<double>(t1 - t0).count();
+
+	mu::console() << _T("compiled ") << nFormulas * nRounds << _T(" formulas in ") << fSec << _T(" s: ")
+		<< (nFormulas * nRounds) / fSec << _T(" formulas/s (checksum ") << fSum << _T(")\n");
+
+	t0 = std::chrono::steady_clock::now();
+	std::size_t nCompiled = 0;
+	for (int k = 0; k < nRounds; ++k)
+	{
+		for (const auto& res : p.CompileBatch(vFormula))
+			nCompiled += res.bOk;
+	}
+
+	t1 = std::chrono::steady_clock::now();
+	fSec = std::chrono::duration<double>(t1 - t0).count();
+
+	mu::console() << _T("batch    ") << nCompiled << _T(" formulas in ") << fSec << _T(" s: ")
+		<< nCompiled / fSec << _T(" formulas/s\n");
+
+	const char* szFile = "bench_compile.bundle";
+	ParserBundleWriter writer;
+	for (int i = 0; i < nFormulas; ++i)
+	{
+		stringstream_type ss;
+		ss << _T("f") << i;
+		p.SetExpr(vFormula[i]);
+		writer.Add(ss.str(), p);
+	}
+	writer.Write(szFile);
+
+	fSum = 0;
+	t0 = std::chrono::steady_clock::now();
+	ParserBundle bundle(szFile);
+	for (int k = 0; k < nRounds; ++k)
+	{
+		for (int i = 0; i < bundle.GetSize(); ++i)
+		{
+			bundle.Load(i, p);
+			fSum += p.Eval();
+		}
+	}
+
+	t1 = std::chrono::steady_clock::now();
+	fSec = std::chrono::duration<double>(t1 - t0).count();
+	bundle.Close();
+	std::remove(szFile);
+
+	mu::console() << _T("loaded   ") << nFormulas * nRounds << _T(" formulas in ") << fSec << _T(" s: ")
+		<< (nFormulas * nRounds) / fSec << _T(" formulas/s (checksum ") << fSum << _T(")\n");
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Single precision benchmark. Evaluates expressions over columns of a few million rows, 
+// once in bulk mode of the parser (double) and once with ParserFloatEngine (float), and 
+// reports the rows evaluated per second of both.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "muParser.h"
+#include "muParserFloatEngine.h"
+
+using namespace mu;
+
+namespace
+{
+	template<typename TEval>
+	double RowsPerSec(int a_nRows, int a_nRounds, TEval a_Eval)
+	{
+		a_Eval();
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (int k = 0; k < a_nRounds; ++k)
+			a_Eval();
+
+		auto t1 = std::chrono::steady_clock::now();
+		return (double)a_nRows * a_nRounds / std::chrono::duration<double>(t1 - t0).count();
+	}
+}
+
+int main(int, char**)
+{
+	const int nRows = 1 << 22;
+	const int nRounds = 10;
+	const char_type* szExpr[] = { _T("a*b+c"), _T("a<b ? a*c : b*c"), _T("(a-b)*(a+b)/(c+1) - a*a*0.5"), _T("sin(a)*b + c^2") };
+
+	std::vector<value_type> vA(nRows), vB(nRows), vC(nRows), vRes(nRows);
+	std::vector<float> vfA(nRows), vfB(nRows), vfC(nRows), vfRes(nRows);
+	for (int i = 0; i < nRows; ++i)
+	{
+		vfA[i] = (float)i / nRows;
+		vfB[i] = 1 - vfA[i];
+		vfC[i] = (float)(i % 7);
+		vA[i] = vfA[i];
+		vB[i] = vfB[i];
+		vC[i] = vfC[i];
+	}
+
+	Parser p;
+	p.DefineVar(_T("a"), &vA[0]);
+	p.DefineVar(_T("b"), &vB[0]);
+	p.DefineVar(_T("c"), &vC[0]);
+
+	ParserFloatEngine fe;
+	fe.DefineVar(_T("a"), &vfA[0]);
+	fe.DefineVar(_T("b"), &vfB[0]);
+	fe.DefineVar(_T("c"), &vfC[0]);
+
+	for (const char_type* szFormula : szExpr)
+	{
+		p.SetExpr(szFormula);
+		fe.Compile(p);
+
+		double fDouble = RowsPerSec(nRows, nRounds, [&]() { p.Eval(&vRes[0], nRows); });
+		double fFloat = RowsPerSec(nRows, nRounds, [&]() { fe.Eval(&vfRes[0], nRows); });
+
+		mu::console() << szFormula << _T("\n")
+			<< _T("  double: ") << fDouble << _T(" rows/s (checksum ") << vRes[nRows / 2] << _T(")\n")
+			<< _T("  float:  ") << fFloat << _T(" rows/s (checksum ") << vfRes[nRows / 2] << _T("), speedup ")
+			<< fFloat / fDouble << _T("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Compile time benchmark for large symbol tables. Defines N variables and N constants,
+// then measures how long it takes to compile an expression referencing 64 of them with 
+// and without the symbol index of the token reader.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "muParser.h"
+
+using namespace mu;
+
+static double MeasureCompile(Parser& p, const string_type& sExpr, int nRuns)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < nRuns; ++i)
+	{
+		p.SetExpr(sExpr);
+		p.Eval();
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(t1 - t0).count() / nRuns;
+}
+
+int main(int, char**)
+{
+	const int nRuns = 2000;
+
+	mu::console() << _T("symbols    map [us]   index [us]\n");
+	for (int nSym = 10; nSym <= 100000; nSym *= 10)
+	{
+		std::vector<value_type> vVar(nSym, 1);
+
+		Parser p;
+		for (int i = 0; i < nSym; ++i)
+		{
+			stringstream_type ss;
+			ss << _T("var_") << i;
+			p.DefineVar(ss.str(), &vVar[i]);
+			p.DefineConst(_T("const_") + ss.str(), i);
+		}
+
+		stringstream_type ss;
+		for (int i = 0; i < 64; ++i)
+		{
+			int iSym = (int)(((long long)i * 7919) % nSym);
+			ss << ((i == 0) ? _T("") : _T(" + ")) << ((i % 2) ? _T("var_") : _T("const_var_")) << iSym;
+		}
+
+		double fMap = MeasureCompile(p, ss.str(), nRuns);
+		p.EnableSymbolIndex();
+		double fIndex = MeasureCompile(p, ss.str(), nRuns);
+
+		mu::console() << nSym << _T("\t") << fMap << _T("\t") << fIndex << _T("\n");
+	}
+
+	return 0;
+}
@@ -64,6 +64,14 @@ namespace mu
 	protected:
 
 		static int IsVal(const char_type* a_szExpr, int* a_iPos, value_type* a_fVal);
+
+	private:
+
+		/** \brief Selects the constructor defining the built in symbols. */
+		struct SBuiltInTag {};
+
+		explicit Parser(SBuiltInTag);
+		static const Parser& GetBuiltIns();
 	};
 } // namespace mu
 
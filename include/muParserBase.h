@@ -30,11 +30,15 @@
 #define MU_PARSER_BASE_H
 
 //--- Standard includes ------------------------------------------------------------------------
+#include <atomic>
 #include <cmath>
 #include <string>
 #include <iostream>
 #include <map>
+#include <list>
 #include <memory>
+#include <functional>
+#include <future>
 #include <locale>
 #include <limits.h>
 
@@ -43,6 +47,8 @@
 #include "muParserTokenReader.h"
 #include "muParserBytecode.h"
 #include "muParserError.h"
+#include "muParserMemory.h"
+#include "muParserStringPool.h"
 
 #if defined(_MSC_VER)
 	#pragma warning(push)
@@ -64,10 +70,19 @@ namespace mu
 		resulting in a significant performance increase.
 		Complementary to a set of internally implemented functions the parser is able to handle
 		user defined functions and variables.
+
+		Allocation free evaluation: once the expression is compiled, Eval(), Eval(int&) and the 
+		bulk mode overloads of Eval do not allocate heap memory. An expression is compiled by 
+		the first evaluation or explicitly by Compile(), so latency critical code should call 
+		Compile() after SetExpr and after changing definitions the expression uses. Exceptions 
+		are the NUMA bulk mode, which allocates a node local stack per thread and evaluation, 
+		errors reported by the parser or by callbacks, and allocations of user callbacks.
 	*/
 	class API_EXPORT_CXX ParserBase
 	{
 		friend class ParserTokenReader;
+		friend class ParserProgram;
+		friend class ParserFloatEngine;
 
 	private:
 
@@ -80,10 +95,29 @@ namespace mu
 		typedef value_type(ParserBase::* ParseFunction)() const;
 
 		/** \brief Type used for storing an array of values. */
-		typedef std::vector<value_type> valbuf_type;
+		typedef std::vector<value_type, ParserAllocator<value_type>> valbuf_type;
 
 		/** \brief Type for a vector of strings. */
-		typedef std::vector<string_type> stringbuf_type;
+		typedef std::vector<string_type, ParserAllocator<string_type>> stringbuf_type;
+
+		/** \brief Type for mapping variable names to their bulk mode stride in bytes. */
+		typedef std::map<string_type, std::ptrdiff_t> varstride_type;
+
+		/** \brief A compiled expression kept in the expression cache. */
+		struct SExprCacheEntry
+		{
+			string_type sExpr;          ///< The expression string as passed to SetExpr
+			unsigned nCompileVersion;   ///< Version of the global parser settings the bytecode was compiled against
+			unsigned nLocaleVersion;    ///< Version of the process wide locale the expression was tokenized with
+			ParserByteCode vRPN;
+			ParserStringPool vStringBuf;
+			stringbuf_type vUsedNames;  ///< Names of the symbols the bytecode depends on
+			int nFinalResultIdx;
+			std::size_t nBytes;         ///< Approximate size of the entry
+		};
+
+		/** \brief Type of the expression cache, the most recently used entry is at the front. */
+		typedef std::list<SExprCacheEntry> exprcache_type;
 
 		/** \brief Typedef for the token reader. */
 		typedef ParserTokenReader token_reader_type;
@@ -91,9 +125,26 @@ namespace mu
 		/** \brief Type used for parser tokens. */
 		typedef ParserToken<value_type, string_type> token_type;
 
+		/** \brief Type of the buffer holding the tokens read by the compiler. */
+		typedef std::vector<token_type, ParserAllocator<token_type>> tokenbuf_type;
+
+		/** \brief Type of the operator and value stacks of the compiler. 
+		
+			The stacks hold indices into the token buffer of the compiler instead of copies of the tokens,
+			a value computed by the bytecode is represented by -1. Vector based so that the memory of the 
+			stacks is reused by the next compilation.
+		*/
+		typedef std::stack<int, std::vector<int, ParserAllocator<int>>> tokenstack_type;
+
+		/** \brief Type of the argument count stack of the compiler. */
+		typedef std::stack<int, std::vector<int, ParserAllocator<int>>> argstack_type;
+
 		/** \brief Maximum number of threads spawned by OpenMP when using the bulk mode. */
 		static const int s_MaxNumOpenMPThreads;
 
+		/** \brief Assumed size of a cache line in bytes, the evaluation stacks of different threads never share one. */
+		static const int s_CacheLineSize;
+
 	public:
 
 		/** \brief Type of the error class.
@@ -102,6 +153,55 @@ namespace mu
 		*/
 		typedef ParserError exception_type;
 
+		/** \brief Usage statistics of the compiled expression cache.
+			\sa EnableExprCache, GetExprCacheStats
+		*/
+		struct SExprCacheStats
+		{
+			std::size_t nHits;      ///< Number of SetExpr calls served from the cache
+			std::size_t nMisses;    ///< Number of SetExpr calls that required a compilation
+			std::size_t nEvictions; ///< Number of entries dropped to honour the cache limits
+			std::size_t nEntries;   ///< Number of entries currently held
+			std::size_t nBytes;     ///< Approximate memory held by the entries
+		};
+
+		/** \brief Memory held by a parser in bytes, broken down into its components.
+
+			The values are estimates, the bookkeeping data of the standard containers is 
+			approximated. Symbol tables and bytecode shared with other parsers (see Clone)
+			are reported separately and are not part of nTotal.
+			\sa GetMemoryUsage
+		*/
+		struct SMemoryUsage
+		{
+			std::size_t nSymbols;       ///< Functions, operators, constants and variables owned by this parser
+			std::size_t nSharedSymbols; ///< Symbol tables shared with other parsers
+			std::size_t nTokenReader;   ///< The token reader including its symbol indices and recorded tokens
+			std::size_t nCompiler;      ///< Token buffer and stacks of the compiler, kept between compilations
+			std::size_t nStrings;       ///< String arguments, string variables and the names the bytecode depends on
+			std::size_t nByteCode;      ///< Bytecode owned by this parser
+			std::size_t nSharedByteCode; ///< Bytecode and its string arguments shared with other parsers
+			std::size_t nStack;         ///< The evaluation stack
+			std::size_t nExprCache;     ///< The compiled expression cache
+			std::size_t nTotal;         ///< The parser object and all components it owns
+		};
+
+		/** \brief Result of compiling a single expression of a batch.
+			\sa CompileBatch
+		*/
+		struct SBatchResult
+		{
+			SBatchResult()
+				: bOk(false)
+				, sByteCode()
+				, Error()
+			{}
+
+			bool bOk;              ///< true if the expression was compiled
+			std::string sByteCode; ///< The compiled expression as a record of SaveByteCode, see LoadByteCode
+			ParserError Error;     ///< The error of a failed compilation
+		};
+
 		static void EnableDebugDump(bool bDumpCmd, bool bDumpStack);
 
 		ParserBase();
@@ -113,21 +213,46 @@ namespace mu
 		value_type Eval() const;
 		value_type* Eval(int& nStackSize) const;
 		void Eval(value_type* results, int nBulkSize);
+		void Eval(value_type* results, int nBulkSize, int nResultStride);
+		void EvalColumns(value_type* const* results, int nBulkSize);
+		std::future<void> EvalAsync(const varmap_type& a_vInput, value_type* results, int nBulkSize);
+
+		void EnableNumaBulk(bool a_bIsOn = true);
+		void EnableStackPadding(bool a_bIsOn = true);
+		static value_type* AllocBulkBuffer(int nSize);
+		static void FreeBulkBuffer(value_type* a_pBuf);
 
 		int GetNumResults() const;
 
+		void EnableExprCache(std::size_t a_nMaxEntries, std::size_t a_nMaxBytes = 0);
+		void ClearExprCache();
+		SExprCacheStats GetExprCacheStats() const;
+		SMemoryUsage GetMemoryUsage() const;
+
+		std::vector<SBatchResult> CompileBatch(const std::vector<string_type>& a_vExpr) const;
+		std::unique_ptr<ParserBase> Clone() const;
+		void SaveByteCode(std::ostream& a_Stream) const;
+		void LoadByteCode(std::istream& a_Stream);
+		void LoadByteCode(const char* a_pData, std::size_t a_nSize);
+
 		void SetExpr(const string_type& a_sExpr);
+		void Compile() const;
+		void ReplaceRange(std::size_t a_iPos, std::size_t a_iLen, const string_type& a_sText);
 		void SetVarFactory(facfun_type a_pFactory, void* pUserData = nullptr);
 
 		void SetDecSep(char_type cDecSep);
 		void SetThousandsSep(char_type cThousandsSep = 0);
 		void ResetLocale();
 
+		void SetMemoryResource(ParserMemoryResource* a_pResource);
+		ParserMemoryResource* GetMemoryResource() const;
+
 		void EnableOptimizer(bool a_bIsOn = true);
 		void EnableBuiltInOprt(bool a_bIsOn = true);
+		void EnableSymbolIndex(bool a_bIsOn = true);
 
 		bool HasBuiltInOprt() const;
-		void AddValIdent(identfun_type a_pCallback);
+		void AddValIdent(identfun_type a_pCallback, const char_type* a_szFirstChars = nullptr);
 
 		/** \fn void mu::ParserBase::DefineFun(const string_type &a_strName, fun_type0 a_pFun, bool a_bAllowOpt = true)
 			\brief Define a parser function without arguments.
@@ -170,6 +295,8 @@ namespace mu
 		void ClearOprt();
 
 		void RemoveVar(const string_type& a_strVarName);
+		void SetVarStride(const string_type& a_sName, int a_iStride);
+		void SetVarBroadcast(const string_type& a_sName, bool a_bBroadcast = true);
 		const varmap_type& GetUsedVar() const;
 		const varmap_type& GetVar() const;
 		const valmap_type& GetConst() const;
@@ -202,8 +329,11 @@ namespace mu
 
 		virtual void OnDetectVar(string_type* pExpr, int& nStart, int& nEnd);
 
+		static int ScanValue(const char_type* a_szExpr, value_type* a_fVal);
+
 		static const char_type* c_DefaultOprt[];
 		static std::locale s_locale;  ///< The locale used by the parser
+		static std::atomic<unsigned> s_nLocaleVersion; ///< Incremented whenever s_locale changes, it is shared by all parsers
 		static bool g_DbgDumpCmdCode;
 		static bool g_DbgDumpStack;
 
@@ -251,53 +381,75 @@ namespace mu
 
 	private:
 
+		class ByteCodeSymbols;
+		class BatchWorker;
+		class ParserClone;
+
 		void Assign(const ParserBase& a_Parser);
+		void SaveByteCode(std::ostream& a_Stream, const ByteCodeSymbols& a_Symbols) const;
 		void InitTokenReader();
 		void ReInit() const;
-
-		void AddCallback(const string_type& a_strName, const ParserCallback& a_Callback, funmap_type& a_Storage, const char_type* a_szCharSet);
-		void ApplyRemainingOprt(std::stack<token_type>& a_stOpt, std::stack<token_type>& a_stVal) const;
-		void ApplyBinOprt(std::stack<token_type>& a_stOpt, std::stack<token_type>& a_stVal) const;
-		void ApplyIfElse(std::stack<token_type>& a_stOpt, std::stack<token_type>& a_stVal) const;
-		void ApplyFunc(std::stack<token_type>& a_stOpt, std::stack<token_type>& a_stVal, int iArgCount) const;
-
-		token_type ApplyStrFunc(const token_type& a_FunTok, const std::vector<token_type>& a_vArg) const;
-
+		std::shared_ptr<ParserByteCode> NewByteCode() const;
+		void ReserveStacks(int a_nThreads) const;
+		value_type* GetStack(int a_iThread) const;
+		void BumpSymbolVersion();
+		void InvalidateSymbols(const std::function<bool(const string_type&)>& a_IsChanged);
+		void InvalidateSymbol(const string_type& a_sName);
+
+		bool FetchFromExprCache(const string_type& a_sExpr);
+		void AddToExprCache() const;
+		void TrimExprCache(std::size_t a_nNewEntries, std::size_t a_nNewBytes) const;
+
+		void AddCallback(const string_type& a_strName, const ParserCallback& a_Callback, funtable_type& a_Storage, const char_type* a_szCharSet);
+		void ApplyRemainingOprt(tokenstack_type& a_stOpt, tokenstack_type& a_stVal) const;
+		void ApplyBinOprt(tokenstack_type& a_stOpt, tokenstack_type& a_stVal) const;
+		void ApplyIfElse(tokenstack_type& a_stOpt, tokenstack_type& a_stVal) const;
+		void ApplyFunc(tokenstack_type& a_stOpt, tokenstack_type& a_stVal, int iArgCount) const;
+
+		void ApplyStrFunc(const token_type& a_FunTok, int a_iStrArg, bool a_bStrInNumArgs) const;
+
+		int GetValType(int a_iTok) const;
 		int GetOprtPrecedence(const token_type& a_Tok) const;
 		EOprtAssociativity GetOprtAssociativity(const token_type& a_Tok) const;
 
 		void CreateRPN() const;
+		std::ptrdiff_t GetVarStride(const string_type& a_sName) const;
 
 		value_type ParseString() const;
 		value_type ParseCmdCode() const;
 		value_type ParseCmdCodeShort() const;
-		value_type ParseCmdCodeBulk(int nOffset, int nThreadID) const;
+		value_type ParseCmdCodeBulk(const SToken* a_pRPN, int nOffset, int nThreadID, value_type* stack) const;
 
+		void  CheckLocale() const;
 		void  CheckName(const string_type& a_strName, const string_type& a_CharSet) const;
 		void  CheckOprt(const string_type& a_sName, const ParserCallback& a_Callback, const string_type& a_szCharSet) const;
 
-		void StackDump(const std::stack<token_type >& a_stVal, const std::stack<token_type >& a_stOprt) const;
+		void StackDump(const tokenstack_type& a_stVal, const tokenstack_type& a_stOprt) const;
 
 		/** \brief Pointer to the parser function.
 
 		  Eval() calls the function whose address is stored there.
 		*/
 		mutable ParseFunction  m_pParseFormula;
-		mutable ParserByteCode m_vRPN;        ///< The Bytecode class.
-		mutable stringbuf_type  m_vStringBuf; ///< String buffer, used for storing string function arguments
-		stringbuf_type  m_vStringVarBuf;
+		ParserMemoryResource* m_pMemory; ///< Memory resource of the bytecode and the buffers used for compiling
+		mutable std::shared_ptr<ParserByteCode> m_pRPN; ///< The bytecode, shared with the clones of the parser until one of them compiles again
+		mutable std::shared_ptr<ParserStringPool> m_pStringBuf; ///< Interned string arguments of the string functions, shared with the clones like the bytecode
+		std::shared_ptr<stringbuf_type> m_pStringVarBuf;       ///< Values of the string constants, shared with copies and clones until one of them defines a string constant
 
 		std::unique_ptr<token_reader_type> m_pTokenReader; ///< Managed pointer to the token reader object.
 
-		funmap_type  m_FunDef;         ///< Map of function names and pointers.
-		funmap_type  m_PostOprtDef;    ///< Postfix operator callbacks
-		funmap_type  m_InfixOprtDef;   ///< unary infix operator.
-		funmap_type  m_OprtDef;        ///< Binary operator callbacks
-		valmap_type  m_ConstDef;       ///< user constants.
-		strmap_type  m_StrVarDef;      ///< user defined string constants
-		varmap_type  m_VarDef;         ///< user defind variables.
+		funtable_type  m_FunDef;       ///< Map of function names and pointers.
+		funtable_type  m_PostOprtDef;  ///< Postfix operator callbacks
+		funtable_type  m_InfixOprtDef; ///< unary infix operator.
+		funtable_type  m_OprtDef;      ///< Binary operator callbacks
+		valtable_type  m_ConstDef;     ///< user constants.
+		strtable_type  m_StrVarDef;    ///< user defined string constants
+		vartable_type  m_VarDef;       ///< user defind variables.
+		varstride_type m_VarStride;    ///< Bulk mode strides of variables not stored as dense arrays
 
 		bool m_bBuiltInOp;             ///< Flag that can be used for switching built in operators on and off
+		bool m_bNumaBulk;              ///< Flag indicating that bulk mode binds threads to NUMA nodes
+		bool m_bStackPadding;          ///< Flag indicating that the bulk mode stacks are padded to whole cache lines
 
 		string_type m_sNameChars;      ///< Charset for names
 		string_type m_sOprtChars;      ///< Charset for postfix/ binary operator tokens
@@ -305,7 +457,25 @@ namespace mu
 
 		// items merely used for caching state information
 		mutable valbuf_type m_vStackBuffer; ///< This is merely a buffer used for the stack in the cmd parsing routine
+		mutable std::size_t m_nStackOffset; ///< Index of the first element of m_vStackBuffer starting a cache line
+		mutable std::size_t m_nStackStride; ///< Distance between the stacks of two threads, a multiple of the cache line size
+		mutable int m_nStackThreads;        ///< Number of threads m_vStackBuffer holds stacks for
 		mutable int m_nFinalResultIdx;
+		mutable tokenbuf_type m_vCompileTok;      ///< Tokens of the expression, only valid during compilation
+		mutable tokenstack_type m_stCompileOpt;   ///< Operator stack of the compiler
+		mutable tokenstack_type m_stCompileVal;   ///< Value stack of the compiler
+		mutable argstack_type m_stCompileArgCount; ///< Argument count stack of the compiler
+
+		mutable stringbuf_type m_vUsedNames;      ///< Sorted names of the symbols the current bytecode depends on, without duplicates
+		mutable bool m_bUsedNamesKnown;           ///< false if the dependencies of the current bytecode are unknown
+
+		unsigned m_nSymbolVersion;     ///< Incremented whenever a parser definition changes
+		unsigned m_nCompileVersion;    ///< Incremented whenever a change invalidates all compiled bytecode
+		std::size_t m_nExprCacheMaxEntries; ///< Maximum number of cached expressions, 0 disables the cache
+		std::size_t m_nExprCacheMaxBytes;   ///< Maximum memory held by the cache, 0 means unlimited
+		mutable exprcache_type m_ExprCache;
+		mutable std::map<string_type, exprcache_type::iterator> m_ExprCacheIdx;
+		mutable SExprCacheStats m_ExprCacheStats;
 	};
 
 } // namespace mu
@@ -0,0 +1,133 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_BUNDLE_H
+#define MU_PARSER_BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "muParserDef.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the precompiled expression bundle.
+*/
+
+namespace mu
+{
+	// Forward declaration
+	class ParserBase;
+
+	/** \brief Collects compiled expressions and writes them into a bundle file.
+
+		Each expression is stored in the record format of ParserBase::SaveByteCode together with
+		a unique name. The id of an expression is the order in which it was added.
+	*/
+	class API_EXPORT_CXX ParserBundleWriter final
+	{
+	public:
+
+		ParserBundleWriter();
+
+		int Add(const string_type& a_sName, const ParserBase& a_Parser);
+		void Write(const std::string& a_sFile) const;
+		int GetSize() const;
+
+	private:
+
+		std::vector<string_type> m_vName;        ///< Expression names in id order
+		std::vector<std::uint64_t> m_vOffset;    ///< Offset of each record in m_sData, followed by the total size
+		std::map<string_type, int> m_NameIdx;    ///< Ids sorted by name
+		std::string m_sData;                     ///< Records of all expressions
+	};
+
+
+	/** \brief Read only view of a bundle file written by ParserBundleWriter.
+
+		The file is memory mapped read only. Processes opening the same bundle share its pages and 
+		opening a bundle touches nothing but the header. The name index is searched in place.
+
+		Loading an expression relocates its record against the symbol tables of a parser (see 
+		ParserBase::LoadByteCode). The relocated bytecode held by the parser is the only per 
+		process copy, records of expressions that are never loaded are never read.
+	*/
+	class API_EXPORT_CXX ParserBundle final
+	{
+	public:
+
+		ParserBundle();
+		explicit ParserBundle(const std::string& a_sFile);
+		~ParserBundle();
+
+		void Open(const std::string& a_sFile);
+		void Close();
+		bool IsOpen() const;
+
+		int GetSize() const;
+		int Find(const string_type& a_sName) const;
+		string_type GetName(int a_iId) const;
+
+		void Load(int a_iId, ParserBase& a_Parser) const;
+		void Load(const string_type& a_sName, ParserBase& a_Parser) const;
+
+	private:
+
+		ParserBundle(const ParserBundle&) = delete;
+		ParserBundle& operator=(const ParserBundle&) = delete;
+
+		/** \brief Index entry of a single expression as stored in the file. */
+		struct SEntry
+		{
+			std::uint64_t nRecOffset;
+			std::uint64_t nRecSize;
+			std::uint64_t nNameOffset;
+			std::uint64_t nNameLen;
+		};
+
+		SEntry GetEntry(int a_iId) const;
+
+		const char* m_pData;    ///< Start of the mapped file
+		std::size_t m_nSize;    ///< Size of the mapped file in bytes
+		int m_nEntries;         ///< Number of expressions
+		std::size_t m_nIndex;   ///< Offset of the index entries
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
@@ -29,12 +29,18 @@
 #ifndef MU_PARSER_BYTECODE_H
 #define MU_PARSER_BYTECODE_H
 
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
 #include <string>
 #include <stack>
 #include <vector>
 
 #include "muParserDef.h"
 #include "muParserError.h"
+#include "muParserMemory.h"
+#include "muParserStringPool.h"
 #include "muParserToken.h"
 
 /** \file
@@ -55,6 +61,7 @@ namespace mu
 				value_type* ptr;
 				value_type  data;
 				value_type  data2;
+				std::ptrdiff_t stride;	///< Distance in bytes between two consecutive values of the variable in bulk mode
 			} Val;
 
 			struct // SFunData
@@ -66,17 +73,47 @@ namespace mu
 				generic_callable_type cb;
 				int   argc;
 				int   idx;
+				bool  optimizable;	///< false if two calls with identical arguments may return different values
+				bool  strhash;		///< cmFUNC_STR only: the callback receives the length and hash of the string argument
 			} Fun;
 
 			struct // SOprtData
 			{
 				value_type* ptr;
 				int offset;
+				std::ptrdiff_t stride;	///< Distance in bytes between two consecutive values of the assignment target in bulk mode
 			} Oprt;
 		};
 	};
 
 
+	/** \brief Translates the addresses stored in the bytecode into symbol names and back.
+
+		ParserByteCode::Save stores variables and callbacks by name, ParserByteCode::Load 
+		resolves these names against the symbol tables of the loading parser.
+	*/
+	class ParserByteCodeSymbols
+	{
+	public:
+
+		/** \brief The symbol table a callback was found in. */
+		enum ECallbackTable
+		{
+			ctFUN = 0,
+			ctOPRT_BIN = 1,
+			ctOPRT_INFIX = 2,
+			ctOPRT_POSTFIX = 3
+		};
+
+		virtual ~ParserByteCodeSymbols() {}
+
+		virtual bool FindVarName(const value_type* a_pVar, string_type& a_sName) const = 0;
+		virtual value_type* GetVarAddr(const string_type& a_sName, std::ptrdiff_t& a_iStride) const = 0;
+		virtual bool FindCallbackName(const generic_callable_type& a_Fun, int& a_iTable, string_type& a_sName) const = 0;
+		virtual const ParserCallback* GetCallback(int a_iTable, const string_type& a_sName) const = 0;
+	};
+
+
 	/** \brief Bytecode implementation of the Math Parser.
 
 		The bytecode contains the formula converted to revers polish notation stored in a continious
@@ -92,7 +129,7 @@ namespace mu
 		typedef ParserToken<value_type, string_type> token_type;
 
 		/** \brief Token vector for storing the RPN. */
-		typedef std::vector<SToken> rpn_type;
+		typedef std::vector<SToken, ParserAllocator<SToken>> rpn_type;
 
 		/** \brief Position in the Calculation array. */
 		unsigned m_iStackPos;
@@ -106,27 +143,60 @@ namespace mu
 		bool m_bEnableOptimizer;
 
 		void ConstantFolding(ECmdCode a_Oprt);
+		static bool IsSameVar(const SToken& a_Tok1, const SToken& a_Tok2);
 
 	public:
 
 		ParserByteCode();
+		explicit ParserByteCode(ParserMemoryResource* a_pResource);
 		ParserByteCode(const ParserByteCode& a_ByteCode);
 		ParserByteCode& operator=(const ParserByteCode& a_ByteCode);
 		void Assign(const ParserByteCode& a_ByteCode);
 
-		void AddVar(value_type* a_pVar);
+		void AddVar(value_type* a_pVar, std::ptrdiff_t a_iStride = sizeof(value_type));
 		void AddVal(value_type a_fVal);
 		void AddOp(ECmdCode a_Oprt);
 		void AddIfElse(ECmdCode a_Oprt);
-		void AddAssignOp(value_type* a_pVar);
+		void AddAssignOp(value_type* a_pVar, std::ptrdiff_t a_iStride = sizeof(value_type));
 		void AddFun(generic_callable_type a_pFun, int a_iArgc, bool isOptimizable);
 		void AddBulkFun(generic_callable_type a_pFun, int a_iArgc);
-		void AddStrFun(generic_callable_type a_pFun, int a_iArgc, int a_iIdx);
+		void AddStrFun(generic_callable_type a_pFun, int a_iArgc, int a_iIdx, bool a_bStrHash = false);
 
 		void EnableOptimizer(bool bStat);
+		bool IsOptimizerEnabled() const;
+		void RelocateVars(const std::map<value_type*, value_type*>& a_vReloc);
 
 		void Finalize();
 		void clear();
+
+		void Save(std::ostream& a_Stream, const ParserByteCodeSymbols& a_Symbols) const;
+		void Load(const char*& a_pPos, const char* a_pEnd, const ParserByteCodeSymbols& a_Symbols);
+
+		/** \brief Write a trivially copyable value in native binary representation. */
+		template<typename T>
+		static void WriteBinary(std::ostream& a_Stream, const T& a_Val)
+		{
+			a_Stream.write(reinterpret_cast<const char*>(&a_Val), sizeof(T));
+		}
+
+		/** \brief Read a value written by WriteBinary from a memory range and advance the read position.
+			\throw ParserError if the range ends prematurely.
+		*/
+		template<typename T>
+		static T ReadBinary(const char*& a_pPos, const char* a_pEnd)
+		{
+			if ((std::size_t)(a_pEnd - a_pPos) < sizeof(T))
+				throw ParserError(ecINVALID_BYTECODE);
+
+			T val;
+			std::memcpy(&val, a_pPos, sizeof(T));
+			a_pPos += sizeof(T);
+			return val;
+		}
+
+		static void WriteString(std::ostream& a_Stream, const string_type& a_sVal);
+		static string_type ReadString(const char*& a_pPos, const char* a_pEnd);
+		static value_type CallStrFun(const SToken& a_Tok, const ParserStringPool& a_StrBuf, const value_type* a_pArg);
 		std::size_t GetMaxStackSize() const;
 
 		std::size_t GetSize() const
@@ -31,6 +31,7 @@
 #define MU_PARSER_CALLBACK_H
 
 #include "muParserDef.h"
+#include "muParserSymbolTable.h"
 
 /** \file
 	\brief Definition of the parser callback class.
@@ -87,6 +88,13 @@ namespace mu
 		ParserCallback(strfun_type5 a_pFun, bool a_bAllowOpti);
 		ParserCallback(strfun_type6 a_pFun, bool a_bAllowOpti);
 
+		ParserCallback(strhashfun_type1 a_pFun, bool a_bAllowOpti);
+		ParserCallback(strhashfun_type2 a_pFun, bool a_bAllowOpti);
+		ParserCallback(strhashfun_type3 a_pFun, bool a_bAllowOpti);
+		ParserCallback(strhashfun_type4 a_pFun, bool a_bAllowOpti);
+		ParserCallback(strhashfun_type5 a_pFun, bool a_bAllowOpti);
+		ParserCallback(strhashfun_type6 a_pFun, bool a_bAllowOpti);
+
 		// note: a_pUserData shall not be nullptr
 		ParserCallback(fun_userdata_type0  a_pFun, void* a_pUserData, bool a_bAllowOpti);
 		ParserCallback(fun_userdata_type1  a_pFun, void* a_pUserData, bool a_bAllowOpti);
@@ -121,6 +129,13 @@ namespace mu
 		ParserCallback(strfun_userdata_type5 a_pFun, void* a_pUserData, bool a_bAllowOpti);
 		ParserCallback(strfun_userdata_type6 a_pFun, void* a_pUserData, bool a_bAllowOpti);
 
+		ParserCallback(strhashfun_userdata_type1 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+		ParserCallback(strhashfun_userdata_type2 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+		ParserCallback(strhashfun_userdata_type3 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+		ParserCallback(strhashfun_userdata_type4 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+		ParserCallback(strhashfun_userdata_type5 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+		ParserCallback(strhashfun_userdata_type6 a_pFun, void* a_pUserData, bool a_bAllowOpti);
+
 		ParserCallback();
 		ParserCallback(const ParserCallback& a_Fun);
 		ParserCallback & operator=(const ParserCallback& a_Fun);
@@ -137,6 +152,7 @@ namespace mu
 		int GetPri()  const;
 		EOprtAssociativity GetAssociativity() const;
 		int GetArgc() const;
+		bool HasStrHash() const;
 
 	private:
 		void Assign(const ParserCallback& ref);
@@ -155,6 +171,9 @@ namespace mu
 	/** \brief Container for Callback objects. */
 	typedef std::map<string_type, ParserCallback> funmap_type;
 
+	/** \brief Copy on write table of callback objects. */
+	typedef ParserSymbolTable<funmap_type> funtable_type;
+
 } // namespace mu
 
 #endif
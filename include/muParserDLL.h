@@ -150,6 +150,8 @@ extern "C"
 	API_EXPORT(muFloat_t) mupEval(muParserHandle_t a_hParser);
 	API_EXPORT(muFloat_t*) mupEvalMulti(muParserHandle_t a_hParser, int* nNum);
 	API_EXPORT(void) mupEvalBulk(muParserHandle_t a_hParser, muFloat_t* a_fResult, int nSize);
+	API_EXPORT(void) mupEvalBulkStrided(muParserHandle_t a_hParser, muFloat_t* a_fResult, int nSize, int nResultStride);
+	API_EXPORT(void) mupEvalBulkMulti(muParserHandle_t a_hParser, muFloat_t** a_fResult, int nSize);
 
 	// Defining callbacks / variables / constants
 	API_EXPORT(void) mupDefineFun0(muParserHandle_t a_hParser, const muChar_t* a_szName, muFun0_t a_pFun, muBool_t a_bOptimize);
@@ -248,6 +250,14 @@ extern "C"
 		const muChar_t* a_szName,
 		muFloat_t* a_fVar);
 
+	API_EXPORT(void) mupSetVarStride(muParserHandle_t a_hParser,
+		const muChar_t* a_szName,
+		int a_iStride);
+
+	API_EXPORT(void) mupSetVarBroadcast(muParserHandle_t a_hParser,
+		const muChar_t* a_szName,
+		muBool_t a_bBroadcast);
+
 	API_EXPORT(void) mupDefinePostfixOprt(muParserHandle_t a_hParser,
 		const muChar_t* a_szName,
 		muFun1_t a_pOprt,
@@ -275,8 +275,13 @@ namespace mu
 
 		ecINVALID_CHARACTERS_FOUND = 38,///< The expression or identifier contains invalid non printable characters
 
+		ecINVALID_BYTECODE = 39, ///< Serialized bytecode is damaged or was written by an incompatible version
+		ecBYTECODE_SYMBOL_MISMATCH = 40, ///< A symbol used by serialized bytecode is undefined or has a different signature
+
+		ecEDIT_OUT_OF_RANGE = 41, ///< The range replaced by ReplaceRange exceeds the expression
+
 		// internal errors
-		ecINTERNAL_ERROR = 39,    ///< Internal error of any kind.
+		ecINTERNAL_ERROR = 42,    ///< Internal error of any kind.
 
 		// The last two are special entries 
 		ecCOUNT,                      ///< This is no error code, It just stores just the total number of error codes
@@ -498,6 +503,42 @@ namespace mu
 	/** \brief Callback type with user data (not null) used for functions taking a string and five values as arguments. */
 	typedef value_type(*strfun_userdata_type6)(void*, const char_type*, value_type, value_type, value_type, value_type, value_type);
 
+	/** \brief Callback type used for functions taking a string as an argument, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type1)(const char_type*, std::size_t, std::size_t);
+
+	/** \brief Callback type used for functions taking a string and a value as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type2)(const char_type*, std::size_t, std::size_t, value_type);
+
+	/** \brief Callback type used for functions taking a string and two values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type3)(const char_type*, std::size_t, std::size_t, value_type, value_type);
+
+	/** \brief Callback type used for functions taking a string and three values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type4)(const char_type*, std::size_t, std::size_t, value_type, value_type, value_type);
+
+	/** \brief Callback type used for functions taking a string and four values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type5)(const char_type*, std::size_t, std::size_t, value_type, value_type, value_type, value_type);
+
+	/** \brief Callback type used for functions taking a string and five values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_type6)(const char_type*, std::size_t, std::size_t, value_type, value_type, value_type, value_type, value_type);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string as an argument, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type1)(void*, const char_type*, std::size_t, std::size_t);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string and a value as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type2)(void*, const char_type*, std::size_t, std::size_t, value_type);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string and two values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type3)(void*, const char_type*, std::size_t, std::size_t, value_type, value_type);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string and three values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type4)(void*, const char_type*, std::size_t, std::size_t, value_type, value_type, value_type);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string and four values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type5)(void*, const char_type*, std::size_t, std::size_t, value_type, value_type, value_type, value_type);
+
+	/** \brief Callback type with user data (not null) used for functions taking a string and five values as arguments, the string is passed with its length and hash. */
+	typedef value_type(*strhashfun_userdata_type6)(void*, const char_type*, std::size_t, std::size_t, value_type, value_type, value_type, value_type, value_type);
+
 	/** \brief Callback used for functions that identify values in a string. */
 	typedef int (*identfun_type)(const char_type* sExpr, int* nPos, value_type* fVal);
 
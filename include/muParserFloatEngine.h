@@ -0,0 +1,164 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_FLOAT_ENGINE_H
+#define MU_PARSER_FLOAT_ENGINE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "muParserDef.h"
+#include "muParserBytecode.h"
+#include "muParserStringPool.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the single precision evaluation engine.
+*/
+
+namespace mu
+{
+	// Forward declaration
+	class ParserBase;
+
+	/** \brief Evaluates the bytecode of a parser in single precision over float columns.
+
+		The expression is parsed and optimized by a regular parser, its bytecode is then 
+		translated into instructions operating on floats. The engine does not depend on
+		MUP_BASETYPE, it can be used together with parsers evaluating in double precision.
+
+		Rows are processed in blocks: every instruction is applied to all rows of a block 
+		before the next instruction is executed, so that the arithmetic runs in tight loops 
+		over float arrays the compiler can vectorize. The built in math functions and unary 
+		sign operators are evaluated in single precision. Other callbacks are called row by 
+		row with their arguments converted to value_type.
+
+		Variables are bound to float columns with DefineVar after the expression was compiled
+		or before, the bindings are kept when a new expression is compiled.
+
+		The registers used by the evaluation are allocated by Compile and reused by every 
+		call to Eval, so an engine must not be evaluated by several threads at the same time.
+
+		Differences to the bulk mode of the parser:
+		<ul>
+		  <li>Both branches of the ternary operator are evaluated, the result is selected afterwards.</li>
+		  <li>Assignments are not supported.</li>
+		</ul>
+
+		<pre>
+		  Parser p;
+		  p.DefineVar("a", &a);          // the double variable is only needed for parsing
+		  p.SetExpr("a*2 + sin(a)");
+
+		  ParserFloatEngine fe;
+		  fe.Compile(p);
+		  fe.DefineVar("a", vA.data());  // a column of floats
+		  fe.Eval(vRes.data(), (int)vA.size());
+		</pre>
+	*/
+	class API_EXPORT_CXX ParserFloatEngine final
+	{
+	public:
+
+		typedef float float_type;
+
+		/** \brief Float implementation of a built in function, applied to a block of values in place. */
+		typedef void (*kernel_type)(float_type* a_pVal, int a_nRows);
+
+		ParserFloatEngine();
+
+		void Compile(const ParserBase& a_Parser);
+
+		void DefineVar(const string_type& a_sName, const float_type* a_pVar);
+		void SetVarStride(const string_type& a_sName, int a_iStride);
+		void ClearVar();
+
+		void Eval(float_type* a_pResults, int a_nBulkSize) const;
+		void EvalColumns(float_type* const* a_pResults, int a_nBulkSize) const;
+
+		int GetNumResults() const;
+		const string_type& GetExpr() const;
+
+	private:
+
+		/** \brief Number of rows each instruction is applied to at once. */
+		static const int s_nBlockSize = 256;
+
+		/** \brief A float column bound to a variable of the expression. */
+		struct SVarBinding
+		{
+			const float_type* pVar;
+			std::ptrdiff_t iStride;  ///< Distance in bytes between two consecutive values, 0 for a scalar
+		};
+
+		/** \brief A single instruction; it reads its arguments from the registers starting at iReg and writes its result to iReg. */
+		struct SInstr
+		{
+			SToken Tok;          ///< The bytecode token, function tokens keep their callback
+			int iReg;            ///< Register of the first argument and the result
+			int nArgs;           ///< Number of arguments
+			int iVar;            ///< Variables: index in m_vVarName
+			float_type fVal;     ///< cmVAL: the value, cmVARMUL: the factor
+			float_type fOffset;  ///< cmVARMUL: the offset
+			kernel_type pKernel; ///< cmFUNC: float implementation of the callback or nullptr
+		};
+
+		void Run(int a_iBegin, int a_nRows, int a_nThreadID, const SVarBinding* a_pVar, float_type* a_pReg, value_type* a_pArg) const;
+		void BindVars();
+		void ReserveBuffers(int a_nThreads) const;
+		static int GetMaxThreads();
+		void EvalBlocks(float_type* const* a_pResults, int a_iFirstResult, int a_nResults, int a_nBulkSize) const;
+
+		static kernel_type FindKernel(const SToken& a_Tok);
+
+		string_type m_sExpr;
+		std::vector<SInstr> m_vInstr;           ///< Instructions in evaluation order
+		std::vector<string_type> m_vVarName;    ///< Names of the variables read by the instructions
+		std::map<string_type, SVarBinding> m_VarDef; ///< Float columns bound to variable names
+		std::vector<SVarBinding> m_vVar;        ///< Columns of the variables in m_vVarName, pVar is nullptr if a variable is not bound
+		ParserStringPool m_vStringBuf;          ///< String arguments of string functions
+		int m_nResults;                         ///< Number of results, they are held by the first registers
+		int m_nRegs;                            ///< Number of registers
+		int m_nArgStride;                       ///< Distance between the callback arguments of two threads, a multiple of the cache line size
+
+		mutable std::vector<float_type> m_vReg; ///< Registers of all threads, m_nRegs * s_nBlockSize values per thread
+		mutable std::vector<value_type> m_vArg; ///< Callback arguments of all threads, m_nArgStride values per thread
+		mutable int m_nBufThreads;              ///< Number of threads m_vReg and m_vArg hold buffers for
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
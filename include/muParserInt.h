@@ -135,6 +135,14 @@ namespace mu
 		void InitOprt() override;
 		void InitConst() override;
 		void InitCharSets() override;
+
+	private:
+
+		/** \brief Selects the constructor defining the built in symbols. */
+		struct SBuiltInTag {};
+
+		explicit ParserInt(SBuiltInTag);
+		static const ParserInt& GetBuiltIns();
 	};
 
 } // namespace mu
@@ -0,0 +1,238 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef MU_PARSER_MEMORY_H
+#define MU_PARSER_MEMORY_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "muParserDef.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Memory resources and the allocator used by the internal containers of the parser.
+*/
+
+namespace mu
+{
+	/** \brief Source of the memory used by the internal containers of a parser.
+
+		This is a C++11 replacement for std::pmr::memory_resource. The default resource 
+		forwards to the global operator new and delete. Derive from this class to supply 
+		memory from a pool or an arena, see ParserBase::SetMemoryResource.
+	*/
+	class API_EXPORT_CXX ParserMemoryResource
+	{
+	public:
+
+		virtual ~ParserMemoryResource() = default;
+
+		/** \brief Allocate a_nBytes of memory aligned to a_nAlign; throws std::bad_alloc on failure. */
+		virtual void* Allocate(std::size_t a_nBytes, std::size_t a_nAlign) = 0;
+
+		/** \brief Return memory obtained from Allocate with the same size and alignment. */
+		virtual void Deallocate(void* a_pMem, std::size_t a_nBytes, std::size_t a_nAlign) noexcept = 0;
+
+		static ParserMemoryResource* GetDefault() noexcept;
+	};
+
+
+	/** \brief A monotonic memory resource.
+
+		Memory is handed out from blocks obtained from an upstream resource. Deallocate
+		does nothing, all memory is returned to the upstream resource at once by Release 
+		or by the destructor. This makes compiling and discarding expressions cheap and 
+		stops long running processes from fragmenting their heap.
+
+		Release must not be called while a parser (or a clone of it) still uses the 
+		resource. The resource is not thread safe.
+	*/
+	class API_EXPORT_CXX ParserArenaResource final : public ParserMemoryResource
+	{
+	public:
+
+		explicit ParserArenaResource(std::size_t a_nBlockSize = 4096, ParserMemoryResource* a_pUpstream = nullptr);
+		~ParserArenaResource() override;
+
+		void* Allocate(std::size_t a_nBytes, std::size_t a_nAlign) override;
+		void Deallocate(void* a_pMem, std::size_t a_nBytes, std::size_t a_nAlign) noexcept override;
+
+		void Release() noexcept;
+
+		std::size_t GetBytesAllocated() const noexcept;
+		std::size_t GetBytesReserved() const noexcept;
+
+	private:
+
+		ParserArenaResource& operator=(const ParserArenaResource&) = delete;
+		ParserArenaResource(const ParserArenaResource&) = delete;
+
+		struct SBlock
+		{
+			void* pMem;
+			std::size_t nSize;
+		};
+
+		ParserMemoryResource* m_pUpstream;
+		std::vector<SBlock> m_vBlocks;  ///< Blocks obtained from the upstream resource
+		std::size_t m_nBlockSize;       ///< Size of the next block
+		char* m_pPos;                   ///< Start of the free space in the current block
+		char* m_pEnd;                   ///< End of the current block
+		std::size_t m_nAllocated;       ///< Bytes handed out since the last release
+		std::size_t m_nReserved;        ///< Bytes obtained from the upstream resource
+	};
+
+
+	/** \brief Standard conforming allocator drawing its memory from a ParserMemoryResource.
+
+		Like std::pmr::polymorphic_allocator the resource is not propagated on copy 
+		assignment, so copying a parser never makes the copy depend on the memory 
+		resource of the original. Copy construction of a container yields a container 
+		using the default resource.
+	*/
+	template<typename T>
+	class ParserAllocator
+	{
+	public:
+
+		typedef T value_type;
+		typedef std::false_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		ParserAllocator() noexcept
+			:m_pResource(ParserMemoryResource::GetDefault())
+		{}
+
+		ParserAllocator(ParserMemoryResource* a_pResource) noexcept
+			:m_pResource((a_pResource != nullptr) ? a_pResource : ParserMemoryResource::GetDefault())
+		{}
+
+		template<typename U>
+		ParserAllocator(const ParserAllocator<U>& a_Other) noexcept
+			:m_pResource(a_Other.GetResource())
+		{}
+
+		T* allocate(std::size_t a_nNum)
+		{
+			if (a_nNum > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_alloc();
+
+			return static_cast<T*>(m_pResource->Allocate(a_nNum * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* a_pMem, std::size_t a_nNum) noexcept
+		{
+			m_pResource->Deallocate(a_pMem, a_nNum * sizeof(T), alignof(T));
+		}
+
+		ParserAllocator select_on_container_copy_construction() const noexcept
+		{
+			return ParserAllocator();
+		}
+
+		ParserMemoryResource* GetResource() const noexcept
+		{
+			return m_pResource;
+		}
+
+	private:
+
+		ParserMemoryResource* m_pResource;
+	};
+
+	template<typename T, typename U>
+	bool operator==(const ParserAllocator<T>& a_Lhs, const ParserAllocator<U>& a_Rhs) noexcept
+	{
+		return a_Lhs.GetResource() == a_Rhs.GetResource();
+	}
+
+	template<typename T, typename U>
+	bool operator!=(const ParserAllocator<T>& a_Lhs, const ParserAllocator<U>& a_Rhs) noexcept
+	{
+		return !(a_Lhs == a_Rhs);
+	}
+
+	/** \brief Returns the heap memory held by a string in bytes.
+
+		Short strings stored inside the string object (small string optimization) do not 
+		hold heap memory.
+	*/
+	inline std::size_t GetHeapSize(const string_type& a_sStr)
+	{
+		return (a_sStr.capacity() > string_type().capacity()) ? (a_sStr.capacity() + 1) * sizeof(char_type) : 0;
+	}
+
+	/** \brief Returns an estimate of the heap memory held by a map with string keys in bytes.
+
+		Each node is assumed to hold the value and four pointers of bookkeeping data, the 
+		layout of the red black tree nodes of the common standard library implementations.
+		Memory referenced by the mapped values is not included.
+	*/
+	template<typename TMap>
+	std::size_t GetMapHeapSize(const TMap& a_Map)
+	{
+		std::size_t nBytes = a_Map.size() * (sizeof(typename TMap::value_type) + 4 * sizeof(void*));
+		for (const auto& item : a_Map)
+			nBytes += GetHeapSize(item.first);
+
+		return nBytes;
+	}
+
+	/** \brief Returns the heap memory held by a std::stack based on a std::vector in bytes.
+
+		std::stack does not expose its container, the protected member is read through a 
+		member pointer of a derived class. Memory referenced by the elements is not included.
+	*/
+	template<typename TStack>
+	std::size_t GetStackHeapSize(const TStack& a_Stack)
+	{
+		struct SAccess : TStack
+		{
+			static const typename TStack::container_type& Get(const TStack& a_Stack)
+			{
+				return a_Stack.*(&SAccess::c);
+			}
+		};
+
+		return SAccess::Get(a_Stack).capacity() * sizeof(typename TStack::value_type);
+	}
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
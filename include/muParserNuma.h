@@ -0,0 +1,112 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_NUMA_H
+#define MU_PARSER_NUMA_H
+
+#include <string>
+#include <vector>
+
+#include "muParserDef.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the NUMA topology helper used by the bulk mode.
+*/
+
+namespace mu
+{
+	/** \brief NUMA topology of the host as seen by the bulk mode.
+
+		The topology is read once from /sys/devices/system/node. On systems without
+		this interface (or on non Linux platforms) the host is treated as a single node
+		and thread binding is a no-op.
+
+		Threads of a bulk evaluation are assigned to nodes in contiguous blocks and each
+		thread processes a contiguous range of rows. A buffer that was first touched with
+		the same partitioning (see ParserBase::AllocBulkBuffer) therefore has its pages
+		on the node of the thread reading them.
+	*/
+	class API_EXPORT_CXX ParserNumaTopology final
+	{
+	public:
+
+		static const ParserNumaTopology& Instance();
+
+		int GetNumNodes() const;
+		const std::vector<int>& GetNodeCpus(int a_iNode) const;
+		int GetThreadNode(int a_iThread, int a_nThreads) const;
+		bool BindThread(int a_iThread, int a_nThreads) const;
+
+		static void GetThreadRange(int a_iThread, int a_nThreads, int a_nSize, int& a_iBegin, int& a_iEnd);
+
+	private:
+
+		ParserNumaTopology& operator=(const ParserNumaTopology&) = delete;
+		ParserNumaTopology(const ParserNumaTopology&) = delete;
+		ParserNumaTopology();
+
+		~ParserNumaTopology() = default;
+
+		static std::vector<int> ParseCpuList(const std::string& a_sList);
+
+		std::vector<std::vector<int>> m_vNodeCpus;  ///< CPU ids of each node with at least one CPU
+	};
+
+	/** \brief Saves the CPU affinity of the calling thread and restores it on destruction.
+
+		The master thread of an OpenMP parallel region is the thread that started it. 
+		ParserNumaTopology::BindThread pins it to a node like the worker threads, so the 
+		bulk mode creates a guard before the region to hand the thread back to the 
+		application unchanged. Worker threads keep their binding.
+	*/
+	class API_EXPORT_CXX ParserAffinityGuard final
+	{
+	public:
+
+		ParserAffinityGuard();
+		~ParserAffinityGuard();
+
+	private:
+
+		ParserAffinityGuard& operator=(const ParserAffinityGuard&) = delete;
+		ParserAffinityGuard(const ParserAffinityGuard&) = delete;
+
+		std::vector<unsigned char> m_vMask;  ///< The saved affinity mask, empty if nothing has to be restored
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
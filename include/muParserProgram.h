@@ -0,0 +1,129 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_PROGRAM_H
+#define MU_PARSER_PROGRAM_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "muParserDef.h"
+#include "muParserBytecode.h"
+#include "muParserStringPool.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the program class for evaluating several expressions at once.
+*/
+
+namespace mu
+{
+	// Forward declaration
+	class ParserBase;
+
+	/** \brief A set of expressions compiled into a single program.
+
+		The bytecode of all expressions is merged into one dataflow graph in which identical
+		subexpressions (the same operation applied to the same operands) are computed only
+		once, even if they are part of different expressions. Operands of commutative
+		operators are normalized so that "a*b" and "b*a" share their result. Each row is
+		read once for all expressions and one result per expression is written.
+
+		Differences to evaluating the expressions one by one:
+		<ul>
+		  <li>Both branches of the ternary operator are evaluated, the result is selected afterwards.</li>
+		  <li>Assignments are not supported.</li>
+		  <li>Functions defined as not optimizable, bulk functions and string functions are never shared.</li>
+		</ul>
+
+		The program keeps the addresses of the variables and functions defined in the parser at
+		compile time. Expressions with comma separated subexpressions contribute one result per
+		subexpression.
+	*/
+	class API_EXPORT_CXX ParserProgram final
+	{
+	public:
+
+		ParserProgram();
+
+		void Compile(ParserBase& a_Parser, const std::vector<string_type>& a_vExpr);
+
+		void Eval(value_type* a_pResults) const;
+		void Eval(value_type* const* a_ppResults, int a_nBulkSize) const;
+
+		int GetNumResults() const;
+		std::size_t GetNumInstructions() const;
+
+	private:
+
+		/** \brief A single instruction; its result is stored in the register with the index of the instruction. */
+		struct SInstr
+		{
+			SToken Tok;   ///< Operation and immediate operands
+			int iArg;     ///< Index of the first argument register index in m_vArgs
+			int nArgs;    ///< Number of arguments
+		};
+
+		/** \brief Key used for detecting identical subexpressions. */
+		struct SNodeKey
+		{
+			int iCmd;
+			std::vector<unsigned char> vOperand;
+			std::vector<int> vArgs;
+
+			bool operator<(const SNodeKey& a_Key) const;
+		};
+
+		typedef std::map<SNodeKey, int> nodemap_type;
+
+		int AddNode(const SToken& a_Tok, const std::vector<int>& a_vArgs, nodemap_type& a_vNodes);
+		void Run(int a_nOffset, int a_nThreadID, value_type* a_pReg) const;
+
+		static value_type CallFun(const SToken& a_Tok, const value_type* a_pArg);
+		static value_type CallBulkFun(const SToken& a_Tok, int a_nOffset, int a_nThreadID, const value_type* a_pArg);
+
+		std::vector<SInstr> m_vInstr;          ///< Instructions in evaluation order
+		std::vector<int> m_vArgs;              ///< Argument register indices of all instructions
+		std::vector<int> m_vResults;           ///< Register indices of the results
+		ParserStringPool m_vStringBuf;         ///< String arguments of string functions
+		int m_nMaxArgs;                        ///< Maximum number of arguments of a single instruction
+
+		mutable std::vector<value_type> m_vReg; ///< Registers used by the single row evaluation
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
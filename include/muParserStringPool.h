@@ -0,0 +1,108 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef MU_PARSER_STRING_POOL_H
+#define MU_PARSER_STRING_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include "muParserDef.h"
+#include "muParserMemory.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the pool holding the string arguments of string functions.
+*/
+
+namespace mu
+{
+	/** \brief The string arguments of the string functions of an expression.
+
+		String literals are interned when the bytecode is created, every distinct string 
+		is stored once. The hash of each string is computed when it is added, so callbacks
+		of type strhashfun_type receive the string together with its length and hash 
+		without scanning it on every evaluation. The hash is std::hash<string_type> of the
+		string. An open addressing hash index maps the strings to their indices, so 
+		interning does not scan the pool.
+	*/
+	class API_EXPORT_CXX ParserStringPool final
+	{
+	public:
+
+		typedef std::vector<string_type, ParserAllocator<string_type>> strbuf_type;
+		typedef strbuf_type::const_iterator const_iterator;
+
+		ParserStringPool();
+		explicit ParserStringPool(ParserMemoryResource* a_pResource);
+
+		int Intern(const string_type& a_sStr);
+		int Add(const string_type& a_sStr);
+		void Append(const ParserStringPool& a_Pool);
+		void clear();
+
+		/** \brief Returns the string with the given index. */
+		const string_type& Get(int a_iIdx) const
+		{
+			return m_vStr[a_iIdx];
+		}
+
+		/** \brief Returns the hash of the string with the given index. */
+		std::size_t GetHash(int a_iIdx) const
+		{
+			return m_vHash[a_iIdx];
+		}
+
+		std::size_t size() const;
+		bool empty() const;
+		const_iterator begin() const;
+		const_iterator end() const;
+		std::size_t GetMemoryUsage() const;
+
+	private:
+
+		int Find(const string_type& a_sStr, std::size_t a_nHash) const;
+		void Index(int a_iIdx);
+		void InsertSlot(int a_iIdx);
+		void Rehash();
+
+		strbuf_type m_vStr;
+		std::vector<std::size_t, ParserAllocator<std::size_t>> m_vHash;  ///< Hashes of the strings, same order as m_vStr
+		std::vector<int, ParserAllocator<int>> m_vSlot;  ///< Hash index of the strings, -1 marks an empty slot, the number of slots is a power of two
+		std::size_t m_nDistinct;                         ///< Number of occupied slots, the number of distinct strings
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,320 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_SYMBOL_INDEX_H
+#define MU_PARSER_SYMBOL_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include "muParserDef.h"
+
+/** \file
+	\brief Definition of the lookup structures used by the token reader for symbols and operators.
+*/
+
+namespace mu
+{
+	/** \brief An open addressing hash index on top of one of the parsers symbol maps.
+
+		The index does not own any symbols. Its slots reference the keys and iterators of 
+		a std::map which must therefore outlive the index and must not have elements 
+		removed while the index is in use. Lookups hash the identifier once and compare 
+		full strings only on a hash match instead of walking the tree of the map.
+
+		\tparam TIterator The const_iterator type of the indexed map.
+	*/
+	template<typename TIterator>
+	class ParserSymbolIndex final
+	{
+	public:
+
+		ParserSymbolIndex()
+			:m_vSlot()
+			,m_nSize(0)
+		{}
+
+		/** \brief Drop all entries and index all elements of a map. */
+		template<typename TMap>
+		void Build(const TMap& a_Map)
+		{
+			m_vSlot.clear();
+			m_nSize = 0;
+
+			std::size_t nCap = 16;
+			while (nCap < a_Map.size() * 2)
+				nCap *= 2;
+
+			m_vSlot.resize(nCap);
+			for (TIterator it = a_Map.begin(); it != a_Map.end(); ++it)
+				Insert(it);
+		}
+
+		/** \brief Add a single map element to the index. */
+		void Insert(TIterator a_It)
+		{
+			if ((m_nSize + 1) * 2 > m_vSlot.size())
+				Grow();
+
+			const string_type& sName = a_It->first;
+			std::size_t nHash = Hash(sName);
+			std::size_t nMask = m_vSlot.size() - 1;
+			for (std::size_t i = nHash & nMask; ; i = (i + 1) & nMask)
+			{
+				SSlot& slot = m_vSlot[i];
+				if (slot.pKey == nullptr)
+				{
+					slot.nHash = nHash;
+					slot.pKey = &sName;
+					slot.it = a_It;
+					++m_nSize;
+					return;
+				}
+
+				if (slot.nHash == nHash && *slot.pKey == sName)
+				{
+					slot.it = a_It;
+					return;
+				}
+			}
+		}
+
+		/** \brief Look up a symbol name.
+			\param a_sName The name of the symbol.
+			\param a_It [out] The map iterator of the symbol if it was found.
+			\return true if the symbol is indexed.
+		*/
+		bool Find(const string_type& a_sName, TIterator& a_It) const
+		{
+			if (m_nSize == 0)
+				return false;
+
+			std::size_t nHash = Hash(a_sName);
+			std::size_t nMask = m_vSlot.size() - 1;
+			for (std::size_t i = nHash & nMask; m_vSlot[i].pKey != nullptr; i = (i + 1) & nMask)
+			{
+				const SSlot& slot = m_vSlot[i];
+				if (slot.nHash == nHash && *slot.pKey == a_sName)
+				{
+					a_It = slot.it;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Clear()
+		{
+			m_vSlot.clear();
+			m_nSize = 0;
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_nSize;
+		}
+
+		/** \brief Returns the heap memory held by the index in bytes. */
+		std::size_t GetMemoryUsage() const
+		{
+			return m_vSlot.capacity() * sizeof(SSlot);
+		}
+
+	private:
+
+		struct SSlot
+		{
+			SSlot()
+				:nHash(0)
+				,pKey(nullptr)
+				,it()
+			{}
+
+			std::size_t nHash;
+			const string_type* pKey;  ///< Key of the map element, nullptr marks an empty slot
+			TIterator it;
+		};
+
+		/** \brief FNV-1a hash of a symbol name. */
+		static std::size_t Hash(const string_type& a_sName)
+		{
+			std::size_t nHash = (sizeof(std::size_t) > 4) ? (std::size_t)14695981039346656037ULL : (std::size_t)2166136261U;
+			const std::size_t nPrime = (sizeof(std::size_t) > 4) ? (std::size_t)1099511628211ULL : (std::size_t)16777619U;
+			for (std::size_t i = 0; i < a_sName.length(); ++i)
+			{
+				nHash ^= (std::size_t)a_sName[i];
+				nHash *= nPrime;
+			}
+
+			return nHash;
+		}
+
+		void Grow()
+		{
+			std::vector<SSlot> vOld;
+			vOld.swap(m_vSlot);
+			m_vSlot.resize(vOld.size() ? vOld.size() * 2 : 16);
+			m_nSize = 0;
+
+			for (const SSlot& slot : vOld)
+			{
+				if (slot.pKey != nullptr)
+					Insert(slot.it);
+			}
+		}
+
+		std::vector<SSlot> m_vSlot;  ///< The slots, the number of slots is a power of two
+		std::size_t m_nSize;         ///< Number of occupied slots
+	};
+
+
+	/** \brief A character trie for longest match recognition of operator names.
+
+		The trie references the keys and iterators of a std::map of operator callbacks. 
+		Matching walks the trie along the input characters and returns the longest 
+		operator name that is a prefix of the input. The cost depends on the length of the 
+		input token and not on the number of defined operators.
+
+		\tparam TIterator The const_iterator type of the indexed map.
+	*/
+	template<typename TIterator>
+	class ParserOprtTrie final
+	{
+	public:
+
+		ParserOprtTrie()
+			:m_vNode(1)
+		{}
+
+		/** \brief Drop all entries and add all elements of a map. */
+		template<typename TMap>
+		void Build(const TMap& a_Map)
+		{
+			m_vNode.assign(1, SNode());
+			for (TIterator it = a_Map.begin(); it != a_Map.end(); ++it)
+				Insert(it);
+		}
+
+		void Clear()
+		{
+			m_vNode.assign(1, SNode());
+		}
+
+		/** \brief Returns the heap memory held by the trie in bytes. */
+		std::size_t GetMemoryUsage() const
+		{
+			return m_vNode.capacity() * sizeof(SNode);
+		}
+
+		/** \brief Find the longest operator name at the start of a string.
+			\param a_szExpr Pointer to the first character of the input.
+			\param a_nLen Maximum number of characters that may be consumed.
+			\param a_It [out] The map iterator of the operator if one was found.
+			\return The length of the operator name or 0 if none was found.
+		*/
+		std::size_t Match(const char_type* a_szExpr, std::size_t a_nLen, TIterator& a_It) const
+		{
+			std::size_t nMatch = 0;
+			int iNode = 0;
+			for (std::size_t i = 0; i < a_nLen; ++i)
+			{
+				iNode = FindChild(iNode, a_szExpr[i]);
+				if (iNode < 0)
+					break;
+
+				if (m_vNode[iNode].bTerminal)
+				{
+					a_It = m_vNode[iNode].it;
+					nMatch = i + 1;
+				}
+			}
+
+			return nMatch;
+		}
+
+	private:
+
+		struct SNode
+		{
+			SNode()
+				:cKey(0)
+				,iChild(-1)
+				,iSibling(-1)
+				,bTerminal(false)
+				,it()
+			{}
+
+			char_type cKey;     ///< The character leading to this node
+			int iChild;         ///< Index of the first child, -1 if there is none
+			int iSibling;       ///< Index of the next node with the same parent, -1 if there is none
+			bool bTerminal;     ///< True if the path to this node spells an operator name
+			TIterator it;
+		};
+
+		int FindChild(int a_iNode, char_type a_cKey) const
+		{
+			for (int i = m_vNode[a_iNode].iChild; i >= 0; i = m_vNode[i].iSibling)
+			{
+				if (m_vNode[i].cKey == a_cKey)
+					return i;
+			}
+
+			return -1;
+		}
+
+		void Insert(TIterator a_It)
+		{
+			const string_type& sName = a_It->first;
+			int iNode = 0;
+			for (std::size_t i = 0; i < sName.length(); ++i)
+			{
+				int iChild = FindChild(iNode, sName[i]);
+				if (iChild < 0)
+				{
+					SNode node;
+					node.cKey = sName[i];
+					node.iSibling = m_vNode[iNode].iChild;
+					m_vNode.push_back(node);
+
+					iChild = (int)m_vNode.size() - 1;
+					m_vNode[iNode].iChild = iChild;
+				}
+
+				iNode = iChild;
+			}
+
+			m_vNode[iNode].bTerminal = true;
+			m_vNode[iNode].it = a_It;
+		}
+
+		std::vector<SNode> m_vNode;  ///< The nodes of the trie, the first node is the root
+	};
+} // namespace mu
+
+#endif
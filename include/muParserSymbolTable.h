@@ -0,0 +1,132 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_SYMBOL_TABLE_H
+#define MU_PARSER_SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <memory>
+
+#include "muParserDef.h"
+
+/** \file
+	\brief Definition of the copy on write symbol tables shared by parser instances.
+*/
+
+namespace mu
+{
+	/** \brief A symbol map that is shared between parser instances until one of them changes it.
+
+		Copying a table only copies a reference to the map. The first modification of a table
+		whose map is referenced by other tables as well copies the map (copy on write), so 
+		parsers created from the same prototype share the definitions of the built in functions,
+		operators and constants until a user definition is added to one of them.
+
+		Only lookups are available through the const interface. Non const member functions 
+		modify the map and are not safe to call while another thread reads the same table. 
+		Different tables referencing the same map may be used by different threads.
+
+		\tparam TMap The std::map type of the symbols.
+	*/
+	template<typename TMap>
+	class ParserSymbolTable final
+	{
+	public:
+
+		typedef typename TMap::key_type key_type;
+		typedef typename TMap::mapped_type mapped_type;
+		typedef typename TMap::value_type value_type;
+		typedef typename TMap::size_type size_type;
+		typedef typename TMap::const_iterator const_iterator;
+
+		ParserSymbolTable()
+			:m_pMap(std::make_shared<TMap>())
+		{}
+
+		const TMap& Get() const
+		{
+			return *m_pMap;
+		}
+
+		/** \brief Returns true if the map is referenced by another table as well. */
+		bool IsShared() const
+		{
+			return m_pMap.use_count() > 1;
+		}
+
+		const_iterator begin() const { return m_pMap->begin(); }
+		const_iterator end() const { return m_pMap->end(); }
+		const_iterator find(const key_type& a_sKey) const { return m_pMap->find(a_sKey); }
+		size_type count(const key_type& a_sKey) const { return m_pMap->count(a_sKey); }
+		size_type size() const { return m_pMap->size(); }
+		bool empty() const { return m_pMap->empty(); }
+
+		mapped_type& operator[](const key_type& a_sKey)
+		{
+			return Modify()[a_sKey];
+		}
+
+		size_type erase(const key_type& a_sKey)
+		{
+			return (m_pMap->find(a_sKey) != m_pMap->end()) ? Modify().erase(a_sKey) : 0;
+		}
+
+		void clear()
+		{
+			// Dropping the reference is cheaper than copying a map only to clear it
+			if (IsShared())
+				m_pMap = std::make_shared<TMap>();
+			else
+				m_pMap->clear();
+		}
+
+	private:
+
+		/** \brief Returns the map for modification, copies it first if it is shared. */
+		TMap& Modify()
+		{
+			if (IsShared())
+				m_pMap = std::make_shared<TMap>(*m_pMap);
+
+			return *m_pMap;
+		}
+
+		std::shared_ptr<TMap> m_pMap;
+	};
+
+	/** \brief Copy on write table of constants. */
+	typedef ParserSymbolTable<valmap_type> valtable_type;
+
+	/** \brief Copy on write table of variables. */
+	typedef ParserSymbolTable<varmap_type> vartable_type;
+
+	/** \brief Copy on write table of string constants. */
+	typedef ParserSymbolTable<strmap_type> strtable_type;
+} // namespace mu
+
+#endif
@@ -32,6 +32,7 @@
 #include <string>
 #include <cstdlib>
 #include <cstdint>
+#include <functional>
 #include <numeric> // for accumulate
 #include "muParser.h"
 #include "muParserInt.h"
@@ -185,6 +186,20 @@ namespace mu
 				return val;
 			}
 
+			// string functions receiving the length and hash of their argument, -1000 if these are wrong
+			static value_type StrHashFun2(const char_type* a_szStr, std::size_t a_nLen, std::size_t a_nHash, value_type a_fVal)
+			{
+				string_type sStr(a_szStr);
+				return (sStr.length() == a_nLen && std::hash<string_type>()(sStr) == a_nHash) ? (value_type)a_nLen + a_fVal : -1000;
+			}
+
+			static value_type StrHashFunUd1(void* a_pUserData, const char_type* a_szStr, std::size_t a_nLen, std::size_t a_nHash)
+			{
+				// records the address of the string argument
+				static_cast<std::vector<const char_type*>*>(a_pUserData)->push_back(a_szStr);
+				return StrHashFun2(a_szStr, a_nLen, a_nHash, 0);
+			}
+
 			// postfix operator callback
 			static value_type Mega(value_type a_fVal) 
 			{
@@ -204,6 +219,15 @@ namespace mu
 			// Custom value recognition
 			static int IsHexVal(const char_type* a_szExpr, int* a_iPos, value_type* a_fVal);
 
+			// Variable factory handing out the elements of the array passed as user data,
+			// the first element counts the variables created so far
+			static value_type* VarFactory(const char_type*, void* pUserData)
+			{
+				value_type* pBuf = static_cast<value_type*>(pUserData);
+				pBuf[0] += 1;
+				return &pBuf[(int)pBuf[0]];
+			}
+
 			// With user data
 			static value_type FunUd0(void* data) 
 			{
@@ -259,6 +283,21 @@ namespace mu
 			int TestBulkMode();
 			int TestOssFuzzTestCases();
 			int TestOptimizer();
+			int TestProgram();
+			int TestExprCache();
+			int TestSymbolIndex();
+			int TestValueScan();
+			int TestByteCodeIO();
+			int TestBundle();
+			int TestBatchCompile();
+			int TestDependencyTracking();
+			int TestReplaceRange();
+			int TestSharedSymbols();
+			int TestClone();
+			int TestMemoryResource();
+			int TestStringPool();
+			int TestMemoryUsage();
+			int TestFloatEngine();
 
 			void Abort() const;
 
@@ -0,0 +1,90 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MU_PARSER_THREAD_POOL_H
+#define MU_PARSER_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "muParserDef.h"
+
+#if defined(_MSC_VER)
+	#pragma warning(push)
+	#pragma warning(disable : 4251)  // ...needs to have dll-interface to be used by clients of class ...
+#endif
+
+/** \file
+	\brief Definition of the worker pool used for asynchronous evaluation.
+*/
+
+namespace mu
+{
+	/** \brief A fixed size pool of worker threads shared by all parser instances.
+
+		The pool is created on first use. Tasks receive the index of the worker executing
+		them; the index is passed on to bulk functions as their thread id.
+	*/
+	class API_EXPORT_CXX ParserThreadPool final
+	{
+	public:
+
+		typedef std::function<void(int)> task_type;
+
+		static ParserThreadPool& Instance();
+
+		int GetNumThreads() const;
+		void Submit(task_type a_Task);
+
+	private:
+
+		ParserThreadPool& operator=(const ParserThreadPool&) = delete;
+		ParserThreadPool(const ParserThreadPool&) = delete;
+		explicit ParserThreadPool(int a_nThreads);
+
+		~ParserThreadPool();
+
+		void WorkerLoop(int a_iWorker);
+
+		std::vector<std::thread> m_vThreads;  ///< The worker threads
+		std::deque<task_type> m_Tasks;         ///< Tasks waiting for execution
+		std::mutex m_Mutex;                    ///< Guards m_Tasks and m_bStop
+		std::condition_variable m_Cond;        ///< Signals new tasks or shutdown
+		bool m_bStop;                          ///< Flag indicating the pool is shutting down
+	};
+} // namespace mu
+
+#if defined(_MSC_VER)
+	#pragma warning(pop)
+#endif
+
+#endif
@@ -53,12 +53,12 @@ namespace mu
 {
 	template <std::size_t NbParams> struct TplCallType;
 	template <> struct TplCallType<0> { using fun_type = fun_type0; using fun_userdata_type = fun_userdata_type0; using bulkfun_type = bulkfun_type0; using bulkfun_userdata_type = bulkfun_userdata_type0; };
-	template <> struct TplCallType<1> { using fun_type = fun_type1; using fun_userdata_type = fun_userdata_type1; using bulkfun_type = bulkfun_type1; using bulkfun_userdata_type = bulkfun_userdata_type1; using strfun_type = strfun_type1; using strfun_userdata_type = strfun_userdata_type1; };
-	template <> struct TplCallType<2> { using fun_type = fun_type2; using fun_userdata_type = fun_userdata_type2; using bulkfun_type = bulkfun_type2; using bulkfun_userdata_type = bulkfun_userdata_type2; using strfun_type = strfun_type2; using strfun_userdata_type = strfun_userdata_type2; };
-	template <> struct TplCallType<3> { using fun_type = fun_type3; using fun_userdata_type = fun_userdata_type3; using bulkfun_type = bulkfun_type3; using bulkfun_userdata_type = bulkfun_userdata_type3; using strfun_type = strfun_type3; using strfun_userdata_type = strfun_userdata_type3; };
-	template <> struct TplCallType<4> { using fun_type = fun_type4; using fun_userdata_type = fun_userdata_type4; using bulkfun_type = bulkfun_type4; using bulkfun_userdata_type = bulkfun_userdata_type4; using strfun_type = strfun_type4; using strfun_userdata_type = strfun_userdata_type4; };
-	template <> struct TplCallType<5> { using fun_type = fun_type5; using fun_userdata_type = fun_userdata_type5; using bulkfun_type = bulkfun_type5; using bulkfun_userdata_type = bulkfun_userdata_type5; using strfun_type = strfun_type5; using strfun_userdata_type = strfun_userdata_type5; };
-	template <> struct TplCallType<6> { using fun_type = fun_type6; using fun_userdata_type = fun_userdata_type6; using bulkfun_type = bulkfun_type6; using bulkfun_userdata_type = bulkfun_userdata_type6; using strfun_type = strfun_type6; using strfun_userdata_type = strfun_userdata_type6; };
+	template <> struct TplCallType<1> { using fun_type = fun_type1; using fun_userdata_type = fun_userdata_type1; using bulkfun_type = bulkfun_type1; using bulkfun_userdata_type = bulkfun_userdata_type1; using strfun_type = strfun_type1; using strfun_userdata_type = strfun_userdata_type1; using strhashfun_type = strhashfun_type1; using strhashfun_userdata_type = strhashfun_userdata_type1; };
+	template <> struct TplCallType<2> { using fun_type = fun_type2; using fun_userdata_type = fun_userdata_type2; using bulkfun_type = bulkfun_type2; using bulkfun_userdata_type = bulkfun_userdata_type2; using strfun_type = strfun_type2; using strfun_userdata_type = strfun_userdata_type2; using strhashfun_type = strhashfun_type2; using strhashfun_userdata_type = strhashfun_userdata_type2; };
+	template <> struct TplCallType<3> { using fun_type = fun_type3; using fun_userdata_type = fun_userdata_type3; using bulkfun_type = bulkfun_type3; using bulkfun_userdata_type = bulkfun_userdata_type3; using strfun_type = strfun_type3; using strfun_userdata_type = strfun_userdata_type3; using strhashfun_type = strhashfun_type3; using strhashfun_userdata_type = strhashfun_userdata_type3; };
+	template <> struct TplCallType<4> { using fun_type = fun_type4; using fun_userdata_type = fun_userdata_type4; using bulkfun_type = bulkfun_type4; using bulkfun_userdata_type = bulkfun_userdata_type4; using strfun_type = strfun_type4; using strfun_userdata_type = strfun_userdata_type4; using strhashfun_type = strhashfun_type4; using strhashfun_userdata_type = strhashfun_userdata_type4; };
+	template <> struct TplCallType<5> { using fun_type = fun_type5; using fun_userdata_type = fun_userdata_type5; using bulkfun_type = bulkfun_type5; using bulkfun_userdata_type = bulkfun_userdata_type5; using strfun_type = strfun_type5; using strfun_userdata_type = strfun_userdata_type5; using strhashfun_type = strhashfun_type5; using strhashfun_userdata_type = strhashfun_userdata_type5; };
+	template <> struct TplCallType<6> { using fun_type = fun_type6; using fun_userdata_type = fun_userdata_type6; using bulkfun_type = bulkfun_type6; using bulkfun_userdata_type = bulkfun_userdata_type6; using strfun_type = strfun_type6; using strfun_userdata_type = strfun_userdata_type6; using strhashfun_type = strhashfun_type6; using strhashfun_userdata_type = strhashfun_userdata_type6; };
 	template <> struct TplCallType<7> { using fun_type = fun_type7; using fun_userdata_type = fun_userdata_type7; using bulkfun_type = bulkfun_type7; using bulkfun_userdata_type = bulkfun_userdata_type7; };
 	template <> struct TplCallType<8> { using fun_type = fun_type8; using fun_userdata_type = fun_userdata_type8; using bulkfun_type = bulkfun_type8; using bulkfun_userdata_type = bulkfun_userdata_type8; };
 	template <> struct TplCallType<9> { using fun_type = fun_type9; using fun_userdata_type = fun_userdata_type9; using bulkfun_type = bulkfun_type9; using bulkfun_userdata_type = bulkfun_userdata_type9; };
@@ -127,6 +127,22 @@ namespace mu
 			}
 		}
 
+		template <std::size_t NbParams, typename... Args>
+		value_type call_strhashfun(Args&&... args) const
+		{
+			static_assert(NbParams == sizeof...(Args) - 2, "mismatch between NbParams and Args");
+			if (_pUserData == nullptr) 
+			{
+				auto strhashfun_typed_ptr = reinterpret_cast<typename TplCallType<NbParams>::strhashfun_type>(_pRawFun);
+				return (*strhashfun_typed_ptr)(std::forward<Args>(args)...);
+			} 
+			else 
+			{
+				auto strhashfun_userdata_typed_ptr = reinterpret_cast<typename TplCallType<NbParams>::strhashfun_userdata_type>(_pRawFun);
+				return (*strhashfun_userdata_typed_ptr)(_pUserData, std::forward<Args>(args)...);
+			}
+		}
+
 		bool operator==(generic_callable_type other) const 
 		{
 			return _pRawFun == other._pRawFun && _pUserData == other._pUserData; 
@@ -176,9 +192,8 @@ namespace mu
 		void* m_pTok;		///< Stores Token pointer; not applicable for all tokens
 		int  m_iIdx;		///< An otional index to an external buffer storing the token data
 		TString m_strTok;   ///< Token string
-		TString m_strVal;   ///< Value for string variables
 		value_type m_fVal;  ///< the value 
-		std::unique_ptr<ParserCallback> m_pCallback;
+		const ParserCallback* m_pCallback; ///< Callback of function and operator tokens, owned by the symbol tables of the parser
 
 	public:
 
@@ -194,9 +209,8 @@ namespace mu
 			, m_pTok(0)
 			, m_iIdx(-1)
 			, m_strTok()
-			, m_strVal()
 			, m_fVal(0)
-			, m_pCallback()
+			, m_pCallback(nullptr)
 		{}
 
 		//------------------------------------------------------------------------------
@@ -225,9 +239,16 @@ namespace mu
 			return *this;
 		}
 
+		/** \brief Move constructor, takes over the token string instead of copying it. */
+		ParserToken(ParserToken&& a_Tok) = default;
+
+		/** \brief Move assignment, takes over the token string instead of copying it. */
+		ParserToken& operator=(ParserToken&& a_Tok) = default;
+
 
 		/** \brief Copy token information from argument.
 
+			The callback is not cloned, both tokens refer to the same symbol table entry.
 			\throw nothrow
 		*/
 		void Assign(const ParserToken& a_Tok)
@@ -236,11 +257,9 @@ namespace mu
 			m_pTok = a_Tok.m_pTok;
 			m_strTok = a_Tok.m_strTok;
 			m_iIdx = a_Tok.m_iIdx;
-			m_strVal = a_Tok.m_strVal;
 			m_iType = a_Tok.m_iType;
 			m_fVal = a_Tok.m_fVal;
-			// create new callback object if a_Tok has one 
-			m_pCallback.reset(a_Tok.m_pCallback.get() ? a_Tok.m_pCallback->Clone() : 0);
+			m_pCallback = a_Tok.m_pCallback;
 		}
 
 		//------------------------------------------------------------------------------
@@ -271,7 +290,12 @@ namespace mu
 		}
 
 		//------------------------------------------------------------------------------
-		/** \brief Set Callback type. */
+		/** \brief Set Callback type. 
+		
+			The token keeps a reference to the callback. Tokens only exist while an expression 
+			is compiled and the callbacks are taken from the symbol tables of the parser, 
+			which do not change during that time.
+		*/
 		ParserToken& Set(const ParserCallback& a_pCallback, const TString& a_sTok)
 		{
 			MUP_ASSERT(a_pCallback.IsValid());
@@ -279,7 +303,7 @@ namespace mu
 			m_iCode = a_pCallback.GetCode();
 			m_iType = tpVOID;
 			m_strTok = a_sTok;
-			m_pCallback.reset(new ParserCallback(a_pCallback));
+			m_pCallback = &a_pCallback;
 
 			m_pTok = 0;
 			m_iIdx = -1;
@@ -302,7 +326,7 @@ namespace mu
 			m_iIdx = -1;
 
 			m_pTok = 0;
-			m_pCallback.reset(0);
+			m_pCallback = nullptr;
 
 			return *this;
 		}
@@ -320,7 +344,7 @@ namespace mu
 			m_strTok = a_strTok;
 			m_iIdx = -1;
 			m_pTok = (void*)a_pVar;
-			m_pCallback.reset(0);
+			m_pCallback = nullptr;
 			return *this;
 		}
 
@@ -338,7 +362,7 @@ namespace mu
 			m_iIdx = static_cast<int>(a_iSize);
 
 			m_pTok = 0;
-			m_pCallback.reset(0);
+			m_pCallback = nullptr;
 			return *this;
 		}
 
@@ -381,7 +405,7 @@ namespace mu
 		*/
 		ECmdCode GetCode() const
 		{
-			if (m_pCallback.get())
+			if (m_pCallback)
 			{
 				return m_pCallback->GetCode();
 			}
@@ -394,7 +418,7 @@ namespace mu
 		//------------------------------------------------------------------------------
 		ETypeCode GetType() const
 		{
-			if (m_pCallback.get())
+			if (m_pCallback)
 			{
 				return m_pCallback->GetType();
 			}
@@ -407,7 +431,7 @@ namespace mu
 		//------------------------------------------------------------------------------
 		int GetPri() const
 		{
-			if (!m_pCallback.get())
+			if (!m_pCallback)
 				throw ParserError(ecINTERNAL_ERROR);
 
 			if (m_pCallback->GetCode() != cmOPRT_BIN && m_pCallback->GetCode() != cmOPRT_INFIX)
@@ -419,7 +443,7 @@ namespace mu
 		//------------------------------------------------------------------------------
 		EOprtAssociativity GetAssociativity() const
 		{
-			if (m_pCallback.get() == nullptr || m_pCallback->GetCode() != cmOPRT_BIN)
+			if (m_pCallback == nullptr || m_pCallback->GetCode() != cmOPRT_BIN)
 				throw ParserError(ecINTERNAL_ERROR);
 
 			return m_pCallback->GetAssociativity();
@@ -442,7 +466,7 @@ namespace mu
 		*/
 		generic_callable_type GetFuncAddr() const
 		{
-			return (m_pCallback.get())
+			return (m_pCallback)
 				? generic_callable_type{(erased_fun_type)m_pCallback->GetAddr(),
 				                        m_pCallback->GetUserData()}
 				: generic_callable_type{};
@@ -485,7 +509,7 @@ namespace mu
 		*/
 		int GetArgCount() const
 		{
-			MUP_ASSERT(m_pCallback.get());
+			MUP_ASSERT(m_pCallback);
 
 			if (!m_pCallback->IsValid())
 				throw ParserError(ecINTERNAL_ERROR);
@@ -501,6 +525,14 @@ namespace mu
 			return m_pCallback->IsValid() && m_pCallback->IsOptimizable();
 		}
 
+		//------------------------------------------------------------------------------
+		/** \brief Return true if the token is a string function receiving the length and hash of its string argument.
+		*/
+		bool HasStrHash() const
+		{
+			return m_pCallback != nullptr && m_pCallback->HasStrHash();
+		}
+
 		//------------------------------------------------------------------------------
 		/** \brief Return the token identifier.
 
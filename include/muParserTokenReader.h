@@ -36,9 +36,12 @@
 #include <memory>
 #include <stack>
 #include <string>
+#include <vector>
 
 #include "muParserDef.h"
 #include "muParserToken.h"
+#include "muParserMemory.h"
+#include "muParserSymbolIndex.h"
 
 /** \file
 	\brief This file contains the parser token reader definition.
@@ -57,14 +60,38 @@ namespace mu
 
 		typedef ParserToken<value_type, string_type> token_type;
 
+		/** \brief A value recognition callback together with the characters a value detected by it may start with. */
+		struct SValIdent
+		{
+			identfun_type pFun;
+			string_type sFirstChars;  ///< If empty the callback is tried at every position
+		};
+
+		/** \brief A token read from the formula together with the reader state before and after reading it. */
+		struct STokenLogEntry
+		{
+			token_type Tok;
+			int iBegin;           ///< Reading position before the token, including leading white space
+			int iEnd;             ///< Reading position after the token
+			int iSynFlagsBefore;
+			int iSynFlags;
+			int nBracketsBefore;
+			int nBrackets;
+			ECmdCode eLastCodeBefore; ///< Code of the token read before this one
+		};
+
+		typedef std::stack<int, std::vector<int, ParserAllocator<int>>> bracketstack_type;
+		typedef std::vector<STokenLogEntry, ParserAllocator<STokenLogEntry>> tokenlog_type;
+
 	public:
 
 		ParserTokenReader(ParserBase* a_pParent);
 		ParserTokenReader* Clone(ParserBase* a_pParent) const;
 
-		void AddValIdent(identfun_type a_pCallback);
+		void AddValIdent(identfun_type a_pCallback, const char_type* a_szFirstChars = nullptr);
 		void SetVarCreator(facfun_type a_pFactory, void* pUserData);
 		void SetFormula(const string_type& a_strFormula);
+		void ReplaceFormula(std::size_t a_iPos, std::size_t a_iLen, const string_type& a_sText);
 		void SetArgSep(char_type cArgSep);
 
 		int GetPos() const;
@@ -73,6 +100,9 @@ namespace mu
 		char_type GetArgSep() const;
 
 		void IgnoreUndefVar(bool bIgnore);
+		void EnableSymbolIndex(bool bEnable);
+		void SetMemoryResource(ParserMemoryResource* a_pResource);
+		std::size_t GetMemoryUsage() const;
 		void ReInit();
 		token_type ReadNextToken();
 
@@ -109,6 +139,12 @@ namespace mu
 		void Assign(const ParserTokenReader& a_Reader);
 
 		void SetParent(ParserBase* a_pParent);
+		void UpdateSymbolIndex();
+		void UpdateOprtTrie();
+		void ClearTokenLog();
+		bool IsTokenLogValid() const;
+		token_type ReplayToken(const STokenLogEntry& a_Entry);
+		token_type LexNextToken();
 		int ExtractToken(const char_type* a_szCharSet, string_type& a_strTok, std::size_t a_iPos) const;
 		int ExtractOperatorToken(string_type& a_sTok, std::size_t a_iPos) const;
 
@@ -134,24 +170,53 @@ namespace mu
 		int  m_iSynFlags;
 		bool m_bIgnoreUndefVar;
 
-		const funmap_type* m_pFunDef;
-		const funmap_type* m_pPostOprtDef;
-		const funmap_type* m_pInfixOprtDef;
-		const funmap_type* m_pOprtDef;
-		const valmap_type* m_pConstDef;
-		const strmap_type* m_pStrVarDef;
+		const funtable_type* m_pFunDef;
+		const funtable_type* m_pPostOprtDef;
+		const funtable_type* m_pInfixOprtDef;
+		const funtable_type* m_pOprtDef;
+		const valtable_type* m_pConstDef;
+		const strtable_type* m_pStrVarDef;
 
-		varmap_type* m_pVarDef;  ///< The only non const pointer to parser internals
+		vartable_type* m_pVarDef;  ///< The only non const pointer to parser internals
 		facfun_type m_pFactory;
 		void* m_pFactoryData;
-		std::list<identfun_type> m_vIdentFun; ///< Value token identification function
+		std::list<SValIdent> m_vIdentFun; ///< Value token identification function
 		varmap_type m_UsedVar;
 		value_type m_fZero;      ///< Dummy value of zero, referenced by undefined variables
 		
-		std::stack<int> m_bracketStack;
+		bracketstack_type m_bracketStack;
 
 		token_type m_lastTok;
 		char_type m_cArgSep;     ///< The character used for separating function arguments
+
+		bool m_bSymbolIndex;       ///< Flag indicating that symbol lookups use hash indices instead of the symbol maps
+		bool m_bSymbolIndexValid;  ///< False if the indices must be rebuilt before their next use
+		unsigned m_nSymbolIndexVersion; ///< Symbol version of the parent parser the indices were built for
+		unsigned m_nSymbolIndexLocale;  ///< Locale version the indices were built for
+		ParserSymbolIndex<funmap_type::const_iterator> m_FunIdx;
+		ParserSymbolIndex<valmap_type::const_iterator> m_ConstIdx;
+		ParserSymbolIndex<varmap_type::const_iterator> m_VarIdx;
+		ParserSymbolIndex<strmap_type::const_iterator> m_StrVarIdx;
+
+		bool m_bOprtTrieValid;     ///< False if the operator tries must be rebuilt before their next use
+		unsigned m_nOprtTrieVersion; ///< Symbol version of the parent parser the operator tries were built for
+		unsigned m_nOprtTrieLocale;  ///< Locale version the operator tries were built for
+		ParserOprtTrie<funmap_type::const_iterator> m_OprtTrie;
+		ParserOprtTrie<funmap_type::const_iterator> m_InfixOprtTrie;
+		ParserOprtTrie<funmap_type::const_iterator> m_PostOprtTrie;
+
+		// Result of the last ExtractToken call
+		mutable const char_type* m_szExtractCharSet; ///< Charset of the last extraction, nullptr if there is none
+		mutable std::size_t m_iExtractPos;
+		mutable std::size_t m_iExtractEnd;
+
+		bool m_bTokenLog;                 ///< If true the tokens read are recorded, so that edits of the formula can reuse them
+		unsigned m_nTokenLogVersion;      ///< Symbol version of the parent parser the recorded tokens were read with
+		unsigned m_nTokenLogLocale;       ///< Locale version the recorded tokens were read with
+		tokenlog_type m_vTokenLog;        ///< Tokens from the start of the formula, replayed instead of reading them again
+		tokenlog_type m_vTokenTail;       ///< Tokens of the unchanged end of an edited formula
+		std::size_t m_nTokenLogPos;       ///< Index of the next entry of m_vTokenLog to replay
+		std::size_t m_nTokenTailPos;      ///< Index of the first entry of m_vTokenTail not yet passed by the reader
 	};
 } // namespace mu
 
@@ -27,16 +27,11 @@ namespace mu
 	{
 		value_type fVal(0);
 
-		stringstream_type stream(a_szExpr);
-		stream.seekg(0);        // todo:  check if this really is necessary
-		stream.imbue(Parser::s_locale);
-		stream >> fVal;
-		stringstream_type::pos_type iEnd = stream.tellg(); // 读取后的位置
-
-		if (iEnd == (stringstream_type::pos_type) - 1)
+		int nLen = ScanValue(a_szExpr, &fVal);
+		if (nLen == 0)
 			return 0;
 
-		*a_iPos += (int)iEnd;
+		*a_iPos += nLen;
 		*a_fVal = fVal;
 		return 1;
 	}
@@ -45,9 +40,28 @@ namespace mu
 	//---------------------------------------------------------------------------
 	/** \brief 构造函数。
 
-	  调用ParserBase类的构造函数并触发函数、操作符和常量的初始化。
+	  从内置符号的原型拷贝构造。函数、运算符和常量的符号表与原型及其他解析器共享，
+	  直到第一次定义新的符号时才复制（写时复制）。
 	*/
 	Parser::Parser()
+		:ParserBase(GetBuiltIns())
+	{
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回定义了所有内置符号的原型，它在第一次使用时创建并且不再改变。 */
+	const Parser& Parser::GetBuiltIns()
+	{
+		static const Parser s_BuiltIns{ SBuiltInTag() };
+		return s_BuiltIns;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 原型的构造函数。
+
+	  调用ParserBase类的构造函数并触发函数、操作符和常量的初始化。
+	*/
+	Parser::Parser(SBuiltInTag)
 		:ParserBase()
 	{
 		AddValIdent(IsVal);
@@ -28,17 +28,22 @@
 
 #include "muParserBase.h"
 #include "muParserTemplateMagic.h"
+#include "muParserNuma.h"
+#include "muParserThreadPool.h"
 
 //--- Standard includes ------------------------------------------------------------------------
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <deque>
 #include <sstream>
 #include <locale>
-#include <cassert>
 #include <cctype>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef MUP_USE_OPENMP
 
@@ -62,6 +67,7 @@ using namespace std;
 namespace mu
 {
 	std::locale ParserBase::s_locale = std::locale(std::locale::classic(), new change_dec_sep<char_type>('.'));
+	std::atomic<unsigned> ParserBase::s_nLocaleVersion(0);
 
 	bool ParserBase::g_DbgDumpCmdCode = false;
 	bool ParserBase::g_DbgDumpStack = false;
@@ -81,6 +87,7 @@ namespace mu
 			_T(")"), _T("?"), _T(":"), 0};
 
 	const int ParserBase::s_MaxNumOpenMPThreads = 16;
+	const int ParserBase::s_CacheLineSize = 64;
 
 	//------------------------------------------------------------------------------
 	/** \brief 构造函数。
@@ -88,7 +95,7 @@ namespace mu
 		\throw ParserException 如果 a_szFormula 为 nullptr。
 	*/
 	ParserBase::ParserBase()
-		: m_pParseFormula(&ParserBase::ParseString), m_vRPN(), m_vStringBuf(), m_pTokenReader(), m_FunDef(), m_PostOprtDef(), m_InfixOprtDef(), m_OprtDef(), m_ConstDef(), m_StrVarDef(), m_VarDef(), m_bBuiltInOp(true), m_sNameChars(), m_sOprtChars(), m_sInfixOprtChars(), m_vStackBuffer(), m_nFinalResultIdx(0)
+		: m_pParseFormula(&ParserBase::ParseString), m_pMemory(ParserMemoryResource::GetDefault()), m_pRPN(std::make_shared<ParserByteCode>()), m_pStringBuf(std::make_shared<ParserStringPool>()), m_pStringVarBuf(std::make_shared<stringbuf_type>()), m_pTokenReader(), m_FunDef(), m_PostOprtDef(), m_InfixOprtDef(), m_OprtDef(), m_ConstDef(), m_StrVarDef(), m_VarDef(), m_VarStride(), m_bBuiltInOp(true), m_bNumaBulk(false), m_bStackPadding(true), m_sNameChars(), m_sOprtChars(), m_sInfixOprtChars(), m_vStackBuffer(), m_nStackOffset(0), m_nStackStride(0), m_nStackThreads(1), m_nFinalResultIdx(0), m_vUsedNames(), m_bUsedNamesKnown(false), m_nSymbolVersion(0), m_nCompileVersion(0), m_nExprCacheMaxEntries(0), m_nExprCacheMaxBytes(0), m_ExprCache(), m_ExprCacheIdx(), m_ExprCacheStats()
 	{
 		InitTokenReader();
 	}
@@ -99,7 +106,7 @@ namespace mu
 	  解析器可以被安全地拷贝构造，但字节码在拷贝构造过程中被重置。
 	*/
 	ParserBase::ParserBase(const ParserBase &a_Parser)
-		: m_pParseFormula(&ParserBase::ParseString), m_vRPN(), m_vStringBuf(), m_pTokenReader(), m_FunDef(), m_PostOprtDef(), m_InfixOprtDef(), m_OprtDef(), m_ConstDef(), m_StrVarDef(), m_VarDef(), m_bBuiltInOp(true), m_sNameChars(), m_sOprtChars(), m_sInfixOprtChars()
+		: m_pParseFormula(&ParserBase::ParseString), m_pMemory(ParserMemoryResource::GetDefault()), m_pRPN(std::make_shared<ParserByteCode>()), m_pStringBuf(std::make_shared<ParserStringPool>()), m_pStringVarBuf(std::make_shared<stringbuf_type>()), m_pTokenReader(), m_FunDef(), m_PostOprtDef(), m_InfixOprtDef(), m_OprtDef(), m_ConstDef(), m_StrVarDef(), m_VarDef(), m_VarStride(), m_bBuiltInOp(true), m_bNumaBulk(false), m_bStackPadding(true), m_sNameChars(), m_sOprtChars(), m_sInfixOprtChars(), m_vStackBuffer(), m_nStackOffset(0), m_nStackStride(0), m_nStackThreads(1), m_nFinalResultIdx(0), m_vUsedNames(), m_bUsedNamesKnown(false), m_nSymbolVersion(0), m_nCompileVersion(0), m_nExprCacheMaxEntries(0), m_nExprCacheMaxBytes(0), m_ExprCache(), m_ExprCacheIdx(), m_ExprCacheStats()
 	{
 		m_pTokenReader.reset(new token_reader_type(this));
 		Assign(a_Parser);
@@ -141,14 +148,23 @@ namespace mu
 		// 不复制字节码，而是通过重置解析函数来导致解析器创建新的字节码。
 		ReInit();
 
+		// 缓存中的字节码引用的是旧的定义，只复制缓存的限制
+		BumpSymbolVersion();
+		ClearExprCache();
+		m_nExprCacheMaxEntries = a_Parser.m_nExprCacheMaxEntries;
+		m_nExprCacheMaxBytes = a_Parser.m_nExprCacheMaxBytes;
+
 		m_ConstDef = a_Parser.m_ConstDef; // 复制用户定义的常量
 		m_VarDef = a_Parser.m_VarDef;	  // 复制用户定义的变量
+		m_VarStride = a_Parser.m_VarStride;
 		m_bBuiltInOp = a_Parser.m_bBuiltInOp;
-		m_vStringBuf = a_Parser.m_vStringBuf;
-		m_vStackBuffer = a_Parser.m_vStackBuffer;
+		m_bNumaBulk = a_Parser.m_bNumaBulk;
+		m_bStackPadding = a_Parser.m_bStackPadding;
+		m_pStringBuf = a_Parser.m_pStringBuf;
+		m_nStackStride = 0; // 栈缓冲区在下次编译时按本对象的地址对齐
 		m_nFinalResultIdx = a_Parser.m_nFinalResultIdx;
 		m_StrVarDef = a_Parser.m_StrVarDef;
-		m_vStringVarBuf = a_Parser.m_vStringVarBuf;
+		m_pStringVarBuf = a_Parser.m_pStringVarBuf;
 		m_pTokenReader.reset(a_Parser.m_pTokenReader->Clone(this));
 
 		// 复制函数和运算符回调
@@ -175,11 +191,14 @@ namespace mu
 		\sa SetThousandsSep
 
 		默认情况下，muparser使用"C"区域设置。此区域的小数分隔符会被此处提供的分隔符覆盖。
+		区域设置由所有解析器共享，其他解析器在下次使用时会丢弃按旧分隔符读取的缓存条目和标记。
 	*/
 	void ParserBase::SetDecSep(char_type cDecSep)
 	{
 		char_type cThousandsSep = std::use_facet<change_dec_sep<char_type>>(s_locale).thousands_sep();
 		s_locale = std::locale(std::locale("C"), new change_dec_sep<char_type>(cDecSep, cThousandsSep));
+		++s_nLocaleVersion;
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -188,11 +207,14 @@ namespace mu
 		\sa SetDecSep
 
 		默认情况下，muparser使用"C"区域设置。此区域的千位分隔符会被此处提供的分隔符覆盖。
+		区域设置由所有解析器共享，其他解析器在下次使用时会丢弃按旧分隔符读取的缓存条目和标记。
 	*/
 	void ParserBase::SetThousandsSep(char_type cThousandsSep)
 	{
 		char_type cDecSep = std::use_facet<change_dec_sep<char_type>>(s_locale).decimal_point();
 		s_locale = std::locale(std::locale("C"), new change_dec_sep<char_type>(cDecSep, cThousandsSep));
+		++s_nLocaleVersion;
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -203,6 +225,7 @@ namespace mu
 	void ParserBase::ResetLocale()
 	{
 		s_locale = std::locale(std::locale("C"), new change_dec_sep<char_type>('.'));
+		++s_nLocaleVersion;
 		SetArgSep(',');
 	}
 
@@ -228,22 +251,291 @@ namespace mu
 	void ParserBase::ReInit() const
 	{
 		m_pParseFormula = &ParserBase::ParseString;
-		m_vStringBuf.clear();
-		m_vRPN.clear();
+
+		// 字节码和字符串参数可能与克隆共享，此时换用新的对象而不是清空共享的对象
+		if (m_pRPN.use_count() > 1)
+			m_pRPN = NewByteCode();
+		else
+			m_pRPN->clear();
+
+		if (m_pStringBuf.use_count() > 1)
+			m_pStringBuf = std::make_shared<ParserStringPool>(m_pMemory);
+		else
+			m_pStringBuf->clear();
+
+		m_vUsedNames.clear();
+		m_bUsedNamesKnown = false;
 		m_pTokenReader->ReInit();
 	}
 
+	//---------------------------------------------------------------------------
+	/** \brief 创建一个空的字节码，其内存取自解析器的内存资源。
+
+		优化器的设置与当前字节码相同。
+	*/
+	std::shared_ptr<ParserByteCode> ParserBase::NewByteCode() const
+	{
+		std::shared_ptr<ParserByteCode> pRPN = std::allocate_shared<ParserByteCode>(ParserAllocator<ParserByteCode>(m_pMemory), m_pMemory);
+		pRPN->EnableOptimizer(m_pRPN->IsOptimizerEnabled());
+		return pRPN;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 为当前字节码准备至少 a_nThreads 个线程的计算栈。
+
+		每个线程的栈从缓存行的起始位置开始，长度填充为缓存行的整数倍，因此相邻线程的
+		栈顶不会位于同一缓存行上（伪共享）。栈的个数按实际的工作线程数增长，栈的大小
+		不变且线程数没有增加时不分配内存。禁用填充时（参见 EnableStackPadding）栈按最大深度紧密排列。
+		\param a_nThreads 需要的栈的个数
+	*/
+	void ParserBase::ReserveStacks(int a_nThreads) const
+	{
+		const std::size_t nLine = m_bStackPadding ? std::max<std::size_t>(s_CacheLineSize / sizeof(value_type), 1) : 1;
+		const std::size_t nStride = std::max<std::size_t>((m_pRPN->GetMaxStackSize() + nLine - 1) / nLine, 1) * nLine;
+		if (nStride == m_nStackStride && a_nThreads <= m_nStackThreads)
+			return;
+
+		m_nStackThreads = std::max(a_nThreads, m_nStackThreads);
+		m_nStackStride = nStride;
+
+		// 多出的一个缓存行用于把第一个栈对齐到缓存行的起始位置
+		m_vStackBuffer.resize(nStride * m_nStackThreads + nLine);
+		std::uintptr_t nMisalign = reinterpret_cast<std::uintptr_t>(&m_vStackBuffer[0]) % s_CacheLineSize;
+		m_nStackOffset = (m_bStackPadding && nMisalign != 0) ? (s_CacheLineSize - nMisalign) / sizeof(value_type) : 0;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回给定线程的计算栈。
+		\pre 已经为至少 a_iThread+1 个线程调用过 ReserveStacks。
+	*/
+	value_type* ParserBase::GetStack(int a_iThread) const
+	{
+		MUP_ASSERT(a_iThread >= 0 && a_iThread < m_nStackThreads);
+		return &m_vStackBuffer[m_nStackOffset + a_iThread * m_nStackStride];
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 设置字节码以及编译所用缓冲区的内存资源。
+
+		与 std::pmr 类似，内存资源由调用者拥有，必须比解析器以及共享其字节码的克隆存活得更久。
+		使用 ParserArenaResource 时，编译产生的所有内存在解析器销毁之后通过一次 Release 即可释放。
+
+		符号表、变量表、表达式缓存以及字符串本身的内容仍使用默认的堆；拷贝、克隆和
+		CompileBatch 的工作副本使用默认的内存资源。当前表达式会在下次求值时重新编译。
+		\param a_pResource 内存资源，nullptr 表示恢复默认的资源。
+	*/
+	void ParserBase::SetMemoryResource(ParserMemoryResource* a_pResource)
+	{
+		m_pMemory = (a_pResource != nullptr) ? a_pResource : ParserMemoryResource::GetDefault();
+
+		// 移动赋值会传播分配器，因此用新资源构造的空容器替换旧的容器
+		ParserAllocator<int> alloc(m_pMemory);
+		m_pRPN = NewByteCode();
+		m_pStringBuf = std::make_shared<ParserStringPool>(m_pMemory);
+		m_vUsedNames = stringbuf_type(alloc);
+		m_vStackBuffer = valbuf_type(alloc);
+		m_nStackStride = 0;
+		m_vCompileTok = tokenbuf_type(alloc);
+		m_stCompileOpt = tokenstack_type(tokenstack_type::container_type(alloc));
+		m_stCompileVal = tokenstack_type(tokenstack_type::container_type(alloc));
+		m_stCompileArgCount = argstack_type(argstack_type::container_type(alloc));
+		m_pTokenReader->SetMemoryResource(m_pMemory);
+		ReInit();
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回字节码以及编译所用缓冲区的内存资源。 */
+	ParserMemoryResource* ParserBase::GetMemoryResource() const
+	{
+		return m_pMemory;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 使所有根据当前定义编译的字节码失效。
+
+		每个改变运算符、词法设置或其他全局设置的函数都必须调用此函数（随后调用 ReInit），
+		以便表达式缓存不再返回根据旧定义编译的字节码。只改变单个名称的函数使用 InvalidateSymbol。
+	*/
+	void ParserBase::BumpSymbolVersion()
+	{
+		++m_nSymbolVersion;
+		++m_nCompileVersion;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 某些符号的定义将要改变，只使依赖这些符号的字节码失效。
+		\param a_IsChanged 对每个被依赖的符号名称调用，返回 true 表示该符号改变了。
+
+		当前表达式只有在使用了改变的符号时（或者它的依赖未知时，例如由 LoadByteCode 加载的字节码）
+		才被重置为字符串解析模式。表达式缓存中依赖改变的符号的条目被删除，其余条目保持有效。
+	*/
+	void ParserBase::InvalidateSymbols(const std::function<bool(const string_type &)> &a_IsChanged)
+	{
+		++m_nSymbolVersion;
+
+		auto dependsOnChange = [&a_IsChanged](const stringbuf_type &a_vNames)
+		{
+			return std::any_of(a_vNames.begin(), a_vNames.end(), a_IsChanged);
+		};
+
+		if (!m_bUsedNamesKnown || dependsOnChange(m_vUsedNames))
+			ReInit();
+
+		for (exprcache_type::iterator item = m_ExprCache.begin(); item != m_ExprCache.end();)
+		{
+			if (dependsOnChange(item->vUsedNames))
+			{
+				m_ExprCacheStats.nBytes -= item->nBytes;
+				--m_ExprCacheStats.nEntries;
+				m_ExprCacheIdx.erase(item->sExpr);
+				item = m_ExprCache.erase(item);
+			}
+			else
+				++item;
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 名称为 a_sName 的符号将要改变，只使依赖它的字节码失效。 */
+	void ParserBase::InvalidateSymbol(const string_type &a_sName)
+	{
+		InvalidateSymbols([&a_sName](const string_type &sName) { return sName == a_sName; });
+	}
+
 	//---------------------------------------------------------------------------
 	void ParserBase::OnDetectVar(string_type * /*pExpr*/, int & /*nStart*/, int & /*nEnd*/)
 	{
 	}
 
+	//---------------------------------------------------------------------------
+	/** \brief 不使用流读取表达式开头的浮点数。
+		\param [in] a_szExpr 指向数值第一个字符的指针。
+		\param [out] a_fVal 读取到的值。
+		\return 数值占用的字符数，如果不是数值则返回 0。
+
+		接受的格式与使用 #s_locale 的流相同：可选的符号、数字、小数分隔符、小数部分和指数。
+		尾数不超过 2^53 并且十进制指数不超过 22 时直接用一次浮点乘法或除法得到精确舍入的结果（Clinger 快速路径），
+		否则使用 "C" 区域设置的流转换规范化的数字字符串。包含千位分隔符的数值仍然完全由流读取。
+	*/
+	int ParserBase::ScanValue(const char_type *a_szExpr, value_type *a_fVal)
+	{
+		static const double fPow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+		const std::numpunct<char_type> &punct = std::use_facet<std::numpunct<char_type>>(s_locale);
+		const char_type cDecSep = punct.decimal_point();
+		const char_type cThousandsSep = punct.thousands_sep();
+
+		const char_type *p = a_szExpr;
+		bool bNeg = false;
+		if (*p == '+' || *p == '-')
+			bNeg = (*p++ == '-');
+
+		unsigned long long nMant = 0;
+		int nExp10 = 0;
+		bool bDigits = false, bExact = true;
+
+		// 整数部分，尾数放不下的数字只计入指数
+		for (; *p >= '0' && *p <= '9'; ++p)
+		{
+			bDigits = true;
+			if (nMant <= (ULLONG_MAX - 9) / 10)
+				nMant = nMant * 10 + (*p - '0');
+			else
+			{
+				++nExp10;
+				bExact &= (*p == '0');
+			}
+		}
+
+		bool bLegacy = (cThousandsSep != 0 && bDigits && *p == cThousandsSep);
+
+		// 小数部分
+		if (!bLegacy && *p == cDecSep)
+		{
+			for (++p; *p >= '0' && *p <= '9'; ++p)
+			{
+				bDigits = true;
+				if (nMant <= (ULLONG_MAX - 9) / 10)
+				{
+					nMant = nMant * 10 + (*p - '0');
+					--nExp10;
+				}
+				else
+					bExact &= (*p == '0');
+			}
+		}
+
+		if (!bDigits)
+			return 0;
+
+		// 指数部分，流在 'e' 之后没有数字时会失败
+		if (!bLegacy && (*p == 'e' || *p == 'E'))
+		{
+			const char_type *q = p + 1;
+			bool bNegExp = false;
+			if (*q == '+' || *q == '-')
+				bNegExp = (*q++ == '-');
+
+			if (*q < '0' || *q > '9')
+				return 0;
+
+			int nExp = 0;
+			for (; *q >= '0' && *q <= '9'; ++q)
+				nExp = (nExp < 100000) ? nExp * 10 + (*q - '0') : nExp;
+
+			nExp10 += bNegExp ? -nExp : nExp;
+			p = q;
+		}
+
+		int nLen = (int)(p - a_szExpr);
+
+		if (!bLegacy && bExact && nMant <= (1ULL << 53) && nExp10 >= -22 && nExp10 <= 22)
+		{
+			double fVal = (double)nMant;
+			fVal = (nExp10 < 0) ? fVal / fPow10[-nExp10] : fVal * fPow10[nExp10];
+			*a_fVal = (value_type)(bNeg ? -fVal : fVal);
+			return nLen;
+		}
+
+		if (!bLegacy)
+		{
+			// 把数值规范化为 "C" 区域设置的格式后再转换
+			std::string sNum(nLen, ' ');
+			for (int i = 0; i < nLen; ++i)
+				sNum[i] = (a_szExpr[i] == cDecSep) ? '.' : (char)a_szExpr[i];
+
+			std::istringstream stream(sNum);
+			stream.imbue(std::locale::classic());
+			value_type fVal(0);
+			stream >> fVal;
+			if (stream.fail())
+				return 0;
+
+			*a_fVal = fVal;
+			return nLen;
+		}
+
+		// 带有千位分隔符的数值，由流负责检查分组
+		stringstream_type stream(a_szExpr);
+		stream.imbue(s_locale);
+		value_type fVal(0);
+		stream >> fVal;
+		stringstream_type::pos_type iEnd = stream.tellg();
+		if (iEnd == (stringstream_type::pos_type)-1)
+			return 0;
+
+		*a_fVal = fVal;
+		return (int)iEnd;
+	}
+
 	//---------------------------------------------------------------------------
 	/** \brief 返回当前表达式的字节码。
 	 */
 	const ParserByteCode &ParserBase::GetByteCode() const
 	{
-		return m_vRPN;
+		return *m_pRPN;
 	}
 
 	//---------------------------------------------------------------------------
@@ -302,10 +594,13 @@ namespace mu
 	/** \brief 添加值解析函数。
 			在解析表达式时，muParser尝试使用不同的有效回调函数来检测表达式字符串中的值。
 		因此，可以解析十六进制值、二进制值和浮点值。
+		\param a_pCallback 值识别回调函数。
+		\param a_szFirstChars 值可能的首字符集合。如果不为空，则只在以这些字符之一开头的位置调用回调函数。
 	*/
-	void ParserBase::AddValIdent(identfun_type a_pCallback)
+	void ParserBase::AddValIdent(identfun_type a_pCallback, const char_type* a_szFirstChars)
 	{
-		m_pTokenReader->AddValIdent(a_pCallback);
+		m_pTokenReader->AddValIdent(a_pCallback, a_szFirstChars);
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -316,6 +611,7 @@ namespace mu
 	void ParserBase::SetVarFactory(facfun_type a_pFactory, void *pUserData)
 	{
 		m_pTokenReader->SetVarCreator(a_pFactory, pUserData);
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -323,13 +619,13 @@ namespace mu
 	void ParserBase::AddCallback(
 		const string_type &a_strName,
 		const ParserCallback &a_Callback,
-		funmap_type &a_Storage,
+		funtable_type &a_Storage,
 		const char_type *a_szCharSet)
 	{
 		if (!a_Callback.IsValid())
 			Error(ecINVALID_FUN_PTR);
 
-		const funmap_type *pFunMap = &a_Storage;
+		const funtable_type *pFunMap = &a_Storage;
 
 		// 检查运算符或函数名是否冲突
 		if (pFunMap != &m_FunDef && m_FunDef.find(a_strName) != m_FunDef.end())
@@ -345,8 +641,19 @@ namespace mu
 			Error(ecNAME_CONFLICT, -1, a_strName);
 
 		CheckOprt(a_strName, a_Callback, a_szCharSet);
+
+		// 函数名只影响使用它的表达式，运算符可能改变任何表达式的分词结果
+		if (&a_Storage == &m_FunDef)
+		{
+			InvalidateSymbol(a_strName);
+		}
+		else
+		{
+			BumpSymbolVersion();
+			ReInit();
+		}
+
 		a_Storage[a_strName] = a_Callback;
-		ReInit();
 	}
 
 	//---------------------------------------------------------------------------
@@ -377,37 +684,718 @@ namespace mu
 		}
 	}
 
-	/** \brief 检查名称是否包含无效字符。
-		\throw ParserException 如果名称包含无效字符。
+	/** \brief 检查名称是否包含无效字符。
+		\throw ParserException 如果名称包含无效字符。
+	*/
+	void ParserBase::CheckName(const string_type &a_sName, const string_type &a_szCharSet) const
+	{
+		if (!a_sName.length() ||
+			(a_sName.find_first_not_of(a_szCharSet) != string_type::npos) ||
+			(a_sName[0] >= '0' && a_sName[0] <= '9'))
+		{
+			Error(ecINVALID_NAME);
+		}
+	}
+
+	/** \brief 检查区域设置兼容性：参数分隔符不能与小数点相同。
+		\throw ParserException 如果参数分隔符与小数点相同。
+	*/
+	void ParserBase::CheckLocale() const
+	{
+		if (m_pTokenReader->GetArgSep() == std::use_facet<numpunct<char_type>>(s_locale).decimal_point())
+			Error(ecLOCALE);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 设置公式。
+		\param a_strFormula 公式字符串
+		\throw ParserException 如果存在语法错误。
+
+		首次计算，创建字节码并扫描使用的变量。
+		如果启用了表达式缓存并且缓存中有根据当前定义编译的同一表达式，则直接使用缓存的字节码，跳过编译。
+	*/
+	void ParserBase::SetExpr(const string_type &a_sExpr)
+	{
+		CheckLocale();
+
+		// 检查允许的最大表达式长度。一个足够小的任意值，以便我可以调试发送给我的表达式
+		if (a_sExpr.length() >= MaxLenExpression)
+			Error(ecEXPRESSION_TOO_LONG, 0, a_sExpr);
+
+		m_pTokenReader->SetFormula(a_sExpr + _T(" "));
+		ReInit();
+
+		if (m_nExprCacheMaxEntries > 0)
+			FetchFromExprCache(a_sExpr);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 替换当前表达式的一部分。
+		\param a_iPos 第一个被替换的字符的位置。
+		\param a_iLen 被替换的字符数目。
+		\param a_sText 替换的文本。
+		\throw ParserException 如果替换的范围超出表达式、新的表达式太长，或者参数分隔符与小数点相同。
+
+		结果与用编辑后的表达式调用 SetExpr 相同，但是适用于交互式编辑：词法分析器记录读取的 token，
+		下一次编译时编辑位置前后没有改变的 token 直接重放，只有受编辑影响的部分被重新分词。
+		因此编辑长表达式后重新编译的时间主要取决于编辑的大小，而不是表达式的长度。
+		与 SetExpr 一样，语法错误在下一次求值时报告。
+	*/
+	void ParserBase::ReplaceRange(std::size_t a_iPos, std::size_t a_iLen, const string_type &a_sText)
+	{
+		CheckLocale();
+
+		const string_type &sFormula = m_pTokenReader->GetExpr();
+		const std::size_t nExprLen = sFormula.empty() ? 0 : sFormula.length() - 1; // 不计 SetExpr 附加的空格
+		if (a_iPos > nExprLen || a_iLen > nExprLen - a_iPos)
+			Error(ecEDIT_OUT_OF_RANGE, (int)a_iPos);
+
+		// 还没有设置表达式
+		if (sFormula.empty())
+		{
+			SetExpr(a_sText);
+			return;
+		}
+
+		if (nExprLen - a_iLen + a_sText.length() >= MaxLenExpression)
+			Error(ecEXPRESSION_TOO_LONG, 0, a_sText);
+
+		m_pTokenReader->ReplaceFormula(a_iPos, a_iLen, a_sText);
+		ReInit();
+
+		if (m_nExprCacheMaxEntries > 0)
+			FetchFromExprCache(sFormula.substr(0, sFormula.length() - 1));
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 启用或禁用已编译表达式的缓存。
+		\param a_nMaxEntries 缓存的最大表达式数目，0 表示禁用缓存并清空它。
+		\param a_nMaxBytes 缓存占用内存的上限（近似值，单位字节），0 表示不限制。
+
+		缓存以表达式字符串为键保存最终的字节码。改变运算符或词法设置的调用使所有条目失效，
+		重新定义或删除变量、函数和常量只删除使用了这些名称的条目。超过限制时丢弃最久未使用的条目。
+	*/
+	void ParserBase::EnableExprCache(std::size_t a_nMaxEntries, std::size_t a_nMaxBytes)
+	{
+		m_nExprCacheMaxEntries = a_nMaxEntries;
+		m_nExprCacheMaxBytes = a_nMaxBytes;
+		TrimExprCache(0, 0);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 清空表达式缓存。统计计数器保持不变。 */
+	void ParserBase::ClearExprCache()
+	{
+		m_ExprCache.clear();
+		m_ExprCacheIdx.clear();
+		m_ExprCacheStats.nEntries = 0;
+		m_ExprCacheStats.nBytes = 0;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回表达式缓存的命中、未命中和淘汰计数以及当前的大小。 */
+	ParserBase::SExprCacheStats ParserBase::GetExprCacheStats() const
+	{
+		return m_ExprCacheStats;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回解析器占用的内存，按组成部分分列。
+
+		结果是估计值，标准容器的管理开销是近似的。与其他解析器共享的符号表和字节码
+		（例如克隆之间）单独列出，不计入总量。字节码的大小为 ParserByteCode::GetSize() 
+		乘以 sizeof(SToken)。
+	*/
+	ParserBase::SMemoryUsage ParserBase::GetMemoryUsage() const
+	{
+		SMemoryUsage usage = {};
+
+		const std::size_t nTables[] = {
+			GetMapHeapSize(m_FunDef.Get()),
+			GetMapHeapSize(m_PostOprtDef.Get()),
+			GetMapHeapSize(m_InfixOprtDef.Get()),
+			GetMapHeapSize(m_OprtDef.Get()),
+			GetMapHeapSize(m_ConstDef.Get()),
+			GetMapHeapSize(m_StrVarDef.Get()),
+			GetMapHeapSize(m_VarDef.Get()) };
+		const bool bShared[] = {
+			m_FunDef.IsShared(),
+			m_PostOprtDef.IsShared(),
+			m_InfixOprtDef.IsShared(),
+			m_OprtDef.IsShared(),
+			m_ConstDef.IsShared(),
+			m_StrVarDef.IsShared(),
+			m_VarDef.IsShared() };
+
+		for (std::size_t i = 0; i < sizeof(bShared) / sizeof(bShared[0]); ++i)
+		{
+			if (bShared[i])
+				usage.nSharedSymbols += nTables[i];
+			else
+				usage.nSymbols += nTables[i];
+		}
+
+		usage.nSymbols += GetMapHeapSize(m_VarStride);
+
+		usage.nTokenReader = m_pTokenReader->GetMemoryUsage();
+
+		// 编译器的缓冲区保留上一次编译的容量，令牌在编译结束时已被清除
+		usage.nCompiler = m_vCompileTok.capacity() * sizeof(token_type)
+			+ GetStackHeapSize(m_stCompileOpt)
+			+ GetStackHeapSize(m_stCompileVal)
+			+ GetStackHeapSize(m_stCompileArgCount);
+
+		// 字符串常量的值与符号表一样可能与其他解析器共享
+		std::size_t nStringVars = sizeof(stringbuf_type) + m_pStringVarBuf->capacity() * sizeof(string_type);
+		for (const auto& str : *m_pStringVarBuf)
+			nStringVars += GetHeapSize(str);
+
+		if (m_pStringVarBuf.use_count() > 1)
+			usage.nSharedSymbols += nStringVars;
+		else
+			usage.nStrings += nStringVars;
+
+		usage.nStrings += m_vUsedNames.capacity() * sizeof(string_type);
+		for (const auto& str : m_vUsedNames)
+			usage.nStrings += GetHeapSize(str);
+
+		// 字节码和它的字符串参数可能与克隆共享，直到其中一个重新编译
+		std::size_t nByteCode = sizeof(ParserByteCode) + m_pRPN->GetSize() * sizeof(SToken);
+		if (m_pRPN.use_count() > 1)
+			usage.nSharedByteCode += nByteCode;
+		else
+			usage.nByteCode += nByteCode;
+
+		if (m_pStringBuf.use_count() > 1)
+			usage.nSharedByteCode += m_pStringBuf->GetMemoryUsage();
+		else
+			usage.nStrings += m_pStringBuf->GetMemoryUsage();
+
+		usage.nStack = m_vStackBuffer.capacity() * sizeof(value_type);
+
+		usage.nExprCache = m_ExprCacheStats.nBytes + GetMapHeapSize(m_ExprCacheIdx);
+
+		usage.nTotal = sizeof(*this) 
+			+ usage.nSymbols 
+			+ usage.nTokenReader 
+			+ usage.nCompiler 
+			+ usage.nStrings 
+			+ usage.nByteCode 
+			+ usage.nStack 
+			+ usage.nExprCache;
+
+		return usage;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 在缓存中查找当前表达式并恢复其字节码。
+		\return 如果找到了有效的条目则返回 true。
+
+		在改变全局设置之前编译的条目会被删除并计为未命中。
+	*/
+	bool ParserBase::FetchFromExprCache(const string_type &a_sExpr)
+	{
+		auto it = m_ExprCacheIdx.find(a_sExpr);
+		if (it == m_ExprCacheIdx.end())
+		{
+			++m_ExprCacheStats.nMisses;
+			return false;
+		}
+
+		exprcache_type::iterator item = it->second;
+		if (item->nCompileVersion != m_nCompileVersion || item->nLocaleVersion != s_nLocaleVersion)
+		{
+			m_ExprCacheStats.nBytes -= item->nBytes;
+			--m_ExprCacheStats.nEntries;
+			m_ExprCacheIdx.erase(it);
+			m_ExprCache.erase(item);
+			++m_ExprCacheStats.nMisses;
+			return false;
+		}
+
+		// 移到链表头部，标记为最近使用
+		m_ExprCache.splice(m_ExprCache.begin(), m_ExprCache, item);
+		++m_ExprCacheStats.nHits;
+
+		m_pRPN = NewByteCode();
+		*m_pRPN = item->vRPN;
+		*m_pStringBuf = item->vStringBuf;
+		m_vUsedNames = item->vUsedNames;
+		m_bUsedNamesKnown = true;
+		m_nFinalResultIdx = item->nFinalResultIdx;
+		ReserveStacks(1);
+		m_pParseFormula = (m_pRPN->GetSize() == 2) ? &ParserBase::ParseCmdCodeShort : &ParserBase::ParseCmdCode;
+		return true;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 把刚刚编译好的字节码存入表达式缓存。 */
+	void ParserBase::AddToExprCache() const
+	{
+		// 依赖未知的字节码无法按名称失效，不能放入缓存
+		if (m_nExprCacheMaxEntries == 0 || !m_bUsedNamesKnown)
+			return;
+
+		// SetExpr 在公式末尾附加了一个空格
+		const string_type &sFormula = m_pTokenReader->GetExpr();
+		string_type sExpr = sFormula.substr(0, sFormula.length() - 1);
+
+		std::size_t nBytes = sizeof(SExprCacheEntry) + sExpr.length() * sizeof(char_type) + m_pRPN->GetSize() * sizeof(SToken);
+		for (const auto &str : *m_pStringBuf)
+			nBytes += sizeof(string_type) + str.length() * sizeof(char_type);
+		for (const auto &str : m_vUsedNames)
+			nBytes += sizeof(string_type) + str.length() * sizeof(char_type);
+
+		if (m_nExprCacheMaxBytes > 0 && nBytes > m_nExprCacheMaxBytes)
+			return;
+
+		auto it = m_ExprCacheIdx.find(sExpr);
+		if (it != m_ExprCacheIdx.end())
+		{
+			m_ExprCacheStats.nBytes -= it->second->nBytes;
+			--m_ExprCacheStats.nEntries;
+			m_ExprCache.erase(it->second);
+			m_ExprCacheIdx.erase(it);
+		}
+
+		// 为新条目腾出空间
+		TrimExprCache(1, nBytes);
+
+		SExprCacheEntry entry;
+		entry.sExpr = sExpr;
+		entry.nCompileVersion = m_nCompileVersion;
+		entry.nLocaleVersion = s_nLocaleVersion;
+		entry.vRPN = *m_pRPN;
+		entry.vStringBuf = *m_pStringBuf;
+		entry.vUsedNames = m_vUsedNames;
+		entry.nFinalResultIdx = m_nFinalResultIdx;
+		entry.nBytes = nBytes;
+
+		m_ExprCache.push_front(entry);
+		m_ExprCacheIdx[sExpr] = m_ExprCache.begin();
+		++m_ExprCacheStats.nEntries;
+		m_ExprCacheStats.nBytes += nBytes;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 丢弃最久未使用的条目，直到缓存能在不超过限制的情况下再容纳给定的条目。
+		\param a_nNewEntries 需要腾出的条目数。
+		\param a_nNewBytes 需要腾出的字节数。
+	*/
+	void ParserBase::TrimExprCache(std::size_t a_nNewEntries, std::size_t a_nNewBytes) const
+	{
+		while (m_ExprCache.size() &&
+			  (m_ExprCache.size() + a_nNewEntries > m_nExprCacheMaxEntries ||
+			  (m_nExprCacheMaxBytes > 0 && m_ExprCacheStats.nBytes + a_nNewBytes > m_nExprCacheMaxBytes)))
+		{
+			const SExprCacheEntry &item = m_ExprCache.back();
+			m_ExprCacheStats.nBytes -= item.nBytes;
+			--m_ExprCacheStats.nEntries;
+			m_ExprCacheIdx.erase(item.sExpr);
+			m_ExprCache.pop_back();
+			++m_ExprCacheStats.nEvictions;
+		}
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 在解析器的符号表中查找字节码引用的变量和回调函数。
+
+		保存时把地址转换为名称，加载时把名称转换为加载解析器中的地址。地址到名称的反向索引在第一次查找时
+		建立一次，因此保存的开销与符号表的大小无关。同一个对象可以用于多次保存，只要解析器的符号表保持不变。
+	*/
+	class ParserBase::ByteCodeSymbols final : public ParserByteCodeSymbols
+	{
+	public:
+		explicit ByteCodeSymbols(const ParserBase &a_Parser)
+			: m_Parser(a_Parser)
+			, m_VarName()
+			, m_CallbackName()
+			, m_bVarIndex(false)
+			, m_bCallbackIndex(false)
+		{}
+
+		bool FindVarName(const value_type *a_pVar, string_type &a_sName) const override
+		{
+			if (!m_bVarIndex)
+			{
+				// 多个名称共用一个地址时保留第一个名称
+				for (const auto &item : m_Parser.m_VarDef)
+					m_VarName.emplace(item.second, item.first);
+
+				m_bVarIndex = true;
+			}
+
+			auto item = m_VarName.find(a_pVar);
+			if (item == m_VarName.end())
+				return false;
+
+			a_sName = item->second;
+			return true;
+		}
+
+		value_type *GetVarAddr(const string_type &a_sName, std::ptrdiff_t &a_iStride) const override
+		{
+			varmap_type::const_iterator item = m_Parser.m_VarDef.find(a_sName);
+			if (item == m_Parser.m_VarDef.end())
+				return nullptr;
+
+			a_iStride = m_Parser.GetVarStride(a_sName);
+			return item->second;
+		}
+
+		bool FindCallbackName(const generic_callable_type &a_Fun, int &a_iTable, string_type &a_sName) const override
+		{
+			if (!m_bCallbackIndex)
+			{
+				// 按表的顺序插入，同一个回调函数出现在多个表中时保留第一个
+				for (int iTable = ctFUN; iTable <= ctOPRT_POSTFIX; ++iTable)
+				{
+					for (const auto &item : GetTable(iTable))
+						m_CallbackName.emplace(callback_key((erased_fun_type)item.second.GetAddr(), item.second.GetUserData()), std::make_pair(iTable, item.first));
+				}
+
+				m_bCallbackIndex = true;
+			}
+
+			auto item = m_CallbackName.find(callback_key(a_Fun._pRawFun, a_Fun._pUserData));
+			if (item == m_CallbackName.end())
+				return false;
+
+			a_iTable = item->second.first;
+			a_sName = item->second.second;
+			return true;
+		}
+
+		const ParserCallback *GetCallback(int a_iTable, const string_type &a_sName) const override
+		{
+			if (a_iTable < ctFUN || a_iTable > ctOPRT_POSTFIX)
+				return nullptr;
+
+			const funtable_type &table = GetTable(a_iTable);
+			funmap_type::const_iterator item = table.find(a_sName);
+			return (item != table.end()) ? &item->second : nullptr;
+		}
+
+	private:
+		typedef std::pair<erased_fun_type, void *> callback_key;
+
+		const funtable_type &GetTable(int a_iTable) const
+		{
+			switch (a_iTable)
+			{
+			case ctOPRT_BIN:	 return m_Parser.m_OprtDef;
+			case ctOPRT_INFIX:	 return m_Parser.m_InfixOprtDef;
+			case ctOPRT_POSTFIX: return m_Parser.m_PostOprtDef;
+			default:			 return m_Parser.m_FunDef;
+			}
+		}
+
+		const ParserBase &m_Parser;
+		mutable std::map<const value_type *, string_type> m_VarName;
+		mutable std::map<callback_key, std::pair<int, string_type>> m_CallbackName;
+		mutable bool m_bVarIndex;
+		mutable bool m_bCallbackIndex;
+	};
+
+	// 序列化字节码的文件头：标识、格式版本、字符和数值类型的大小、数据长度和校验和
+	static const std::uint32_t c_nByteCodeMagic = 0x4342756d; // "muBC"
+	static const std::uint32_t c_nByteCodeVersion = 1;
+	static const std::size_t c_nByteCodeHeaderSize = 2 * sizeof(std::uint32_t) + 2 * sizeof(std::uint8_t) + 2 * sizeof(std::uint64_t);
+	static const std::uint64_t c_nByteCodeMaxSize = (std::uint64_t)MaxLenExpression * 1024;
+
+	/** \brief 计算序列化数据的 64 位 FNV-1a 校验和。 */
+	static std::uint64_t ByteCodeHash(const char *a_pData, std::size_t a_nSize)
+	{
+		std::uint64_t nHash = 14695981039346656037ULL;
+		for (std::size_t i = 0; i < a_nSize; ++i)
+		{
+			nHash ^= (unsigned char)a_pData[i];
+			nHash *= 1099511628211ULL;
+		}
+
+		return nHash;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 把当前表达式的字节码写入二进制数据流。
+		\param a_Stream 以二进制模式打开的目标数据流
+		\throw ParserError 如果表达式有语法错误。
+
+		尚未编译的表达式先被编译。每次调用写入一条独立的记录，因此多个表达式可以依次写入同一个数据流，
+		再用同样多次的 LoadByteCode 调用读回。变量和回调函数按名称保存，字符串参数按内容保存。
+		记录包含格式版本和校验和，数据使用本机的字节序和数值格式。
+	*/
+	void ParserBase::SaveByteCode(std::ostream &a_Stream) const
+	{
+		SaveByteCode(a_Stream, ByteCodeSymbols(*this));
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 使用给定的符号索引写入当前表达式的字节码。
+
+		连续保存多个表达式的调用者（例如 CompileBatch）可以共用一个索引，只建立一次反向索引。
+	*/
+	void ParserBase::SaveByteCode(std::ostream &a_Stream, const ByteCodeSymbols &a_Symbols) const
+	{
+		Compile();
+
+		// SetExpr 在公式末尾附加了一个空格
+		const string_type &sFormula = m_pTokenReader->GetExpr();
+
+		std::ostringstream osData;
+		ParserByteCode::WriteString(osData, sFormula.substr(0, sFormula.length() - 1));
+		m_pRPN->Save(osData, a_Symbols);
+		ParserByteCode::WriteBinary<std::uint32_t>(osData, (std::uint32_t)m_pStringBuf->size());
+		for (const auto &str : *m_pStringBuf)
+			ParserByteCode::WriteString(osData, str);
+		ParserByteCode::WriteBinary<std::int32_t>(osData, m_nFinalResultIdx);
+
+		const std::string sData = osData.str();
+		ParserByteCode::WriteBinary(a_Stream, c_nByteCodeMagic);
+		ParserByteCode::WriteBinary(a_Stream, c_nByteCodeVersion);
+		ParserByteCode::WriteBinary<std::uint8_t>(a_Stream, sizeof(char_type));
+		ParserByteCode::WriteBinary<std::uint8_t>(a_Stream, sizeof(value_type));
+		ParserByteCode::WriteBinary<std::uint64_t>(a_Stream, sData.size());
+		ParserByteCode::WriteBinary<std::uint64_t>(a_Stream, ByteCodeHash(sData.data(), sData.size()));
+		a_Stream.write(sData.data(), sData.size());
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 从二进制数据流读取 SaveByteCode 写入的一条记录并把它设置为当前表达式。
+		\param a_Stream 以二进制模式打开的源数据流
+		\throw ParserError 如果数据损坏或版本不兼容（ecINVALID_BYTECODE），或者字节码使用的变量或函数
+		                   在本解析器中未定义或签名不同（ecBYTECODE_SYMBOL_MISMATCH）。
+
+		变量地址、变量步长和回调函数根据本解析器当前的符号表重新定位，表达式无需重新编译。
+		之后的 Eval 直接执行加载的字节码。出错时当前表达式保持不变。
+	*/
+	void ParserBase::LoadByteCode(std::istream &a_Stream)
+	{
+		// 先读入记录头以确定记录的长度，然后把整条记录读入内存
+		std::string sRecord(c_nByteCodeHeaderSize, 0);
+		if (!a_Stream.read(&sRecord[0], c_nByteCodeHeaderSize))
+			Error(ecINVALID_BYTECODE);
+
+		const char *pPos = sRecord.data() + c_nByteCodeHeaderSize - 2 * sizeof(std::uint64_t);
+		std::uint64_t nSize = ParserByteCode::ReadBinary<std::uint64_t>(pPos, sRecord.data() + sRecord.size());
+		if (nSize > c_nByteCodeMaxSize)
+			Error(ecINVALID_BYTECODE);
+
+		sRecord.resize(c_nByteCodeHeaderSize + (std::size_t)nSize);
+		if (nSize && !a_Stream.read(&sRecord[c_nByteCodeHeaderSize], (std::streamsize)nSize))
+			Error(ecINVALID_BYTECODE);
+
+		LoadByteCode(sRecord.data(), sRecord.size());
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 从内存读取 SaveByteCode 写入的一条记录并把它设置为当前表达式。
+		\param a_pData 记录的起始地址
+		\param a_nSize 可读取的字节数，至少为记录的长度
+		\throw ParserError 同 LoadByteCode(std::istream&)
+
+		数据直接在原处解析，不会被复制，例如可以直接读取映射到内存的文件。
+	*/
+	void ParserBase::LoadByteCode(const char *a_pData, std::size_t a_nSize)
+	{
+		const char *pPos = a_pData, *pEnd = a_pData + a_nSize;
+		if (ParserByteCode::ReadBinary<std::uint32_t>(pPos, pEnd) != c_nByteCodeMagic ||
+			ParserByteCode::ReadBinary<std::uint32_t>(pPos, pEnd) != c_nByteCodeVersion ||
+			ParserByteCode::ReadBinary<std::uint8_t>(pPos, pEnd) != sizeof(char_type) ||
+			ParserByteCode::ReadBinary<std::uint8_t>(pPos, pEnd) != sizeof(value_type))
+		{
+			Error(ecINVALID_BYTECODE);
+		}
+
+		std::uint64_t nSize = ParserByteCode::ReadBinary<std::uint64_t>(pPos, pEnd);
+		std::uint64_t nHash = ParserByteCode::ReadBinary<std::uint64_t>(pPos, pEnd);
+		if (nSize > (std::uint64_t)(pEnd - pPos) || ByteCodeHash(pPos, (std::size_t)nSize) != nHash)
+			Error(ecINVALID_BYTECODE);
+
+		// 先把所有数据读入局部变量，全部有效之后才替换当前表达式
+		pEnd = pPos + nSize;
+		string_type sExpr = ParserByteCode::ReadString(pPos, pEnd);
+
+		ParserByteCode bc;
+		bc.Load(pPos, pEnd, ByteCodeSymbols(*this));
+
+		// 保存的字符串已经去重，按原来的顺序加入以保持字节码中的索引
+		ParserStringPool vStringBuf;
+		std::uint32_t nStrings = ParserByteCode::ReadBinary<std::uint32_t>(pPos, pEnd);
+		for (std::uint32_t i = 0; i < nStrings; ++i)
+			vStringBuf.Add(ParserByteCode::ReadString(pPos, pEnd));
+
+		int nFinalResultIdx = ParserByteCode::ReadBinary<std::int32_t>(pPos, pEnd);
+		if (nFinalResultIdx <= 0 || nFinalResultIdx >= (int)bc.GetMaxStackSize())
+			Error(ecINVALID_BYTECODE);
+
+		const SToken *pTok = bc.GetBase();
+		for (std::size_t i = 0; i < bc.GetSize(); ++i)
+		{
+			if (pTok[i].Cmd == cmFUNC_STR && (pTok[i].Fun.idx < 0 || pTok[i].Fun.idx >= (int)vStringBuf.size()))
+				Error(ecINVALID_BYTECODE);
+		}
+
+		SetExpr(sExpr);
+
+		m_pRPN = NewByteCode();
+		*m_pRPN = bc;
+		*m_pStringBuf = vStringBuf;
+		m_nFinalResultIdx = nFinalResultIdx;
+		ReserveStacks(1);
+		m_pParseFormula = (m_pRPN->GetSize() == 2) ? &ParserBase::ParseCmdCodeShort : &ParserBase::ParseCmdCode;
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief Clone 创建的解析器。
+
+		副本只复制符号表和词法设置，内置函数和运算符已经包含在复制的符号表中，因此初始化函数为空。
+	*/
+	class ParserBase::ParserClone final : public ParserBase
+	{
+	public:
+		explicit ParserClone(const ParserBase &a_Parser)
+			: ParserBase(a_Parser)
+		{
+		}
+
+	protected:
+		void InitCharSets() override {}
+		void InitFun() override {}
+		void InitConst() override {}
+		void InitOprt() override {}
+	};
+
+	//---------------------------------------------------------------------------
+	/** \brief 创建一个可以在另一个线程中求值当前表达式的解析器。
+		\return 新的解析器，它与本解析器使用相同的变量。
+		\throw ParserError 如果表达式有语法错误。
+
+		与拷贝构造不同，克隆不会重新编译表达式：尚未编译的表达式先在本解析器中编译一次，
+		字节码、字符串参数以及函数、运算符、常量、变量和字符串常量的符号表由本解析器和所有克隆共享。
+		克隆自己拥有的只有求值栈、一个只包含公式和词法设置的新的标记读取器以及少量的状态，
+		因此克隆的开销与符号表的大小无关，每个线程可以使用自己的克隆同时调用 Eval。
+
+		共享的部分不会被修改：本解析器或者克隆重新编译时（例如设置新的表达式或者重新定义用到的变量），
+		它换用自己的字节码；第一次修改共享的符号表时复制该表。其他解析器不受影响。
+		要让克隆计算不同的变量，在克隆中重新定义这些变量。
 	*/
-	void ParserBase::CheckName(const string_type &a_sName, const string_type &a_szCharSet) const
+	std::unique_ptr<ParserBase> ParserBase::Clone() const
 	{
-		if (!a_sName.length() ||
-			(a_sName.find_first_not_of(a_szCharSet) != string_type::npos) ||
-			(a_sName[0] >= '0' && a_sName[0] <= '9'))
+		if (m_pTokenReader->GetExpr().length())
+			Compile();
+
+		std::unique_ptr<ParserClone> pClone(new ParserClone(*this));
+		if (m_pParseFormula != &ParserBase::ParseString)
 		{
-			Error(ecINVALID_NAME);
+			pClone->m_pRPN = m_pRPN;
+			pClone->m_vUsedNames = m_vUsedNames;
+			pClone->m_bUsedNamesKnown = m_bUsedNamesKnown;
+			pClone->m_pParseFormula = m_pParseFormula;
+			pClone->ReserveStacks(1);
 		}
+
+		return std::unique_ptr<ParserBase>(pClone.release());
 	}
 
-	/** \brief 设置公式。
-		\param a_strFormula 公式字符串
-		\throw ParserException 如果存在语法错误。
+	//---------------------------------------------------------------------------
+	class ParserBase::BatchWorker final : public ParserBase
+	{
+	public:
+		explicit BatchWorker(const ParserBase &a_Parser)
+			: ParserBase(a_Parser)
+		{
+			// 符号表是冻结的：未定义的变量是错误，而不是由变量工厂在副本中创建
+			SetVarFactory(nullptr, nullptr);
+			EnableExprCache(0);
+		}
 
-		首次计算，创建字节码并扫描使用的变量。
+	protected:
+		void InitCharSets() override {}
+		void InitFun() override {}
+		void InitConst() override {}
+		void InitOprt() override {}
+	};
+
+	//---------------------------------------------------------------------------
+	/** \brief 在多个线程中编译一组表达式。
+		\param a_vExpr 要编译的表达式
+		\return 每个表达式一个结果，顺序与 a_vExpr 相同。
+
+		本解析器的符号表在编译期间必须保持不变。调用线程和线程池中的工作线程各自使用一个解析器副本，
+		从共享的计数器领取下一个表达式。成功编译的表达式以 SaveByteCode 的记录格式返回，
+		可以用 LoadByteCode 加载到任何定义了相同符号的解析器中，或者写入 ParserBundleWriter。
+		失败的表达式返回各自的错误，不影响其他表达式。使用变量工厂的解析器在批量编译时不会创建新变量。
 	*/
-	void ParserBase::SetExpr(const string_type &a_sExpr)
+	std::vector<ParserBase::SBatchResult> ParserBase::CompileBatch(const std::vector<string_type> &a_vExpr) const
 	{
-		// 检查区域设置兼容性
-		if (m_pTokenReader->GetArgSep() == std::use_facet<numpunct<char_type>>(s_locale).decimal_point())
-			Error(ecLOCALE);
+		struct SBatch
+		{
+			std::vector<SBatchResult> vResult;
+			std::size_t nSize;
+			std::atomic<std::size_t> nNext;
+			std::size_t nDone;
+			std::mutex mtx;
+			std::condition_variable cond;
+		};
+
+		std::shared_ptr<SBatch> pBatch = std::make_shared<SBatch>();
+		pBatch->vResult.resize(a_vExpr.size());
+		pBatch->nSize = a_vExpr.size();
+		pBatch->nNext = 0;
+		pBatch->nDone = 0;
+		if (a_vExpr.empty())
+			return std::move(pBatch->vResult);
+
+		// 线程领取到表达式之后才访问本解析器和 a_vExpr。调用线程会等待所有已领取的表达式完成，
+		// 因此迟到的任务不会访问已经不存在的对象。迟到的任务只读取 nSize，因为结果向量已经被移走
+		auto compile = [this, pBatch, &a_vExpr]()
+		{
+			std::unique_ptr<BatchWorker> pWorker;
+			std::unique_ptr<ByteCodeSymbols> pSymbols;
+			std::size_t i;
+			while ((i = pBatch->nNext++) < pBatch->nSize)
+			{
+				SBatchResult &res = pBatch->vResult[i];
+				try
+				{
+					if (!pWorker)
+					{
+						pWorker.reset(new BatchWorker(*this));
+						pSymbols.reset(new ByteCodeSymbols(*pWorker));
+					}
 
-		// 检查允许的最大表达式长度。一个足够小的任意值，以便我可以调试发送给我的表达式
-		if (a_sExpr.length() >= MaxLenExpression)
-			Error(ecEXPRESSION_TOO_LONG, 0, a_sExpr);
+					std::ostringstream osRecord;
+					pWorker->SetExpr(a_vExpr[i]);
+					pWorker->SaveByteCode(osRecord, *pSymbols);
+					res.sByteCode = osRecord.str();
+					res.bOk = true;
+				}
+				catch (ParserError &exc)
+				{
+					res.Error = exc;
+				}
+				catch (...)
+				{
+					res.Error = ParserError(ecINTERNAL_ERROR, string_type(), a_vExpr[i]);
+				}
 
-		m_pTokenReader->SetFormula(a_sExpr + _T(" "));
-		ReInit();
+				std::lock_guard<std::mutex> lock(pBatch->mtx);
+				if (++pBatch->nDone == pBatch->nSize)
+					pBatch->cond.notify_all();
+			}
+		};
+
+		ParserThreadPool &pool = ParserThreadPool::Instance();
+		int nTasks = (int)std::min<std::size_t>(pool.GetNumThreads(), a_vExpr.size() - 1);
+		for (int i = 0; i < nTasks; ++i)
+			pool.Submit([compile](int) { compile(); });
+
+		compile();
+
+		std::unique_lock<std::mutex> lock(pBatch->mtx);
+		pBatch->cond.wait(lock, [&pBatch] { return pBatch->nDone == pBatch->nSize; });
+		return std::move(pBatch->vResult);
 	}
 
 	//---------------------------------------------------------------------------
@@ -425,6 +1413,7 @@ namespace mu
 	void ParserBase::DefineNameChars(const char_type *a_szCharset)
 	{
 		m_sNameChars = a_szCharset;
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -433,6 +1422,7 @@ namespace mu
 	void ParserBase::DefineOprtChars(const char_type *a_szCharset)
 	{
 		m_sOprtChars = a_szCharset;
+		BumpSymbolVersion();
 	}
 	// 代码实现了一个解析器的基本功能，包括添加值解析函数、设置变量工厂、添加函数或运算符回调函数、检查名称和运算符是否合法、设置公式以及定义有效字符集等
 	//---------------------------------------------------------------------------
@@ -441,6 +1431,7 @@ namespace mu
 	void ParserBase::DefineInfixOprtChars(const char_type *a_szCharset)
 	{
 		m_sInfixOprtChars = a_szCharset;
+		BumpSymbolVersion();
 	}
 
 	//---------------------------------------------------------------------------
@@ -551,15 +1542,19 @@ namespace mu
 			Error(ecNAME_CONFLICT);
 		CheckName(a_strName, ValidNameChars());
 
-		m_vStringVarBuf.push_back(a_strVal);				 // 将变量字符串存储在内部缓冲区中
-		m_StrVarDef[a_strName] = m_vStringVarBuf.size() - 1; // 将缓冲区索引绑定到变量名称
+		// 缓冲区可能与其他解析器共享，修改之前先复制
+		if (m_pStringVarBuf.use_count() > 1)
+			m_pStringVarBuf = std::make_shared<stringbuf_type>(*m_pStringVarBuf);
 
-		ReInit();
+		m_pStringVarBuf->push_back(a_strVal);				  // 将变量字符串存储在内部缓冲区中
+		m_StrVarDef[a_strName] = m_pStringVarBuf->size() - 1; // 将缓冲区索引绑定到变量名称
+
+		InvalidateSymbol(a_strName);
 	} //---------------------------------------------------------------------------
 	  /** \brief 添加用户定义的变量。
   \param [in] a_sName 变量名称
   \param [in] a_pVar 指向变量值的指针。
-  \post 将解析器重置为字符串解析模式。
+  \post 如果当前表达式使用了该名称，将解析器重置为字符串解析模式。
   \throw ParserException 如果名称包含无效字符或a_pVar为nullptr。
   */
 	void ParserBase::DefineVar(const string_type &a_sName, value_type *a_pVar)
@@ -575,14 +1570,75 @@ namespace mu
 
 		CheckName(a_sName, ValidNameChars());
 		m_VarDef[a_sName] = a_pVar;
-		ReInit();
+		m_VarStride.erase(a_sName); // 新定义的变量总是按密集数组处理
+		InvalidateSymbol(a_sName);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 设置变量在批量模式下的步长。
+	\param [in] a_sName 变量名称，变量必须已经定义。
+	\param [in] a_iStride 相邻两个值之间的字节距离。
+
+	默认情况下批量模式中的变量是密集的value_type数组（步长为sizeof(value_type)）。
+	通过设置步长可以直接从结构体数组中读取某个字段，例如：
+
+	<pre>
+	  struct Quote { double bid, ask, size; };
+	  p.DefineVar("bid", &quotes[0].bid);
+	  p.SetVarStride("bid", sizeof(Quote));
+	</pre>
+
+	步长只影响批量模式，Eval()和Eval(int&)总是读取变量指针所指的值。
+	重新调用DefineVar会把步长恢复为默认值。
+	\post 如果当前表达式使用了该变量，将解析器重置为字符串解析模式。
+	\throw ParserException 如果变量未定义。
+	*/
+	void ParserBase::SetVarStride(const string_type &a_sName, int a_iStride)
+	{
+		if (m_VarDef.find(a_sName) == m_VarDef.end())
+			Error(ecINVALID_NAME, -1, a_sName);
+
+		if (a_iStride == (int)sizeof(value_type))
+			m_VarStride.erase(a_sName);
+		else
+			m_VarStride[a_sName] = a_iStride;
+
+		InvalidateSymbol(a_sName);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回变量在批量模式下的步长（字节）。 */
+	std::ptrdiff_t ParserBase::GetVarStride(const string_type &a_sName) const
+	{
+		if (m_VarStride.empty())
+			return sizeof(value_type);
+
+		varstride_type::const_iterator item = m_VarStride.find(a_sName);
+		return (item != m_VarStride.end()) ? item->second : (std::ptrdiff_t)sizeof(value_type);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 将变量标记为批量模式下的标量（广播）参数。
+	\param [in] a_sName 变量名称，变量必须已经定义。
+	\param [in] a_bBroadcast true表示所有行共享同一个值，false恢复为密集数组。
+
+	广播变量在批量模式下不按行索引，所有行读取同一个值，因此不需要把标量参数复制成N个元素的数组。
+	这等价于 SetVarStride(a_sName, 0)。
+
+	注意：在多线程批量求值中对广播变量赋值（例如 "r = r*2"）会产生数据竞争。
+	\post 如果当前表达式使用了该变量，将解析器重置为字符串解析模式。
+	\throw ParserException 如果变量未定义。
+	*/
+	void ParserBase::SetVarBroadcast(const string_type &a_sName, bool a_bBroadcast)
+	{
+		SetVarStride(a_sName, a_bBroadcast ? 0 : (int)sizeof(value_type));
 	}
 
 	//---------------------------------------------------------------------------
 	/** \brief 添加用户定义的常量。
 	\param [in] a_sName 常量名称。
 	\param [in] a_fVal 常量的值。
-	\post 将解析器重置为字符串解析模式。
+	\post 如果当前表达式使用了该名称，将解析器重置为字符串解析模式。
 	\throw ParserException 如果名称包含无效字符。
 	*/
 	void ParserBase::DefineConst(const string_type &a_sName, value_type a_fVal)
@@ -591,7 +1647,16 @@ namespace mu
 			Error(ecIDENTIFIER_TOO_LONG);
 		CheckName(a_sName, ValidNameChars());
 		m_ConstDef[a_sName] = a_fVal;
-		ReInit();
+		InvalidateSymbol(a_sName);
+	}
+
+	//---------------------------------------------------------------------------
+	/** \brief 返回编译器值栈中一个条目的类型。
+		\param a_iTok 令牌缓冲区中的索引，-1表示由字节码计算的数值。
+	*/
+	int ParserBase::GetValType(int a_iTok) const
+	{
+		return (a_iTok < 0) ? (int)tpDBL : (int)m_vCompileTok[a_iTok].GetType();
 	}
 
 	//---------------------------------------------------------------------------
@@ -695,14 +1760,14 @@ namespace mu
 	/** \brief 返回一个仅包含已定义变量的映射表。 */
 	const varmap_type &ParserBase::GetVar() const
 	{
-		return m_VarDef;
+		return m_VarDef.Get();
 	}
 
 	//---------------------------------------------------------------------------
 	/** \brief 返回一个包含所有解析器常量的映射表。 */
 	const valmap_type &ParserBase::GetConst() const
 	{
-		return m_ConstDef;
+		return m_ConstDef.Get();
 	}
 
 	//---------------------------------------------------------------------------
@@ -716,7 +1781,7 @@ namespace mu
 	*/
 	const funmap_type &ParserBase::GetFunDef() const
 	{
-		return m_FunDef;
+		return m_FunDef.Get();
 	}
 
 	//---------------------------------------------------------------------------
@@ -729,77 +1794,26 @@ namespace mu
 	//---------------------------------------------------------------------------
 	/** \brief 执行一个带有单个字符串参数的函数。
 		\param a_FunTok 函数令牌。
+		\param a_iStrArg 字符串参数在编译器令牌缓冲区中的索引。
+		\param a_bStrInNumArgs 如果数值参数中有字符串则为true，参数已由调用者从值栈中移除。
 		\throw exception_type 如果函数令牌不是一个字符串函数
 	*/
-	ParserBase::token_type ParserBase::ApplyStrFunc(
-		const token_type &a_FunTok,
-		const std::vector<token_type> &a_vArg) const
+	void ParserBase::ApplyStrFunc(const token_type &a_FunTok, int a_iStrArg, bool a_bStrInNumArgs) const
 	{
-		if (a_vArg.back().GetCode() != cmSTRING)
+		if (a_iStrArg < 0 || m_vCompileTok[a_iStrArg].GetCode() != cmSTRING)
 			Error(ecSTRING_EXPECTED, m_pTokenReader->GetPos(), a_FunTok.GetAsString());
 
-		token_type valTok;
+		if (a_bStrInNumArgs)
+			Error(ecVAL_EXPECTED, m_pTokenReader->GetPos(), a_FunTok.GetAsString());
+
 		generic_callable_type pFunc = a_FunTok.GetFuncAddr();
 		MUP_ASSERT(pFunc);
 
-		try
-		{
-			// 检查函数参数；将虚拟值写入valtok以表示结果
-			switch (a_FunTok.GetArgCount())
-			{
-			case 0:
-				valTok.SetVal(1);
-				a_vArg[0].GetAsString();
-				break;
-			case 1:
-				valTok.SetVal(1);
-				a_vArg[1].GetAsString();
-				a_vArg[0].GetVal();
-				break;
-			case 2:
-				valTok.SetVal(1);
-				a_vArg[2].GetAsString();
-				a_vArg[1].GetVal();
-				a_vArg[0].GetVal();
-				break;
-			case 3:
-				valTok.SetVal(1);
-				a_vArg[3].GetAsString();
-				a_vArg[2].GetVal();
-				a_vArg[1].GetVal();
-				a_vArg[0].GetVal();
-				break;
-			case 4:
-				valTok.SetVal(1);
-				a_vArg[4].GetAsString();
-				a_vArg[3].GetVal();
-				a_vArg[2].GetVal();
-				a_vArg[1].GetVal();
-				a_vArg[0].GetVal();
-				break;
-			case 5:
-				valTok.SetVal(1);
-				a_vArg[5].GetAsString();
-				a_vArg[4].GetVal();
-				a_vArg[3].GetVal();
-				a_vArg[2].GetVal();
-				a_vArg[1].GetVal();
-				a_vArg[0].GetVal();
-				break;
-			default:
-				Error(ecINTERNAL_ERROR);
-			}
-		}
-		catch (ParserError &)
-		{
-			Error(ecVAL_EXPECTED, m_pTokenReader->GetPos(), a_FunTok.GetAsString());
-		}
+		if (a_FunTok.GetArgCount() < 0 || a_FunTok.GetArgCount() > 5)
+			Error(ecINTERNAL_ERROR);
 
 		// 字符串函数不会被优化
-		m_vRPN.AddStrFun(pFunc, a_FunTok.GetArgCount(), a_vArg.back().GetIdx());
-
-		// 将表示函数结果的虚拟值推入栈中
-		return valTok;
+		m_pRPN->AddStrFun(pFunc, a_FunTok.GetArgCount(), m_vCompileTok[a_iStrArg].GetIdx(), a_FunTok.HasStrHash());
 	}
 	// 该程序实现的功能是一个解析器类，提供了一些用于解析和处理数学表达式的方法。具体功能如下：
 
@@ -817,15 +1831,15 @@ namespace mu
 		\post 函数标记从栈中移除。
 		\throw exception_type 如果参数数量与函数要求不匹配。
 	*/
-	void ParserBase::ApplyFunc(std::stack<token_type> &a_stOpt, std::stack<token_type> &a_stVal, int a_iArgCount) const
+	void ParserBase::ApplyFunc(tokenstack_type &a_stOpt, tokenstack_type &a_stVal, int a_iArgCount) const
 	{
 		MUP_ASSERT(m_pTokenReader.get());
 
 		// 操作符栈为空或不包含具有回调函数的标记
-		if (a_stOpt.empty() || a_stOpt.top().GetFuncAddr() == 0)
+		if (a_stOpt.empty() || m_vCompileTok[a_stOpt.top()].GetFuncAddr() == 0)
 			return;
 
-		token_type funTok = a_stOpt.top();
+		const token_type &funTok = m_vCompileTok[a_stOpt.top()];
 		a_stOpt.pop();
 		MUP_ASSERT(funTok.GetFuncAddr() != nullptr);
 
@@ -850,37 +1864,41 @@ namespace mu
 		if (funTok.GetCode() == cmFUNC_STR && iArgCount > iArgRequired)
 			Error(ecTOO_MANY_PARAMS, m_pTokenReader->GetPos() - 1, funTok.GetAsString());
 
-		// 从值栈中收集数值函数参数并存储在向量中
-		std::vector<token_type> stArg;
+		// 从值栈中移除数值函数参数，它们必须是数值。字符串函数先检查其字符串参数，再报告这里的错误。
+		bool bStrInNumArgs = false;
 		for (int i = 0; i < iArgNumerical; ++i)
 		{
 			if (a_stVal.empty())
 				Error(ecINTERNAL_ERROR, m_pTokenReader->GetPos(), funTok.GetAsString());
 
-			stArg.push_back(a_stVal.top());
+			int iArgType = GetValType(a_stVal.top());
 			a_stVal.pop();
 
-			if (stArg.back().GetType() == tpSTR && funTok.GetType() != tpSTR)
-				Error(ecVAL_EXPECTED, m_pTokenReader->GetPos(), funTok.GetAsString());
+			if (iArgType == tpSTR)
+			{
+				if (funTok.GetType() != tpSTR)
+					Error(ecVAL_EXPECTED, m_pTokenReader->GetPos(), funTok.GetAsString());
+
+				bStrInNumArgs = true;
+			}
 		}
 
 		switch (funTok.GetCode())
 		{
 		case cmFUNC_STR:
+		{
 			if (a_stVal.empty())
 				Error(ecINTERNAL_ERROR, m_pTokenReader->GetPos(), funTok.GetAsString());
 
-			stArg.push_back(a_stVal.top());
+			int iStrArg = a_stVal.top();
 			a_stVal.pop();
 
-			if (stArg.back().GetType() == tpSTR && funTok.GetType() != tpSTR)
-				Error(ecVAL_EXPECTED, m_pTokenReader->GetPos(), funTok.GetAsString());
-
-			ApplyStrFunc(funTok, stArg);
-			break;
+			ApplyStrFunc(funTok, iStrArg, bStrInNumArgs);
+		}
+		break;
 
 		case cmFUNC_BULK:
-			m_vRPN.AddBulkFun(funTok.GetFuncAddr(), (int)stArg.size());
+			m_pRPN->AddBulkFun(funTok.GetFuncAddr(), iArgNumerical);
 			break;
 
 		case cmOPRT_BIN:
@@ -890,59 +1908,57 @@ namespace mu
 			if (funTok.GetArgCount() == -1 && iArgCount == 0)
 				Error(ecTOO_FEW_PARAMS, m_pTokenReader->GetPos(), funTok.GetAsString());
 
-			m_vRPN.AddFun(funTok.GetFuncAddr(), (funTok.GetArgCount() == -1) ? -iArgNumerical : iArgNumerical, funTok.IsOptimizable());
+			m_pRPN->AddFun(funTok.GetFuncAddr(), (funTok.GetArgCount() == -1) ? -iArgNumerical : iArgNumerical, funTok.IsOptimizable());
 			break;
 		default:
 			break;
 		}
 
-		// 推送表示函数结果的虚拟值到栈中
-		token_type token;
-		token.SetVal(1);
-		a_stVal.push(token);
+		// 推送表示函数结果的数值到栈中
+		a_stVal.push(-1);
 	}
 
 	//---------------------------------------------------------------------------
-	void ParserBase::ApplyIfElse(std::stack<token_type> &a_stOpt, std::stack<token_type> &a_stVal) const
+	void ParserBase::ApplyIfElse(tokenstack_type &a_stOpt, tokenstack_type &a_stVal) const
 	{
 		// 检查是否存在if-else子句需要计算
-		while (a_stOpt.size() && a_stOpt.top().GetCode() == cmELSE)
+		while (a_stOpt.size() && m_vCompileTok[a_stOpt.top()].GetCode() == cmELSE)
 		{
 			MUP_ASSERT(!a_stOpt.empty())
-			token_type opElse = a_stOpt.top();
 			a_stOpt.pop();
 
 			// 从值栈中取出与else分支关联的值
 			MUP_ASSERT(!a_stVal.empty());
-			token_type vVal2 = a_stVal.top();
-			if (vVal2.GetType() != tpDBL)
+			int iVal2 = a_stVal.top();
+			if (GetValType(iVal2) != tpDBL)
 				Error(ecUNEXPECTED_STR, m_pTokenReader->GetPos());
 
 			a_stVal.pop();
 
 			// 如果是三元运算符，则从值栈中弹出所有三个值，并返回右值
 			MUP_ASSERT(!a_stVal.empty());
-			token_type vVal1 = a_stVal.top();
-			if (vVal1.GetType() != tpDBL)
+			int iVal1 = a_stVal.top();
+			if (GetValType(iVal1) != tpDBL)
 				Error(ecUNEXPECTED_STR, m_pTokenReader->GetPos());
 
 			a_stVal.pop();
 
+			// 计算得到的值用1表示，令牌的值由令牌本身决定（字符串条件会抛出异常）
 			MUP_ASSERT(!a_stVal.empty());
-			token_type vExpr = a_stVal.top();
+			int iExpr = a_stVal.top();
 			a_stVal.pop();
 
-			a_stVal.push((vExpr.GetVal() != 0) ? vVal1 : vVal2);
+			value_type fExpr = (iExpr < 0) ? 1 : m_vCompileTok[iExpr].GetVal();
+			a_stVal.push((fExpr != 0) ? iVal1 : iVal2);
 
-			token_type opIf = a_stOpt.top();
+			MUP_ASSERT(!a_stOpt.empty());
+			int iCodeIf = m_vCompileTok[a_stOpt.top()].GetCode();
 			a_stOpt.pop();
 
-			MUP_ASSERT(opElse.GetCode() == cmELSE);
-
-			if (opIf.GetCode() != cmIF)
+			if (iCodeIf != cmIF)
 				Error(ecMISPLACED_COLON, m_pTokenReader->GetPos());
 
-			m_vRPN.AddIfElse(cmENDIF);
+			m_pRPN->AddIfElse(cmENDIF);
 		} // while存在待处理的if-else子句
 	}
 	// 该程序实现了一个解析器（Parser），其中的 ApplyFunc 函数用于应用函数标记，根据给定的函数标记和参数，执行相应的函数操作，并将结果推送到值栈中。ApplyIfElse 函数用于处理 if-else 条件语句的计算。
@@ -950,10 +1966,10 @@ namespace mu
 	//---------------------------------------------------------------------------
 	/** \brief 执行将二元操作符转换为字节码的必要步骤的函数。
 	 */
-	void ParserBase::ApplyBinOprt(std::stack<token_type> &a_stOpt, std::stack<token_type> &a_stVal) const
+	void ParserBase::ApplyBinOprt(tokenstack_type &a_stOpt, tokenstack_type &a_stVal) const
 	{
 		// 是否是用户定义的二元操作符？
-		if (a_stOpt.top().GetCode() == cmOPRT_BIN)
+		if (m_vCompileTok[a_stOpt.top()].GetCode() == cmOPRT_BIN)
 		{
 			ApplyFunc(a_stOpt, a_stVal, 2);
 		}
@@ -962,33 +1978,30 @@ namespace mu
 			if (a_stVal.size() < 2)
 				Error(ecINTERNAL_ERROR, m_pTokenReader->GetPos(), _T("ApplyBinOprt: value stack中的值不足!"));
 
-			token_type valTok1 = a_stVal.top();
+			int iVal1 = a_stVal.top();
 			a_stVal.pop();
 
-			token_type valTok2 = a_stVal.top();
+			int iVal2 = a_stVal.top();
 			a_stVal.pop();
 
-			token_type optTok = a_stOpt.top();
+			const token_type &optTok = m_vCompileTok[a_stOpt.top()];
 			a_stOpt.pop();
 
-			token_type resTok;
-
-			if (valTok1.GetType() != valTok2.GetType() ||
-				(valTok1.GetType() == tpSTR && valTok2.GetType() == tpSTR))
+			if (GetValType(iVal1) != GetValType(iVal2) || GetValType(iVal1) == tpSTR)
 				Error(ecOPRT_TYPE_CONFLICT, m_pTokenReader->GetPos(), optTok.GetAsString());
 
 			if (optTok.GetCode() == cmASSIGN)
 			{
-				if (valTok2.GetCode() != cmVAR)
+				if (iVal2 < 0 || m_vCompileTok[iVal2].GetCode() != cmVAR)
 					Error(ecUNEXPECTED_OPERATOR, -1, _T("="));
 
-				m_vRPN.AddAssignOp(valTok2.GetVar());
+				const token_type &varTok = m_vCompileTok[iVal2];
+				m_pRPN->AddAssignOp(varTok.GetVar(), GetVarStride(varTok.GetAsString()));
 			}
 			else
-				m_vRPN.AddOp(optTok.GetCode());
+				m_pRPN->AddOp(optTok.GetCode());
 
-			resTok.SetVal(1);
-			a_stVal.push(resTok);
+			a_stVal.push(-1);
 		}
 	}
 
@@ -997,14 +2010,14 @@ namespace mu
 		\param a_stOpt 操作符栈
 		\param a_stVal 值栈
 	*/
-	void ParserBase::ApplyRemainingOprt(std::stack<token_type> &stOpt, std::stack<token_type> &stVal) const
+	void ParserBase::ApplyRemainingOprt(tokenstack_type &stOpt, tokenstack_type &stVal) const
 	{
 		while (stOpt.size() &&
-			   stOpt.top().GetCode() != cmBO &&
-			   stOpt.top().GetCode() != cmIF)
+			   m_vCompileTok[stOpt.top()].GetCode() != cmBO &&
+			   m_vCompileTok[stOpt.top()].GetCode() != cmIF)
 		{
-			token_type tok = stOpt.top();
-			switch (tok.GetCode())
+			int iCode = m_vCompileTok[stOpt.top()].GetCode();
+			switch (iCode)
 			{
 			case cmOPRT_INFIX:
 			case cmOPRT_BIN:
@@ -1022,7 +2035,7 @@ namespace mu
 			case cmLAND:
 			case cmLOR:
 			case cmASSIGN:
-				if (stOpt.top().GetCode() == cmOPRT_INFIX)
+				if (iCode == cmOPRT_INFIX)
 					ApplyFunc(stOpt, stVal, 1);
 				else
 					ApplyBinOprt(stOpt, stVal);
@@ -1046,12 +2059,12 @@ namespace mu
 	*/
 	value_type ParserBase::ParseCmdCode() const
 	{
-		return ParseCmdCodeBulk(0, 0);
+		return ParseCmdCodeBulk(m_pRPN->GetBase(), 0, 0, GetStack(0));
 	}
 
 	value_type ParserBase::ParseCmdCodeShort() const
 	{
-		const SToken *const tok = m_vRPN.GetBase();
+		const SToken *const tok = m_pRPN->GetBase();
 		value_type buf;
 
 		switch (tok->Cmd)
@@ -1083,7 +2096,10 @@ namespace mu
 
 		// 无数值参数的字符串函数
 		case cmFUNC_STR:
-			return tok->Fun.cb.call_strfun<1>(m_vStringBuf[0].c_str());
+			if (tok->Fun.strhash)
+				return tok->Fun.cb.call_strhashfun<1>(m_pStringBuf->Get(tok->Fun.idx).c_str(), m_pStringBuf->Get(tok->Fun.idx).length(), m_pStringBuf->GetHash(tok->Fun.idx));
+
+			return tok->Fun.cb.call_strfun<1>(m_pStringBuf->Get(tok->Fun.idx).c_str());
 
 		default:
 			throw ParserError(ecINTERNAL_ERROR);
@@ -1094,18 +2110,16 @@ namespace mu
 	// ParseCmdCode函数解析了命令代码。
 	// ParseCmdCodeShort函数解析了命令代码的缩写形式。
 	/** \brief 评估逆波兰表示法（RPN）。
-	\param nOffset 变量地址的偏移量（用于批量模式）
+	\param a_pRPN 要执行的字节码
+	\param nOffset 变量地址的偏移量（用于批量模式），实际地址为 ptr + nOffset * stride（字节）
 	\param nThreadID 调用线程的OpenMP线程ID
+	\param stack 调用线程使用的计算栈，至少包含 m_pRPN->GetMaxStackSize() 个元素
 */
-	value_type ParserBase::ParseCmdCodeBulk(int nOffset, int nThreadID) const
+	value_type ParserBase::ParseCmdCodeBulk(const SToken *a_pRPN, int nOffset, int nThreadID, value_type *stack) const
 	{
-		assert(nThreadID <= s_MaxNumOpenMPThreads);
-
-		// 注意：这里对nOffset和nThreadID进行检查并不是必需的，但在非批量模式下可以带来轻微的性能提升。
-		value_type *stack = ((nOffset == 0) && (nThreadID == 0)) ? &m_vStackBuffer[0] : &m_vStackBuffer[nThreadID * (m_vStackBuffer.size() / s_MaxNumOpenMPThreads)];
 		value_type buf;
 		int sidx(0);
-		for (const SToken *pTok = m_vRPN.GetBase(); pTok->Cmd != cmEND; ++pTok)
+		for (const SToken *pTok = a_pRPN; pTok->Cmd != cmEND; ++pTok)
 		{
 			switch (pTok->Cmd)
 			{
@@ -1170,7 +2184,7 @@ namespace mu
 				// for details see:
 				//    https://groups.google.com/forum/embed/?place=forum/muparser-dev&showsearch=true&showpopout=true&showtabs=false&parenturl=http://muparser.beltoforion.de/mup_forum.html&afterlogin&pli=1#!topic/muparser-dev/szgatgoHTws
 				--sidx;
-				stack[sidx] = *(pTok->Oprt.ptr + nOffset) = stack[sidx + 1];
+				stack[sidx] = *(value_type *)((char *)pTok->Oprt.ptr + nOffset * pTok->Oprt.stride) = stack[sidx + 1];
 				continue;
 				// original code:
 				//--sidx; Stack[sidx] = *pTok->Oprt.ptr = Stack[sidx+1]; continue;
@@ -1192,29 +2206,29 @@ namespace mu
 
 			// 值和变量标记
 			case cmVAR:
-				stack[++sidx] = *(pTok->Val.ptr + nOffset);
+				stack[++sidx] = *(value_type *)((char *)pTok->Val.ptr + nOffset * pTok->Val.stride);
 				continue;
 			case cmVAL:
 				stack[++sidx] = pTok->Val.data2;
 				continue;
 
 			case cmVARPOW2:
-				buf = *(pTok->Val.ptr + nOffset);
+				buf = *(value_type *)((char *)pTok->Val.ptr + nOffset * pTok->Val.stride);
 				stack[++sidx] = buf * buf;
 				continue;
 
 			case cmVARPOW3:
-				buf = *(pTok->Val.ptr + nOffset);
+				buf = *(value_type *)((char *)pTok->Val.ptr + nOffset * pTok->Val.stride);
 				stack[++sidx] = buf * buf * buf;
 				continue;
 
 			case cmVARPOW4:
-				buf = *(pTok->Val.ptr + nOffset);
+				buf = *(value_type *)((char *)pTok->Val.ptr + nOffset * pTok->Val.stride);
 				stack[++sidx] = buf * buf * buf * buf;
 				continue;
 
 			case cmVARMUL:
-				stack[++sidx] = *(pTok->Val.ptr + nOffset) * pTok->Val.data + pTok->Val.data2;
+				stack[++sidx] = *(value_type *)((char *)pTok->Val.ptr + nOffset * pTok->Val.stride) * pTok->Val.data + pTok->Val.data2;
 				continue;
 
 			// 接下来处理数值函数
@@ -1293,38 +2307,9 @@ namespace mu
 
 			// 下面是对字符串函数的处理
 			case cmFUNC_STR:
-			{
 				sidx -= pTok->Fun.argc - 1;
-
-				// 字符串参数在字符串表中的索引
-				int iIdxStack = pTok->Fun.idx;
-				if (iIdxStack < 0 || iIdxStack >= (int)m_vStringBuf.size())
-					Error(ecINTERNAL_ERROR, m_pTokenReader->GetPos());
-
-				switch (pTok->Fun.argc) // 根据参数数量进行切换
-				{
-				case 0:
-					stack[sidx] = pTok->Fun.cb.call_strfun<1>(m_vStringBuf[iIdxStack].c_str());
-					continue;
-				case 1:
-					stack[sidx] = pTok->Fun.cb.call_strfun<2>(m_vStringBuf[iIdxStack].c_str(), stack[sidx]);
-					continue;
-				case 2:
-					stack[sidx] = pTok->Fun.cb.call_strfun<3>(m_vStringBuf[iIdxStack].c_str(), stack[sidx], stack[sidx + 1]);
-					continue;
-				case 3:
-					stack[sidx] = pTok->Fun.cb.call_strfun<4>(m_vStringBuf[iIdxStack].c_str(), stack[sidx], stack[sidx + 1], stack[sidx + 2]);
-					continue;
-				case 4:
-					stack[sidx] = pTok->Fun.cb.call_strfun<5>(m_vStringBuf[iIdxStack].c_str(), stack[sidx], stack[sidx + 1], stack[sidx + 2], stack[sidx + 3]);
-					continue;
-				case 5:
-					stack[sidx] = pTok->Fun.cb.call_strfun<6>(m_vStringBuf[iIdxStack].c_str(), stack[sidx], stack[sidx + 1], stack[sidx + 2], stack[sidx + 3], stack[sidx + 4]);
-					continue;
-				}
-
+				stack[sidx] = ParserByteCode::CallStrFun(*pTok, *m_pStringBuf, &stack[sidx]);
 				continue;
-			}
 
 			case cmFUNC_BULK:
 			{
@@ -1394,10 +2379,35 @@ namespace mu
 		if (!m_pTokenReader->GetExpr().length())
 			Error(ecUNEXPECTED_EOF, 0);
 
-		std::stack<token_type> stOpt, stVal; // 运算符栈、数值栈
-		std::stack<int> stArgCount;			 // 参数计数栈
-		token_type opta, opt;				 // 用于存储运算符
-		token_type val, tval;				 // 用于存储数值
+		// 运算符栈、数值栈和参数计数栈是成员变量，它们的内存可以在下一次编译时重复使用。
+		// 读取的令牌只在令牌缓冲区中保存一次，运算符栈和数值栈只保存它们的索引。
+		tokenbuf_type &vTok = m_vCompileTok;
+		tokenstack_type &stOpt = m_stCompileOpt, &stVal = m_stCompileVal;
+		argstack_type &stArgCount = m_stCompileArgCount;
+		while (stOpt.size())
+			stOpt.pop();
+		while (stVal.size())
+			stVal.pop();
+		while (stArgCount.size())
+			stArgCount.pop();
+
+		// 编译结束（包括因错误结束）时丢弃令牌，使令牌字符串不会在编译之后继续占用内存
+		struct SClearTokens
+		{
+			tokenbuf_type &m_vTok;
+			~SClearTokens() { m_vTok.clear(); }
+		} clearTokens{ vTok };
+		vTok.clear();
+
+		// 依赖列表保持有序，同一个符号被多次使用时只记录一次
+		auto addUsedName = [this](const string_type &a_sName)
+		{
+			auto item = std::lower_bound(m_vUsedNames.begin(), m_vUsedNames.end(), a_sName);
+			if (item == m_vUsedNames.end() || *item != a_sName)
+				m_vUsedNames.insert(item, a_sName);
+		};
+
+		int iCodePrev = cmUNKNOWN;			 // 上一个令牌的代码
 		int ifElseCounter = 0;				 // if-else计数器
 
 		ReInit();
@@ -1406,7 +2416,9 @@ namespace mu
 
 		for (;;)
 		{
-			opt = m_pTokenReader->ReadNextToken(); // 读取下一个token
+			vTok.push_back(m_pTokenReader->ReadNextToken()); // 读取下一个token
+			const int iTok = (int)vTok.size() - 1;
+			token_type &opt = vTok.back();
 
 			switch (opt.GetCode())
 			{
@@ -1415,19 +2427,24 @@ namespace mu
 				if (stOpt.empty())
 					Error(ecSTR_RESULT, m_pTokenReader->GetPos(), opt.GetAsString());
 
-				opt.SetIdx((int)m_vStringBuf.size()); // 将字符串存储在内部缓冲区，并将缓冲区索引分配给token
-				stVal.push(opt);
-				m_vStringBuf.push_back(opt.GetAsString()); // 将字符串存储在内部缓冲区中
+				// 字符串驻留在字符串池中，相同的字符串只保存一次，并将池中的索引分配给token
+				opt.SetIdx(m_pStringBuf->Intern(opt.GetAsString()));
+				stVal.push(iTok);
 				break;
 
 			case cmVAR: // 变量
-				stVal.push(opt);
-				m_vRPN.AddVar(static_cast<value_type *>(opt.GetVar()));
+				addUsedName(opt.GetAsString());
+				stVal.push(iTok);
+				m_pRPN->AddVar(static_cast<value_type *>(opt.GetVar()), GetVarStride(opt.GetAsString()));
 				break;
 
-			case cmVAL: // 数值
-				stVal.push(opt);
-				m_vRPN.AddVal(opt.GetVal());
+			case cmVAL: // 数值（常量的名称或数值字面量）
+				// 只记录常量的名称，数值字面量不依赖于任何符号
+				if (m_ConstDef.find(opt.GetAsString()) != m_ConstDef.end())
+					addUsedName(opt.GetAsString());
+
+				stVal.push(iTok);
+				m_pRPN->AddVal(opt.GetVal());
 				break;
 
 			case cmELSE: // else关键字
@@ -1444,12 +2461,12 @@ namespace mu
 					Error(ecMISPLACED_COLON, m_pTokenReader->GetPos());
 
 				ApplyRemainingOprt(stOpt, stVal);
-				m_vRPN.AddIfElse(cmELSE);
-				stOpt.push(opt);
+				m_pRPN->AddIfElse(cmELSE);
+				stOpt.push(iTok);
 				break;
 
 			case cmARG_SEP: // 参数分隔符
-				if (!stOpt.empty() && stOpt.top().GetCode() == cmIF)
+				if (!stOpt.empty() && vTok[stOpt.top()].GetCode() == cmIF)
 					Error(ecUNEXPECTED_ARG_SEP, m_pTokenReader->GetPos());
 
 				if (stArgCount.empty())
@@ -1468,13 +2485,13 @@ namespace mu
 				// 无参数函数的参数计数为0
 				// 开括号默认将参数计数设置为1，为接下来的参数做准备
 				// 如果上一个token是开括号，则参数计数减1
-				if (opta.GetCode() == cmBO)
+				if (iCodePrev == cmBO)
 					--stArgCount.top();
 
 				ApplyRemainingOprt(stOpt, stVal);
 
 				// 检查括号内的内容是否完全计算完成
-				if (stOpt.size() && stOpt.top().GetCode() == cmBO)
+				if (stOpt.size() && vTok[stOpt.top()].GetCode() == cmBO)
 				{
 					// 如果opt是")"且opta是"("，则括号已经计算完成，现在是时候检查
 					// 是否有待处理的函数或运算符
@@ -1488,16 +2505,16 @@ namespace mu
 					stOpt.pop(); // 从栈中弹出开括号
 
 					if (iArgCount > 1 && (stOpt.size() == 0 ||
-										  (stOpt.top().GetCode() != cmFUNC &&
-										   stOpt.top().GetCode() != cmFUNC_BULK &&
-										   stOpt.top().GetCode() != cmFUNC_STR)))
+										  (vTok[stOpt.top()].GetCode() != cmFUNC &&
+										   vTok[stOpt.top()].GetCode() != cmFUNC_BULK &&
+										   vTok[stOpt.top()].GetCode() != cmFUNC_STR)))
 						Error(ecUNEXPECTED_ARG, m_pTokenReader->GetPos());
 
 					// 开括号已从栈中弹出，现在检查此括号之前是否有函数
 					if (stOpt.size() &&
-						stOpt.top().GetCode() != cmOPRT_INFIX &&
-						stOpt.top().GetCode() != cmOPRT_BIN &&
-						stOpt.top().GetFuncAddr() != 0)
+						vTok[stOpt.top()].GetCode() != cmOPRT_INFIX &&
+						vTok[stOpt.top()].GetCode() != cmOPRT_BIN &&
+						vTok[stOpt.top()].GetFuncAddr() != 0)
 					{
 						ApplyFunc(stOpt, stVal, iArgCount);
 					}
@@ -1530,14 +2547,14 @@ namespace mu
 				// 发现二元运算符（用户定义或内置）
 				while (
 					stOpt.size() &&
-					stOpt.top().GetCode() != cmBO &&
-					stOpt.top().GetCode() != cmELSE &&
-					stOpt.top().GetCode() != cmIF)
+					vTok[stOpt.top()].GetCode() != cmBO &&
+					vTok[stOpt.top()].GetCode() != cmELSE &&
+					vTok[stOpt.top()].GetCode() != cmIF)
 				{
-					int nPrec1 = GetOprtPrecedence(stOpt.top()),
+					int nPrec1 = GetOprtPrecedence(vTok[stOpt.top()]),
 						nPrec2 = GetOprtPrecedence(opt);
 
-					if (stOpt.top().GetCode() == opt.GetCode())
+					if (vTok[stOpt.top()].GetCode() == opt.GetCode())
 					{
 						// 处理运算符的结合性
 						EOprtAssociativity eOprtAsct = GetOprtAssociativity(opt);
@@ -1553,34 +2570,35 @@ namespace mu
 						break;
 					}
 
-					if (stOpt.top().GetCode() == cmOPRT_INFIX)
+					if (vTok[stOpt.top()].GetCode() == cmOPRT_INFIX)
 						ApplyFunc(stOpt, stVal, 1);
 					else
 						ApplyBinOprt(stOpt, stVal);
 				} // while ( ... )
 
 				if (opt.GetCode() == cmIF)
-					m_vRPN.AddIfElse(opt.GetCode());
+					m_pRPN->AddIfElse(opt.GetCode());
 
 				// 无法立即计算运算符，将其推回运算符栈
-				stOpt.push(opt);
+				stOpt.push(iTok);
 				break;
 
 				// 最后一部分包含隐式映射为函数的函数和运算符
 			case cmBO: // 开括号
 				stArgCount.push(1);
-				stOpt.push(opt);
+				stOpt.push(iTok);
 				break;
 
 			case cmOPRT_INFIX: // 中缀运算符
 			case cmFUNC:	   // 函数
 			case cmFUNC_BULK:  // 批量函数
 			case cmFUNC_STR:   // 字符串函数
-				stOpt.push(opt);
+				addUsedName(opt.GetAsString());
+				stOpt.push(iTok);
 				break;
 
 			case cmOPRT_POSTFIX: // 后缀运算符
-				stOpt.push(opt);
+				stOpt.push(iTok);
 				ApplyFunc(stOpt, stVal, 1); // 这是后缀运算符
 				break;
 
@@ -1588,26 +2606,26 @@ namespace mu
 				Error(ecINTERNAL_ERROR, 3);
 			} // end of switch operator-token
 
-			opta = opt;
+			iCodePrev = opt.GetCode();
 
 			if (opt.GetCode() == cmEND)
 			{
-				m_vRPN.Finalize();
+				m_pRPN->Finalize();
 				break;
 			}
 
 			if (ParserBase::g_DbgDumpStack)
 			{
 				StackDump(stVal, stOpt);
-				m_vRPN.AsciiDump();
+				m_pRPN->AsciiDump();
 			}
 
 			//			if (ParserBase::g_DbgDumpCmdCode)
-			// m_vRPN.AsciiDump();
+			// m_pRPN->AsciiDump();
 		} // while (true)
 
 		if (ParserBase::g_DbgDumpCmdCode)
-			m_vRPN.AsciiDump();
+			m_pRPN->AsciiDump();
 
 		if (ifElseCounter > 0)
 			Error(ecMISSING_ELSE_CLAUSE);
@@ -1625,17 +2643,44 @@ namespace mu
 		// 我不再需要值栈。破坏性地检查值栈中的所有值是否都表示浮点数值
 		while (stVal.size())
 		{
-			if (stVal.top().GetType() != tpDBL)
+			if (GetValType(stVal.top()) != tpDBL)
 				Error(ecSTR_RESULT);
 
 			stVal.pop();
 		}
 
-		m_vStackBuffer.resize(m_vRPN.GetMaxStackSize() * s_MaxNumOpenMPThreads);
+		ReserveStacks(1);
+		m_bUsedNamesKnown = true;
 	}
 
 	// 程序实现了创建逆波兰表达式（RPN）的功能。
 
+	//---------------------------------------------------------------------------
+	/** \brief 如果当前表达式还没有编译，编译它但不求值。
+		\throw ParserError 如果表达式有语法错误。
+
+		编译之后 Eval 的各个重载不再分配堆内存（参见类的说明），因此对延迟敏感的代码可以在 SetExpr
+		之后提前调用此函数，而不是让第一次求值完成编译。
+	*/
+	void ParserBase::Compile() const
+	{
+		if (m_pParseFormula != &ParserBase::ParseString)
+			return;
+
+		try
+		{
+			CreateRPN();
+		}
+		catch (ParserError &exc)
+		{
+			exc.SetFormula(m_pTokenReader->GetExpr());
+			throw;
+		}
+
+		AddToExprCache();
+		m_pParseFormula = (m_pRPN->GetSize() == 2) ? &ParserBase::ParseCmdCodeShort : &ParserBase::ParseCmdCode;
+	}
+
 	//---------------------------------------------------------------------------
 	/** \brief One of the two main parse functions.
 		\sa ParseCmdCode(...)
@@ -1647,12 +2692,13 @@ namespace mu
 		try
 		{
 			CreateRPN();
+			AddToExprCache();
 
-			if (m_vRPN.GetSize() == 2)
+			if (m_pRPN->GetSize() == 2)
 			{
 				m_pParseFormula = &ParserBase::ParseCmdCodeShort;
-				m_vStackBuffer[1] = (this->*m_pParseFormula)();
-				return m_vStackBuffer[1];
+				GetStack(0)[1] = (this->*m_pParseFormula)();
+				return GetStack(0)[1];
 			}
 			else
 			{
@@ -1686,12 +2732,13 @@ namespace mu
 	/** \brief Clear all user defined variables.
 		\throw nothrow
 
-		通过调用 #ReInit 将解析器重置为字符串解析模式。
+		如果当前表达式使用了任何变量，通过调用 #ReInit 将解析器重置为字符串解析模式。
 	*/
 	void ParserBase::ClearVar()
 	{
+		InvalidateSymbols([this](const string_type &sName) { return m_VarDef.find(sName) != m_VarDef.end(); });
 		m_VarDef.clear();
-		ReInit();
+		m_VarStride.clear();
 	}
 
 	//------------------------------------------------------------------------------
@@ -1702,23 +2749,22 @@ namespace mu
 	*/
 	void ParserBase::RemoveVar(const string_type &a_strVarName)
 	{
-		varmap_type::iterator item = m_VarDef.find(a_strVarName);
-		if (item != m_VarDef.end())
+		if (m_VarDef.erase(a_strVarName))
 		{
-			m_VarDef.erase(item);
-			ReInit();
+			m_VarStride.erase(a_strVarName);
+			InvalidateSymbol(a_strVarName);
 		}
 	}
 
 	//------------------------------------------------------------------------------
 	/** \brief Clear all functions.
-		\post 重置解析器为字符串解析模式。
+		\post 如果当前表达式使用了任何函数，重置解析器为字符串解析模式。
 		\throw nothrow
 	*/
 	void ParserBase::ClearFun()
 	{
+		InvalidateSymbols([this](const string_type &sName) { return m_FunDef.find(sName) != m_FunDef.end(); });
 		m_FunDef.clear();
-		ReInit();
 	}
 
 	//------------------------------------------------------------------------------
@@ -1730,9 +2776,10 @@ namespace mu
 	*/
 	void ParserBase::ClearConst()
 	{
+		// 字节码中只保存字符串常量的值而不保存名称，因此存在字符串常量时所有字节码都失效
+		InvalidateSymbols([this](const string_type &sName) { return !m_StrVarDef.empty() || m_ConstDef.find(sName) != m_ConstDef.end(); });
 		m_ConstDef.clear();
 		m_StrVarDef.clear();
-		ReInit();
 	}
 
 	//------------------------------------------------------------------------------
@@ -1743,6 +2790,7 @@ namespace mu
 	void ParserBase::ClearPostfixOprt()
 	{
 		m_PostOprtDef.clear();
+		BumpSymbolVersion();
 		ReInit();
 	}
 
@@ -1754,6 +2802,7 @@ namespace mu
 	void ParserBase::ClearOprt()
 	{
 		m_OprtDef.clear();
+		BumpSymbolVersion();
 		ReInit();
 	}
 
@@ -1765,6 +2814,7 @@ namespace mu
 	void ParserBase::ClearInfixOprt()
 	{
 		m_InfixOprtDef.clear();
+		BumpSymbolVersion();
 		ReInit();
 	}
 
@@ -1775,8 +2825,9 @@ namespace mu
 	*/
 	void ParserBase::EnableOptimizer(bool a_bIsOn)
 	{
-		m_vRPN.EnableOptimizer(a_bIsOn);
+		BumpSymbolVersion();
 		ReInit();
+		m_pRPN->EnableOptimizer(a_bIsOn);
 	}
 
 	//---------------------------------------------------------------------------
@@ -1802,9 +2853,22 @@ namespace mu
 	void ParserBase::EnableBuiltInOprt(bool a_bIsOn)
 	{
 		m_bBuiltInOp = a_bIsOn;
+		BumpSymbolVersion();
 		ReInit();
 	}
 
+	//------------------------------------------------------------------------------
+	/** \brief 启用或禁用符号查找的哈希索引。
+		\throw nothrow
+
+	  默认情况下，标记读取器在有序的符号表中查找函数、常量和变量。定义了成千上万个符号时，
+	  启用哈希索引可以显著缩短编译时间。索引在符号表改变后的下一次编译时重建。
+	*/
+	void ParserBase::EnableSymbolIndex(bool a_bIsOn)
+	{
+		m_pTokenReader->EnableSymbolIndex(a_bIsOn);
+	}
+
 	//------------------------------------------------------------------------------
 	/** \brief Query status of built in variables.
 		\return #m_bBuiltInOp；如果启用了内置操作符，则返回 true。
@@ -1830,6 +2894,7 @@ namespace mu
 	void ParserBase::SetArgSep(char_type cArgSep)
 	{
 		m_pTokenReader->SetArgSep(cArgSep);
+		BumpSymbolVersion();
 	}
 	// 该程序实现了一个解析器的基本功能。它可以解析输入的数学表达式，并进行语法检查和创建字节码。代码中的注释提供了关于每个函数的详细说明，包括函数的作用、输入参数和实现细节。这些函数包括解析表达式、处理错误、清除变量、清除函数、清除常量、清除运算符、启用优化功能、启用调试功能等。
 	//------------------------------------------------------------------------------
@@ -1837,35 +2902,38 @@ namespace mu
 
   该函数仅用于调试。
 */
-void ParserBase::StackDump(const std::stack<token_type> &a_stVal, const std::stack<token_type> &a_stOprt) const
+void ParserBase::StackDump(const tokenstack_type &a_stVal, const tokenstack_type &a_stOprt) const
 {
-    std::stack<token_type> stOprt(a_stOprt);
-    std::stack<token_type> stVal(a_stVal);
+    tokenstack_type stOprt(a_stOprt);
+    tokenstack_type stVal(a_stVal);
 
     mu::console() << _T("\nValue stack:\n");
     while (!stVal.empty())
     {
-        token_type val = stVal.top();
+        int iVal = stVal.top();
         stVal.pop();
 
-        if (val.GetType() == tpSTR)
-            mu::console() << _T(" \"") << val.GetAsString() << _T("\" ");
+        if (iVal < 0)
+            mu::console() << _T(" <result> ");
+        else if (m_vCompileTok[iVal].GetType() == tpSTR)
+            mu::console() << _T(" \"") << m_vCompileTok[iVal].GetAsString() << _T("\" ");
         else
-            mu::console() << _T(" ") << val.GetVal() << _T(" ");
+            mu::console() << _T(" ") << m_vCompileTok[iVal].GetVal() << _T(" ");
     }
     mu::console() << "\nOperator stack:\n";
 
     while (!stOprt.empty())
     {
-        if (stOprt.top().GetCode() <= cmASSIGN)
+        const token_type &tok = m_vCompileTok[stOprt.top()];
+        if (tok.GetCode() <= cmASSIGN)
         {
             mu::console() << _T("OPRT_INTRNL \"")
-                          << ParserBase::c_DefaultOprt[stOprt.top().GetCode()]
+                          << ParserBase::c_DefaultOprt[tok.GetCode()]
                           << _T("\" \n");
         }
         else
         {
-            switch (stOprt.top().GetCode())
+            switch (tok.GetCode())
             {
             case cmVAR:
                 mu::console() << _T("VAR\n");
@@ -1876,26 +2944,26 @@ void ParserBase::StackDump(const std::stack<token_type> &a_stVal, const std::sta
             case cmFUNC:
                 mu::console()
                     << _T("FUNC \"")
-                    << stOprt.top().GetAsString()
+                    << tok.GetAsString()
                     << _T("\"\n");
                 break;
 
             case cmFUNC_BULK:
                 mu::console()
                     << _T("FUNC_BULK \"")
-                    << stOprt.top().GetAsString()
+                    << tok.GetAsString()
                     << _T("\"\n");
                 break;
 
             case cmOPRT_INFIX:
                 mu::console() << _T("OPRT_INFIX \"")
-                              << stOprt.top().GetAsString()
+                              << tok.GetAsString()
                               << _T("\"\n");
                 break;
 
             case cmOPRT_BIN:
                 mu::console() << _T("OPRT_BIN \"")
-                              << stOprt.top().GetAsString()
+                              << tok.GetAsString()
                               << _T("\"\n");
                 break;
 
@@ -1924,7 +2992,7 @@ void ParserBase::StackDump(const std::stack<token_type> &a_stVal, const std::sta
                 mu::console() << _T("ENDIF\n");
                 break;
             default:
-                mu::console() << stOprt.top().GetCode() << _T(" ");
+                mu::console() << tok.GetCode() << _T(" ");
                 break;
             }
         }
@@ -1965,7 +3033,7 @@ value_type ParserBase::Eval() const
 */
 value_type *ParserBase::Eval(int &nStackSize) const
 {
-    if (m_vRPN.GetSize() > 0)
+    if (m_pRPN->GetSize() > 0)
     {
         ParseCmdCode();
     }
@@ -1977,7 +3045,7 @@ value_type *ParserBase::Eval(int &nStackSize) const
     nStackSize = m_nFinalResultIdx;
 
     // （由于历史原因，栈从位置1开始）
-    return &m_vStackBuffer[1];
+    return GetStack(0) + 1;
 }
 
 //---------------------------------------------------------------------------
@@ -1991,10 +3059,95 @@ int ParserBase::GetNumResults() const
     return m_nFinalResultIdx;
 }
 
+//---------------------------------------------------------------------------
+/** \brief 启用或禁用NUMA感知的批量模式。
+
+    启用后批量求值把工作线程绑定到NUMA节点（拓扑从 /sys/devices/system/node 读取），
+    每个线程处理一段连续的行，并使用在本地节点上分配的计算栈。
+    输入列应使用 AllocBulkBuffer 分配，使其内存页按相同的划分分布到各节点。
+    没有OpenMP支持或只有一个节点时，该设置不会改变结果，只改变行的划分方式。
+*/
+void ParserBase::EnableNumaBulk(bool a_bIsOn)
+{
+    m_bNumaBulk = a_bIsOn;
+}
+
+//---------------------------------------------------------------------------
+/** \brief 启用或禁用批量模式计算栈的缓存行填充。
+
+    默认启用：每个线程的栈从缓存行的起始位置开始并填充到缓存行的整数倍。禁用后各线程的栈按
+    最大深度紧密排列，相邻线程的栈顶可能位于同一缓存行上。禁用只用于测量伪共享的影响，
+    结果不变。
+*/
+void ParserBase::EnableStackPadding(bool a_bIsOn)
+{
+    m_bStackPadding = a_bIsOn;
+
+    // 按新的布局重新划分已有的栈
+    m_nStackStride = 0;
+    ReserveStacks(m_nStackThreads);
+}
+
+//---------------------------------------------------------------------------
+/** \brief 分配一个批量模式使用的缓冲区，并按NUMA批量模式的行划分进行首次写入。
+    \param nSize 元素个数
+    \return 初始化为0的缓冲区，必须用 FreeBulkBuffer 释放
+
+    每个工作线程将自己负责的行区间清零，因此操作系统会把这些页分配到该线程所在的节点上。
+*/
+value_type *ParserBase::AllocBulkBuffer(int nSize)
+{
+    // 不进行值初始化，在首次写入之前内存页不会被分配
+    value_type *pBuf = new value_type[nSize];
+
+#ifdef MUP_USE_OPENMP
+    int nMaxThreads = std::min(omp_get_max_threads(), s_MaxNumOpenMPThreads);
+
+    // 主线程也参与绑定，并行区域结束后恢复它原来的亲和性
+    ParserAffinityGuard affinity;
+
+#pragma omp parallel num_threads(nMaxThreads)
+    {
+        int nThread = omp_get_thread_num();
+        int nThreads = omp_get_num_threads();
+        ParserNumaTopology::Instance().BindThread(nThread, nThreads);
+
+        int iBegin, iEnd;
+        ParserNumaTopology::GetThreadRange(nThread, nThreads, nSize, iBegin, iEnd);
+        std::fill(pBuf + iBegin, pBuf + iEnd, (value_type)0);
+    }
+#else
+    std::fill(pBuf, pBuf + nSize, (value_type)0);
+#endif
+
+    return pBuf;
+}
+
+//---------------------------------------------------------------------------
+/** \brief 释放由 AllocBulkBuffer 分配的缓冲区。 */
+void ParserBase::FreeBulkBuffer(value_type *a_pBuf)
+{
+    delete[] a_pBuf;
+}
+
 //---------------------------------------------------------------------------
 void ParserBase::Eval(value_type *results, int nBulkSize)
 {
-    CreateRPN();
+    Eval(results, nBulkSize, sizeof(value_type));
+}
+
+//---------------------------------------------------------------------------
+/** \brief 批量模式求值，结果按指定步长写出。
+    \param [out] results 第一个结果的地址
+    \param nBulkSize 计算次数
+    \param nResultStride 相邻两个结果之间的字节距离
+
+    可用于将结果直接写入结构体数组中的某个字段。变量的步长通过 SetVarStride 设置。
+*/
+void ParserBase::Eval(value_type *results, int nBulkSize, int nResultStride)
+{
+    // 只在需要时编译，已编译的表达式直接求值，不分配内存
+    Compile();
 
     int i = 0;
 
@@ -2007,6 +3160,31 @@ void ParserBase::Eval(value_type *results, int nBulkSize)
 
     int nMaxThreads = std::min(omp_get_max_threads(), s_MaxNumOpenMPThreads);
     int nThreadID = 0;
+    ReserveStacks(nMaxThreads);
+
+    if (m_bNumaBulk)
+    {
+        const std::size_t nStackSize = m_pRPN->GetMaxStackSize();
+        ParserAffinityGuard affinity;
+
+#pragma omp parallel num_threads(nMaxThreads)
+        {
+            int nThread = omp_get_thread_num();
+            int nThreads = omp_get_num_threads();
+            ParserNumaTopology::Instance().BindThread(nThread, nThreads);
+
+            // 栈在绑定之后由本线程分配并首次写入，因此位于本线程所在的节点
+            valbuf_type vStack(nStackSize);
+
+            // 连续的行区间，与 AllocBulkBuffer 首次写入时的划分一致
+            int iBegin, iEnd;
+            ParserNumaTopology::GetThreadRange(nThread, nThreads, nBulkSize, iBegin, iEnd);
+            for (int k = iBegin; k < iEnd; ++k)
+                *(value_type *)((char *)results + (std::ptrdiff_t)k * nResultStride) = ParseCmdCodeBulk(m_pRPN->GetBase(), k, nThread, &vStack[0]);
+        }
+
+        return;
+    }
 
 #ifdef DEBUG_OMP_STUFF
     int ct = 0;
@@ -2017,7 +3195,7 @@ void ParserBase::Eval(value_type *results, int nBulkSize)
     for (i = 0; i < nBulkSize; ++i)
     {
         nThreadID = omp_get_thread_num();
-        results[i] = ParseCmdCodeBulk(i, nThreadID);
+        *(value_type *)((char *)results + (std::ptrdiff_t)i * nResultStride) = ParseCmdCodeBulk(m_pRPN->GetBase(), i, nThreadID, GetStack(nThreadID));
 
 #ifdef DEBUG_OMP_STUFF
 #pragma omp critical
@@ -2045,10 +3223,152 @@ void ParserBase::Eval(value_type *results, int nBulkSize)
 #else
     for (i = 0; i < nBulkSize; ++i)
     {
-        results[i] = ParseCmdCodeBulk(i, 0);
+        *(value_type *)((char *)results + (std::ptrdiff_t)i * nResultStride) = ParseCmdCodeBulk(m_pRPN->GetBase(), i, 0, GetStack(0));
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------
+/** \brief 批量模式下对包含逗号分隔子表达式的表达式求值。
+    \param [out] results GetNumResults() 个结果列的地址，每列包含 nBulkSize 个元素
+    \param nBulkSize 计算次数
+
+    每一行的所有结果（例如 "x+y, sin(x), cos(y)" 的三个结果）都写入对应的列中，
+    第k个子表达式的结果写入 results[k]。结果的数量可以在 SetExpr 之后通过 GetNumResults 查询。
+*/
+void ParserBase::EvalColumns(value_type *const *results, int nBulkSize)
+{
+    Compile();
+
+    const int nResults = m_nFinalResultIdx;
+    const SToken *pRPN = m_pRPN->GetBase();
+
+#ifdef MUP_USE_OPENMP
+    int nMaxThreads = std::min(omp_get_max_threads(), s_MaxNumOpenMPThreads);
+    ReserveStacks(nMaxThreads);
+    std::unique_ptr<ParserAffinityGuard> pAffinity(m_bNumaBulk ? new ParserAffinityGuard() : nullptr);
+
+#pragma omp parallel num_threads(nMaxThreads)
+    {
+        int nThread = omp_get_thread_num();
+        int nThreads = omp_get_num_threads();
+
+        valbuf_type vLocalStack;
+        value_type *stack = GetStack(nThread);
+        if (m_bNumaBulk)
+        {
+            ParserNumaTopology::Instance().BindThread(nThread, nThreads);
+            vLocalStack.resize(m_pRPN->GetMaxStackSize());
+            stack = &vLocalStack[0];
+        }
+
+        int iBegin, iEnd;
+        ParserNumaTopology::GetThreadRange(nThread, nThreads, nBulkSize, iBegin, iEnd);
+        for (int i = iBegin; i < iEnd; ++i)
+        {
+            ParseCmdCodeBulk(pRPN, i, nThread, stack);
+
+            // 结果从栈的位置1开始
+            for (int k = 0; k < nResults; ++k)
+                results[k][i] = stack[k + 1];
+        }
+    }
+#else
+    value_type *stack = GetStack(0);
+    for (int i = 0; i < nBulkSize; ++i)
+    {
+        ParseCmdCodeBulk(pRPN, i, 0, stack);
+        for (int k = 0; k < nResults; ++k)
+            results[k][i] = stack[k + 1];
     }
 #endif
 }
+
+//---------------------------------------------------------------------------
+/** \brief 异步批量求值。
+    \param a_vInput 本批次的输入列：变量名到列地址的映射，未列出的变量使用 DefineVar 定义的地址。
+           输入列必须连续存储，SetVarStride 和 SetVarBroadcast 只对未列出的变量有效
+    \param [out] results 本批次的结果，必须在返回的future完成之前保持有效
+    \param nBulkSize 本批次的行数
+    \return 所有行计算完成时就绪的future，求值中抛出的异常通过future传递
+
+    表达式在调用线程中编译，计算由库内共享的工作线程池完成。每个批次使用自己的字节码副本
+    （变量地址已重定位到本批次的输入列）和自己的计算栈，因此同一个表达式可以同时有多个批次在执行，
+    调用线程可以在此期间准备下一个批次。
+
+    在所有批次完成之前，解析器对象必须保持有效，并且不能修改（SetExpr、Define...、Clear...）
+    或同步求值。
+*/
+std::future<void> ParserBase::EvalAsync(const varmap_type &a_vInput, value_type *results, int nBulkSize)
+{
+    // 在调用线程中编译，工作线程只执行字节码
+    Compile();
+
+    std::map<value_type *, value_type *> vReloc;
+    for (varmap_type::const_iterator it = a_vInput.begin(); it != a_vInput.end(); ++it)
+    {
+        varmap_type::const_iterator item = m_VarDef.find(it->first);
+        if (item == m_VarDef.end())
+            Error(ecINVALID_NAME, -1, it->first);
+
+        if (it->second == nullptr)
+            Error(ecINVALID_VAR_PTR);
+
+        vReloc[item->second] = it->second;
+    }
+
+    // 批次状态由所有分块任务共享，最后一个完成的任务负责设置future
+    struct SAsyncBatch
+    {
+        ParserByteCode rpn;
+        std::promise<void> done;
+        std::atomic<int> nPending;
+        std::mutex mtx;
+        std::exception_ptr pError;
+    };
+
+    std::shared_ptr<SAsyncBatch> pBatch = std::make_shared<SAsyncBatch>();
+    pBatch->rpn = *m_pRPN;
+    pBatch->rpn.RelocateVars(vReloc);
+    std::future<void> future = pBatch->done.get_future();
+
+    ParserThreadPool &pool = ParserThreadPool::Instance();
+    int nChunks = std::max(1, std::min(pool.GetNumThreads(), nBulkSize));
+    pBatch->nPending = nChunks;
+
+    for (int c = 0; c < nChunks; ++c)
+    {
+        int iBegin, iEnd;
+        ParserNumaTopology::GetThreadRange(c, nChunks, nBulkSize, iBegin, iEnd);
+
+        pool.Submit([this, pBatch, results, iBegin, iEnd](int nThreadID)
+        {
+            try
+            {
+                valbuf_type vStack(pBatch->rpn.GetMaxStackSize());
+                const SToken *pRPN = pBatch->rpn.GetBase();
+                for (int i = iBegin; i < iEnd; ++i)
+                    results[i] = ParseCmdCodeBulk(pRPN, i, nThreadID, &vStack[0]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(pBatch->mtx);
+                if (!pBatch->pError)
+                    pBatch->pError = std::current_exception();
+            }
+
+            if (--pBatch->nPending == 0)
+            {
+                if (pBatch->pError)
+                    pBatch->done.set_exception(pBatch->pError);
+                else
+                    pBatch->done.set_value();
+            }
+        });
+    }
+
+    return future;
+}
 } // namespace mu
 
 #if defined(_MSC_VER)
@@ -2058,6 +3378,6 @@ void ParserBase::Eval(value_type *results, int nBulkSize)
 
 // GetNumResults() const：返回计算栈中的结果数。如果表达式包含逗号分隔子表达式，可能会有多个返回值。该函数返回可用结果的数量。
 
-// Eval(value_type *results, int nBulkSize)：对给定的表达式数组进行批量评估。函数内部调用CreateRPN()创建逆波兰表达式，并通过循环对每个表达式进行解析和计算。如果启用了OpenMP多线程支持，则使用多线程并行计算，否则使用单线程计算。最后，将计算结果存储在给定的结果数组results中。
+// Eval(value_type *results, int nBulkSize)：对给定的表达式数组进行批量评估。函数内部在需要时调用Compile()创建逆波兰表达式，并通过循环对每个表达式进行解析和计算。如果启用了OpenMP多线程支持，则使用多线程并行计算，否则使用单线程计算。最后，将计算结果存储在给定的结果数组results中。
 
 // 整个程序的功能是：提供了对包含逗号分隔子表达式的表达式进行评估和计算的功能。用户可以通过调用相应的函数来获取表达式的结果，并可以根据需要进行单个或批量的计算。
\ No newline at end of file
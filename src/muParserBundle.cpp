@@ -0,0 +1,366 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "muParserBundle.h"
+#include "muParserBase.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+/** \file
+	\brief Implementation of the precompiled expression bundle.
+
+	Layout of a bundle file (native byte order):
+	<ul>
+	  <li>header: magic, format version, size of char_type, number of expressions, offset of the index</li>
+	  <li>records: one record per expression in the format written by ParserBase::SaveByteCode</li>
+	  <li>index: record offset, record size, name offset and name length of each expression in id order</li>
+	  <li>order: ids of all expressions sorted by name</li>
+	  <li>names: the characters of all names</li>
+	</ul>
+*/
+
+namespace mu
+{
+	static const std::uint32_t c_nBundleMagic = 0x4c42756d; // "muBL"
+	static const std::uint32_t c_nBundleVersion = 1;
+	static const std::size_t c_nBundleHeaderSize = 4 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+	static const std::size_t c_nBundleEntrySize = 4 * sizeof(std::uint64_t);
+
+	/** \brief Read a value from a possibly unaligned position of the mapped file. */
+	template<typename T>
+	static T ReadMapped(const char* a_pData)
+	{
+		T val;
+		std::memcpy(&val, a_pData, sizeof(T));
+		return val;
+	}
+
+
+	//------------------------------------------------------------------------------
+	ParserBundleWriter::ParserBundleWriter()
+		: m_vName()
+		, m_vOffset(1, 0)
+		, m_NameIdx()
+		, m_sData()
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add the current expression of a parser to the bundle.
+		\param a_sName Unique name of the expression
+		\param a_Parser Parser holding the expression, it is compiled if necessary.
+		\return The id of the expression.
+		\throw ParserError if the name is already used or the expression can not be compiled.
+	*/
+	int ParserBundleWriter::Add(const string_type& a_sName, const ParserBase& a_Parser)
+	{
+		if (m_NameIdx.find(a_sName) != m_NameIdx.end())
+			throw ParserError(ecNAME_CONFLICT, a_sName);
+
+		std::ostringstream osRecord;
+		a_Parser.SaveByteCode(osRecord);
+		m_sData += osRecord.str();
+
+		int iId = (int)m_vName.size();
+		m_vName.push_back(a_sName);
+		m_vOffset.push_back(m_sData.size());
+		m_NameIdx[a_sName] = iId;
+		return iId;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Write the bundle file.
+		\throw ParserError if the file can not be written.
+	*/
+	void ParserBundleWriter::Write(const std::string& a_sFile) const
+	{
+		std::ofstream file(a_sFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file)
+			throw ParserError(ecINVALID_BYTECODE);
+
+		// the index starts at an 8 byte boundary
+		const std::uint64_t nCount = m_vName.size();
+		const std::uint64_t nIndex = (c_nBundleHeaderSize + m_sData.size() + 7) & ~(std::uint64_t)7;
+		const std::uint64_t nNames = nIndex + nCount * c_nBundleEntrySize + nCount * sizeof(std::uint32_t);
+
+		ParserByteCode::WriteBinary(file, c_nBundleMagic);
+		ParserByteCode::WriteBinary(file, c_nBundleVersion);
+		ParserByteCode::WriteBinary<std::uint32_t>(file, sizeof(char_type));
+		ParserByteCode::WriteBinary<std::uint32_t>(file, (std::uint32_t)nCount);
+		ParserByteCode::WriteBinary(file, nIndex);
+
+		file.write(m_sData.data(), m_sData.size());
+		for (std::uint64_t nPos = c_nBundleHeaderSize + m_sData.size(); nPos < nIndex; ++nPos)
+			file.put(0);
+
+		std::uint64_t nNameOffset = nNames;
+		for (std::size_t i = 0; i < m_vName.size(); ++i)
+		{
+			ParserByteCode::WriteBinary<std::uint64_t>(file, c_nBundleHeaderSize + m_vOffset[i]);
+			ParserByteCode::WriteBinary<std::uint64_t>(file, m_vOffset[i + 1] - m_vOffset[i]);
+			ParserByteCode::WriteBinary<std::uint64_t>(file, nNameOffset);
+			ParserByteCode::WriteBinary<std::uint64_t>(file, m_vName[i].length());
+			nNameOffset += m_vName[i].length() * sizeof(char_type);
+		}
+
+		for (const auto& item : m_NameIdx)
+			ParserByteCode::WriteBinary<std::uint32_t>(file, item.second);
+
+		for (const auto& sName : m_vName)
+			file.write(reinterpret_cast<const char*>(sName.data()), sName.length() * sizeof(char_type));
+
+		if (!file)
+			throw ParserError(ecINVALID_BYTECODE);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Return the number of expressions added so far. */
+	int ParserBundleWriter::GetSize() const
+	{
+		return (int)m_vName.size();
+	}
+
+
+	//------------------------------------------------------------------------------
+	ParserBundle::ParserBundle()
+		: m_pData(nullptr)
+		, m_nSize(0)
+		, m_nEntries(0)
+		, m_nIndex(0)
+	{}
+
+	//------------------------------------------------------------------------------
+	ParserBundle::ParserBundle(const std::string& a_sFile)
+		: ParserBundle()
+	{
+		Open(a_sFile);
+	}
+
+	//------------------------------------------------------------------------------
+	ParserBundle::~ParserBundle()
+	{
+		Close();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Map a bundle file into memory.
+		\throw ParserError (ecINVALID_BYTECODE) if the file can not be mapped or is no compatible bundle.
+	*/
+	void ParserBundle::Open(const std::string& a_sFile)
+	{
+		Close();
+
+#if defined(_WIN32)
+		HANDLE hFile = ::CreateFileA(a_sFile.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			throw ParserError(ecINVALID_BYTECODE);
+
+		// the view keeps the mapping alive, both handles can be closed right away
+		LARGE_INTEGER nFileSize;
+		HANDLE hMapping = nullptr;
+		if (::GetFileSizeEx(hFile, &nFileSize) && nFileSize.QuadPart >= (LONGLONG)c_nBundleHeaderSize)
+			hMapping = ::CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		void* pData = (hMapping != nullptr) ? ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (hMapping != nullptr)
+			::CloseHandle(hMapping);
+
+		::CloseHandle(hFile);
+		if (pData == nullptr)
+			throw ParserError(ecINVALID_BYTECODE);
+
+		m_pData = static_cast<const char*>(pData);
+		m_nSize = (std::size_t)nFileSize.QuadPart;
+#else
+		int hFile = ::open(a_sFile.c_str(), O_RDONLY);
+		if (hFile < 0)
+			throw ParserError(ecINVALID_BYTECODE);
+
+		// the mapping stays valid after the file is closed
+		struct stat st;
+		void* pData = MAP_FAILED;
+		if (::fstat(hFile, &st) == 0 && st.st_size >= (off_t)c_nBundleHeaderSize)
+			pData = ::mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, hFile, 0);
+
+		::close(hFile);
+		if (pData == MAP_FAILED)
+			throw ParserError(ecINVALID_BYTECODE);
+
+		m_pData = static_cast<const char*>(pData);
+		m_nSize = (std::size_t)st.st_size;
+#endif
+
+		std::uint32_t nCount = ReadMapped<std::uint32_t>(m_pData + 3 * sizeof(std::uint32_t));
+		std::uint64_t nIndex = ReadMapped<std::uint64_t>(m_pData + 4 * sizeof(std::uint32_t));
+		if (ReadMapped<std::uint32_t>(m_pData) != c_nBundleMagic ||
+			ReadMapped<std::uint32_t>(m_pData + sizeof(std::uint32_t)) != c_nBundleVersion ||
+			ReadMapped<std::uint32_t>(m_pData + 2 * sizeof(std::uint32_t)) != sizeof(char_type) ||
+			nIndex < c_nBundleHeaderSize || nIndex > m_nSize ||
+			nCount > (m_nSize - nIndex) / (c_nBundleEntrySize + sizeof(std::uint32_t)))
+		{
+			Close();
+			throw ParserError(ecINVALID_BYTECODE);
+		}
+
+		m_nEntries = (int)nCount;
+		m_nIndex = (std::size_t)nIndex;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Unmap the bundle file. */
+	void ParserBundle::Close()
+	{
+		if (m_pData == nullptr)
+			return;
+
+#if defined(_WIN32)
+		::UnmapViewOfFile(m_pData);
+#else
+		::munmap(const_cast<char*>(m_pData), m_nSize);
+#endif
+
+		m_pData = nullptr;
+		m_nSize = 0;
+		m_nEntries = 0;
+		m_nIndex = 0;
+	}
+
+	//------------------------------------------------------------------------------
+	bool ParserBundle::IsOpen() const
+	{
+		return m_pData != nullptr;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Return the number of expressions in the bundle. */
+	int ParserBundle::GetSize() const
+	{
+		return m_nEntries;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Read and check the index entry of an expression.
+		\throw ParserError if the id is out of range or the entry points outside of the file.
+	*/
+	ParserBundle::SEntry ParserBundle::GetEntry(int a_iId) const
+	{
+		if (a_iId < 0 || a_iId >= m_nEntries)
+			throw ParserError(ecINVALID_NAME);
+
+		SEntry entry;
+		const char* pEntry = m_pData + m_nIndex + (std::size_t)a_iId * c_nBundleEntrySize;
+		entry.nRecOffset = ReadMapped<std::uint64_t>(pEntry);
+		entry.nRecSize = ReadMapped<std::uint64_t>(pEntry + sizeof(std::uint64_t));
+		entry.nNameOffset = ReadMapped<std::uint64_t>(pEntry + 2 * sizeof(std::uint64_t));
+		entry.nNameLen = ReadMapped<std::uint64_t>(pEntry + 3 * sizeof(std::uint64_t));
+
+		if (entry.nRecOffset > m_nSize || entry.nRecSize > m_nSize - entry.nRecOffset ||
+			entry.nNameOffset > m_nSize || entry.nNameLen > (m_nSize - entry.nNameOffset) / sizeof(char_type))
+		{
+			throw ParserError(ecINVALID_BYTECODE);
+		}
+
+		return entry;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Return the name of an expression. */
+	string_type ParserBundle::GetName(int a_iId) const
+	{
+		SEntry entry = GetEntry(a_iId);
+		string_type sName((std::size_t)entry.nNameLen, 0);
+		if (entry.nNameLen)
+			std::memcpy(&sName[0], m_pData + entry.nNameOffset, sName.length() * sizeof(char_type));
+
+		return sName;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Find an expression by name.
+		\return The id of the expression or -1 if there is no expression with this name.
+
+		The sorted id table of the file is searched binary, no index is built in memory.
+	*/
+	int ParserBundle::Find(const string_type& a_sName) const
+	{
+		const char* pOrder = m_pData + m_nIndex + (std::size_t)m_nEntries * c_nBundleEntrySize;
+		int iLow = 0, iHigh = m_nEntries;
+		while (iLow < iHigh)
+		{
+			int iMid = iLow + (iHigh - iLow) / 2;
+			int iId = (int)ReadMapped<std::uint32_t>(pOrder + iMid * sizeof(std::uint32_t));
+			int iCmp = GetName(iId).compare(a_sName);
+			if (iCmp == 0)
+				return iId;
+			else if (iCmp < 0)
+				iLow = iMid + 1;
+			else
+				iHigh = iMid;
+		}
+
+		return -1;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Set an expression of the bundle as the current expression of a parser.
+		\throw ParserError see ParserBase::LoadByteCode
+
+		The record is read straight from the mapped file.
+	*/
+	void ParserBundle::Load(int a_iId, ParserBase& a_Parser) const
+	{
+		SEntry entry = GetEntry(a_iId);
+		a_Parser.LoadByteCode(m_pData + entry.nRecOffset, (std::size_t)entry.nRecSize);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Set an expression of the bundle as the current expression of a parser.
+		\throw ParserError (ecINVALID_NAME) if the bundle contains no expression with this name.
+	*/
+	void ParserBundle::Load(const string_type& a_sName, ParserBase& a_Parser) const
+	{
+		int iId = Find(a_sName);
+		if (iId < 0)
+			throw ParserError(ecINVALID_NAME, a_sName);
+
+		Load(iId, a_Parser);
+	}
+} // namespace mu
@@ -28,6 +28,7 @@
 #include "muParserBytecode.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <stack>
 #include <vector>
@@ -52,6 +53,15 @@ namespace mu
 		m_vRPN.reserve(50);
 	}
 
+	/** \brief 构造函数，字节码向量的内存取自给定的内存资源。
+		\param a_pResource 内存资源，nullptr表示默认资源。
+	*/
+	ParserByteCode::ParserByteCode(ParserMemoryResource* a_pResource)
+		: m_iStackPos(0), m_iMaxStackSize(0), m_vRPN(rpn_type::allocator_type(a_pResource)), m_bEnableOptimizer(true)
+	{
+		m_vRPN.reserve(50);
+	}
+
 	/** \brief 复制构造函数。
 		实现为Assign(const ParserByteCode &a_ByteCode)。
 	*/
@@ -74,6 +84,11 @@ namespace mu
 		m_bEnableOptimizer = bStat;
 	}
 
+	bool ParserByteCode::IsOptimizerEnabled() const
+	{
+		return m_bEnableOptimizer;
+	}
+
 	/** \brief 将另一个对象的状态复制到此对象。
 		\throw nowthrow
 	*/
@@ -90,9 +105,10 @@ namespace mu
 
 	/** \brief 向字节码添加变量指针。
 		\param a_pVar 要添加的指针。
+		\param a_iStride 批量模式下相邻两个值之间的字节距离。
 		\throw nothrow
 	*/
-	void ParserByteCode::AddVar(value_type *a_pVar)
+	void ParserByteCode::AddVar(value_type *a_pVar, std::ptrdiff_t a_iStride)
 	{
 		++m_iStackPos;
 		m_iMaxStackSize = std::max(m_iMaxStackSize, (size_t)m_iStackPos);
@@ -103,6 +119,7 @@ namespace mu
 		tok.Val.ptr = a_pVar;
 		tok.Val.data = 1;
 		tok.Val.data2 = 0;
+		tok.Val.stride = a_iStride;
 		m_vRPN.push_back(tok);
 	}
 
@@ -127,6 +144,7 @@ namespace mu
 		tok.Val.ptr = nullptr;
 		tok.Val.data = 0;
 		tok.Val.data2 = a_fVal;
+		tok.Val.stride = 0;
 		m_vRPN.push_back(tok);
 	}
 
@@ -201,6 +219,15 @@ namespace mu
 	// 功能： 执行常量折叠操作，根据给定的操作符对逆波兰表达式中的操作数进行计算，并更新表达式中的值。
 
 	// 注意： 以上代码中使用的变量和类型可能未在提供的代码片段中定义，因此无法确定其具体含义和数据类型。
+	/** \brief 检查两个变量令牌是否引用同一变量（地址和步长均相同）。
+
+		地址相同但步长不同的变量在批量模式下读取的是不同的值，因此不能合并。
+	*/
+	bool ParserByteCode::IsSameVar(const SToken &a_Tok1, const SToken &a_Tok2)
+	{
+		return a_Tok1.Val.ptr == a_Tok2.Val.ptr && a_Tok1.Val.stride == a_Tok2.Val.stride;
+	}
+
 	void ParserByteCode::AddOp(ECmdCode a_Oprt)
 	{
 		bool bOptimized = false;
@@ -230,6 +257,7 @@ namespace mu
 							m_vRPN[sz - 2].Val.ptr = nullptr;
 							m_vRPN[sz - 2].Val.data = 0;
 							m_vRPN[sz - 2].Val.data2 = 1;
+							m_vRPN[sz - 2].Val.stride = 0;
 						}
 						else if (m_vRPN[sz - 1].Val.data2 == 1)
 							m_vRPN[sz - 2].Cmd = cmVAR;
@@ -254,10 +282,10 @@ namespace mu
 						(m_vRPN[sz - 1].Cmd == cmVAL && m_vRPN[sz - 2].Cmd == cmVAR) ||
 						(m_vRPN[sz - 1].Cmd == cmVAL && m_vRPN[sz - 2].Cmd == cmVARMUL) ||
 						(m_vRPN[sz - 1].Cmd == cmVARMUL && m_vRPN[sz - 2].Cmd == cmVAL) ||
-						(m_vRPN[sz - 1].Cmd == cmVAR && m_vRPN[sz - 2].Cmd == cmVAR && m_vRPN[sz - 2].Val.ptr == m_vRPN[sz - 1].Val.ptr) ||
-						(m_vRPN[sz - 1].Cmd == cmVAR && m_vRPN[sz - 2].Cmd == cmVARMUL && m_vRPN[sz - 2].Val.ptr == m_vRPN[sz - 1].Val.ptr) ||
-						(m_vRPN[sz - 1].Cmd == cmVARMUL && m_vRPN[sz - 2].Cmd == cmVAR && m_vRPN[sz - 2].Val.ptr == m_vRPN[sz - 1].Val.ptr) ||
-						(m_vRPN[sz - 1].Cmd == cmVARMUL && m_vRPN[sz - 2].Cmd == cmVARMUL && m_vRPN[sz - 2].Val.ptr == m_vRPN[sz - 1].Val.ptr))
+						(m_vRPN[sz - 1].Cmd == cmVAR && m_vRPN[sz - 2].Cmd == cmVAR && IsSameVar(m_vRPN[sz - 2], m_vRPN[sz - 1])) ||
+						(m_vRPN[sz - 1].Cmd == cmVAR && m_vRPN[sz - 2].Cmd == cmVARMUL && IsSameVar(m_vRPN[sz - 2], m_vRPN[sz - 1])) ||
+						(m_vRPN[sz - 1].Cmd == cmVARMUL && m_vRPN[sz - 2].Cmd == cmVAR && IsSameVar(m_vRPN[sz - 2], m_vRPN[sz - 1])) ||
+						(m_vRPN[sz - 1].Cmd == cmVARMUL && m_vRPN[sz - 2].Cmd == cmVARMUL && IsSameVar(m_vRPN[sz - 2], m_vRPN[sz - 1])))
 					{
 						MUP_ASSERT(
 							(m_vRPN[sz - 2].Val.ptr == nullptr && m_vRPN[sz - 1].Val.ptr != nullptr) ||
@@ -266,6 +294,7 @@ namespace mu
 
 						m_vRPN[sz - 2].Cmd = cmVARMUL;
 						m_vRPN[sz - 2].Val.ptr = (value_type *)((long long)(m_vRPN[sz - 2].Val.ptr) | (long long)(m_vRPN[sz - 1].Val.ptr)); // 变量
+						m_vRPN[sz - 2].Val.stride |= m_vRPN[sz - 1].Val.stride;																// 步长
 						m_vRPN[sz - 2].Val.data2 += ((a_Oprt == cmSUB) ? -1 : 1) * m_vRPN[sz - 1].Val.data2;								// 偏移量
 						m_vRPN[sz - 2].Val.data += ((a_Oprt == cmSUB) ? -1 : 1) * m_vRPN[sz - 1].Val.data;									// 乘法因子
 						m_vRPN.pop_back();
@@ -279,6 +308,7 @@ namespace mu
 					{
 						m_vRPN[sz - 2].Cmd = cmVARMUL;
 						m_vRPN[sz - 2].Val.ptr = (value_type *)((long long)(m_vRPN[sz - 2].Val.ptr) | (long long)(m_vRPN[sz - 1].Val.ptr));
+						m_vRPN[sz - 2].Val.stride |= m_vRPN[sz - 1].Val.stride;
 						m_vRPN[sz - 2].Val.data = m_vRPN[sz - 2].Val.data2 + m_vRPN[sz - 1].Val.data2;
 						m_vRPN[sz - 2].Val.data2 = 0;
 						m_vRPN.pop_back();
@@ -291,6 +321,7 @@ namespace mu
 						// 优化：2*(3*b+1) 或者 (3*b+1)*2 -> 6*b+2
 						m_vRPN[sz - 2].Cmd = cmVARMUL;
 						m_vRPN[sz - 2].Val.ptr = (value_type *)((long long)(m_vRPN[sz - 2].Val.ptr) | (long long)(m_vRPN[sz - 1].Val.ptr));
+						m_vRPN[sz - 2].Val.stride |= m_vRPN[sz - 1].Val.stride;
 						if (m_vRPN[sz - 1].Cmd == cmVAL)
 						{
 							m_vRPN[sz - 2].Val.data *= m_vRPN[sz - 1].Val.data2;
@@ -306,7 +337,7 @@ namespace mu
 					}
 					else if (
 						m_vRPN[sz - 1].Cmd == cmVAR && m_vRPN[sz - 2].Cmd == cmVAR &&
-						m_vRPN[sz - 1].Val.ptr == m_vRPN[sz - 2].Val.ptr)
+						IsSameVar(m_vRPN[sz - 1], m_vRPN[sz - 2]))
 					{
 						// 优化：a*a -> a^2
 						m_vRPN[sz - 2].Cmd = cmVARPOW2;
@@ -343,8 +374,50 @@ namespace mu
 			tok.Cmd = a_Oprt;
 			m_vRPN.push_back(tok);
 		}
+	}
 		// 如果无法应用优化，将数值写入RPN向量。
 
+		/** \brief 将字节码中的变量地址替换为新的地址。
+			\param a_vReloc 旧地址到新地址的映射
+
+			所有替换在一次遍历中完成，因此新旧地址集合可以重叠。新地址是连续存储的列，
+			因此被替换的变量的步长改为 sizeof(value_type)，不沿用 SetVarStride 或 SetVarBroadcast 的设置。
+		*/
+		void ParserByteCode::RelocateVars(const std::map<value_type *, value_type *> &a_vReloc)
+		{
+			for (std::size_t i = 0; i < m_vRPN.size(); ++i)
+			{
+				value_type **ppVar = nullptr;
+				std::ptrdiff_t *pStride = nullptr;
+				switch (m_vRPN[i].Cmd)
+				{
+				case cmVAR:
+				case cmVARPOW2:
+				case cmVARPOW3:
+				case cmVARPOW4:
+				case cmVARMUL:
+					ppVar = &m_vRPN[i].Val.ptr;
+					pStride = &m_vRPN[i].Val.stride;
+					break;
+
+				case cmASSIGN:
+					ppVar = &m_vRPN[i].Oprt.ptr;
+					pStride = &m_vRPN[i].Oprt.stride;
+					break;
+
+				default:
+					continue;
+				}
+
+				std::map<value_type *, value_type *>::const_iterator item = a_vReloc.find(*ppVar);
+				if (item != a_vReloc.end())
+				{
+					*ppVar = item->second;
+					*pStride = sizeof(value_type);
+				}
+			}
+		}
+
 		void ParserByteCode::AddIfElse(ECmdCode a_Oprt)
 		{
 			SToken tok;
@@ -359,17 +432,19 @@ namespace mu
 		<ul>
 		  <li>cmASSIGN代码</li>
 		  <li>目标变量的指针</li>
+		  <li>批量模式下目标变量的步长（字节）</li>
 		</ul>
 
 		\sa  ParserToken::ECmdCode
 		*/
-		void ParserByteCode::AddAssignOp(value_type * a_pVar)
+		void ParserByteCode::AddAssignOp(value_type * a_pVar, std::ptrdiff_t a_iStride)
 		{
 			--m_iStackPos;
 
 			SToken tok;
 			tok.Cmd = cmASSIGN;
 			tok.Oprt.ptr = a_pVar;
+			tok.Oprt.stride = a_iStride;
 			m_vRPN.push_back(tok);
 		}
 		// 向RPN向量中添加赋值操作符。注释解释了字节码中操作符的条目内容，包括操作符代码和目标变量的指针。
@@ -450,6 +525,7 @@ namespace mu
 				tok.Val.data = 0;
 				tok.Val.data2 = val;
 				tok.Val.ptr = nullptr;
+				tok.Val.stride = 0;
 				m_vRPN.push_back(tok);
 			}
 			else
@@ -458,6 +534,7 @@ namespace mu
 				tok.Cmd = cmFUNC;
 				tok.Fun.argc = a_iArgc;
 				tok.Fun.cb = a_pFun;
+				tok.Fun.optimizable = isFunctionOptimizable;
 				m_vRPN.push_back(tok);
 			}
 
@@ -479,6 +556,7 @@ namespace mu
 			tok.Cmd = cmFUNC_BULK;
 			tok.Fun.argc = a_iArgc;
 			tok.Fun.cb = a_pFun;
+			tok.Fun.optimizable = false;
 			m_vRPN.push_back(tok);
 		}
 
@@ -487,7 +565,7 @@ namespace mu
 
 			字符串函数入口由返回值的堆栈位置组成，后跟一个cmSTRFUNC代码、函数指针和解析器维护的字符串缓冲区中的索引。
 		*/
-		void ParserByteCode::AddStrFun(generic_callable_type a_pFun, int a_iArgc, int a_iIdx)
+		void ParserByteCode::AddStrFun(generic_callable_type a_pFun, int a_iArgc, int a_iIdx, bool a_bStrHash)
 		{
 			m_iStackPos = m_iStackPos - a_iArgc + 1;
 
@@ -496,6 +574,8 @@ namespace mu
 			tok.Fun.argc = a_iArgc;
 			tok.Fun.idx = a_iIdx;
 			tok.Fun.cb = a_pFun;
+			tok.Fun.optimizable = false;
+			tok.Fun.strhash = a_bStrHash;
 			m_vRPN.push_back(tok);
 
 			m_iMaxStackSize = std::max(m_iMaxStackSize, (size_t)m_iStackPos);
@@ -510,7 +590,7 @@ namespace mu
 			SToken tok;
 			tok.Cmd = cmEND;
 			m_vRPN.push_back(tok);
-			rpn_type(m_vRPN).swap(m_vRPN); // 收缩字节码向量以适应
+			rpn_type(m_vRPN, m_vRPN.get_allocator()).swap(m_vRPN); // 收缩字节码向量以适应，保留其内存资源
 
 			// 确定if-then-else跳转偏移量
 			std::stack<int> stIf, stElse;
@@ -562,6 +642,380 @@ namespace mu
 			m_iMaxStackSize = 0;
 		}
 
+		/** \brief 以二进制形式写入一个字符串：长度后跟字符数据。 */
+		void ParserByteCode::WriteString(std::ostream &a_Stream, const string_type &a_sVal)
+		{
+			WriteBinary<std::uint32_t>(a_Stream, (std::uint32_t)a_sVal.length());
+			a_Stream.write(reinterpret_cast<const char *>(a_sVal.data()), a_sVal.length() * sizeof(char_type));
+		}
+
+		/** \brief 从内存区域读取 WriteString 写入的字符串并移动读取位置。
+			\throw ParserError 如果数据提前结束。
+		*/
+		string_type ParserByteCode::ReadString(const char *&a_pPos, const char *a_pEnd)
+		{
+			std::uint32_t nLen = ReadBinary<std::uint32_t>(a_pPos, a_pEnd);
+			if (nLen > MaxLenExpression || (std::size_t)(a_pEnd - a_pPos) < nLen * sizeof(char_type))
+				throw ParserError(ecINVALID_BYTECODE);
+
+			string_type sVal(nLen, 0);
+			if (nLen)
+				std::memcpy(&sVal[0], a_pPos, nLen * sizeof(char_type));
+
+			a_pPos += nLen * sizeof(char_type);
+			return sVal;
+		}
+
+		/** \brief 调用一个字符串函数。
+			\param a_Tok 字符串函数的指令
+			\param a_StrBuf 字符串参数所在的字符串池
+			\param a_pArg 数值参数，个数为 a_Tok.Fun.argc
+			\throw ParserError 如果字符串索引或参数个数无效。
+
+			所有求值方式（字节码、ParserProgram 和 ParserFloatEngine）都通过此函数调用字符串函数。
+		*/
+		value_type ParserByteCode::CallStrFun(const SToken &a_Tok, const ParserStringPool &a_StrBuf, const value_type *a_pArg)
+		{
+			if (a_Tok.Fun.idx < 0 || a_Tok.Fun.idx >= (int)a_StrBuf.size())
+				throw ParserError(ecINTERNAL_ERROR);
+
+			const string_type &sArg = a_StrBuf.Get(a_Tok.Fun.idx);
+			const char_type *s = sArg.c_str();
+			const value_type *a = a_pArg;
+			if (a_Tok.Fun.strhash)
+			{
+				// 字符串的长度和哈希值在加入字符串池时已经计算好
+				const std::size_t n = sArg.length(), h = a_StrBuf.GetHash(a_Tok.Fun.idx);
+				switch (a_Tok.Fun.argc)
+				{
+				case 0:  return a_Tok.Fun.cb.call_strhashfun<1>(s, n, h);
+				case 1:  return a_Tok.Fun.cb.call_strhashfun<2>(s, n, h, a[0]);
+				case 2:  return a_Tok.Fun.cb.call_strhashfun<3>(s, n, h, a[0], a[1]);
+				case 3:  return a_Tok.Fun.cb.call_strhashfun<4>(s, n, h, a[0], a[1], a[2]);
+				case 4:  return a_Tok.Fun.cb.call_strhashfun<5>(s, n, h, a[0], a[1], a[2], a[3]);
+				case 5:  return a_Tok.Fun.cb.call_strhashfun<6>(s, n, h, a[0], a[1], a[2], a[3], a[4]);
+				default:
+					throw ParserError(ecINTERNAL_ERROR);
+				}
+			}
+
+			switch (a_Tok.Fun.argc)
+			{
+			case 0:  return a_Tok.Fun.cb.call_strfun<1>(s);
+			case 1:  return a_Tok.Fun.cb.call_strfun<2>(s, a[0]);
+			case 2:  return a_Tok.Fun.cb.call_strfun<3>(s, a[0], a[1]);
+			case 3:  return a_Tok.Fun.cb.call_strfun<4>(s, a[0], a[1], a[2]);
+			case 4:  return a_Tok.Fun.cb.call_strfun<5>(s, a[0], a[1], a[2], a[3]);
+			case 5:  return a_Tok.Fun.cb.call_strfun<6>(s, a[0], a[1], a[2], a[3], a[4]);
+			default:
+				throw ParserError(ecINTERNAL_ERROR);
+			}
+		}
+
+		/** \brief 把最终的字节码写入二进制数据流。
+			\param a_Stream 目标数据流
+			\param a_Symbols 用于把变量地址和回调函数转换为名称的符号表
+			\throw ParserError 如果字节码尚未完成或者引用了符号表中没有的变量或函数。
+
+			变量和回调函数按名称保存，加载时根据加载解析器的符号表重新定位。
+			数值按本机二进制格式保存，因此数据只能在相同平台上加载。
+		*/
+		void ParserByteCode::Save(std::ostream &a_Stream, const ParserByteCodeSymbols &a_Symbols) const
+		{
+			if (m_vRPN.empty() || m_vRPN.back().Cmd != cmEND)
+				throw ParserError(ecINTERNAL_ERROR);
+
+			WriteBinary<std::uint64_t>(a_Stream, m_iMaxStackSize);
+			WriteBinary<std::uint32_t>(a_Stream, m_iStackPos);
+			WriteBinary<std::uint8_t>(a_Stream, m_bEnableOptimizer);
+			WriteBinary<std::uint64_t>(a_Stream, m_vRPN.size());
+
+			string_type sName;
+			for (const SToken &tok : m_vRPN)
+			{
+				WriteBinary<std::int32_t>(a_Stream, tok.Cmd);
+				switch (tok.Cmd)
+				{
+				case cmVAL:
+				case cmVAR:
+				case cmVARPOW2:
+				case cmVARPOW3:
+				case cmVARPOW4:
+				case cmVARMUL:
+					sName.clear();
+					if (tok.Val.ptr != nullptr && !a_Symbols.FindVarName(tok.Val.ptr, sName))
+						throw ParserError(ecBYTECODE_SYMBOL_MISMATCH);
+
+					WriteString(a_Stream, sName);
+					WriteBinary(a_Stream, tok.Val.data);
+					WriteBinary(a_Stream, tok.Val.data2);
+					break;
+
+				case cmASSIGN:
+					if (!a_Symbols.FindVarName(tok.Oprt.ptr, sName))
+						throw ParserError(ecBYTECODE_SYMBOL_MISMATCH);
+
+					WriteString(a_Stream, sName);
+					break;
+
+				case cmIF:
+				case cmELSE:
+					WriteBinary<std::int32_t>(a_Stream, tok.Oprt.offset);
+					break;
+
+				case cmFUNC:
+				case cmFUNC_STR:
+				case cmFUNC_BULK:
+					{
+						int iTable = 0;
+						if (!a_Symbols.FindCallbackName(tok.Fun.cb, iTable, sName))
+							throw ParserError(ecBYTECODE_SYMBOL_MISMATCH);
+
+						// 回调的签名一并保存，加载时用它检查同名回调是否可以用同样的方式调用
+						const ParserCallback *pCallback = a_Symbols.GetCallback(iTable, sName);
+						WriteBinary<std::int32_t>(a_Stream, iTable);
+						WriteString(a_Stream, sName);
+						WriteBinary<std::int32_t>(a_Stream, pCallback->GetArgc());
+						WriteBinary<std::int32_t>(a_Stream, pCallback->GetCode());
+						WriteBinary<std::int32_t>(a_Stream, pCallback->GetType());
+						// 第0位：带用户数据；第1位：回调接收字符串的长度和哈希值
+						WriteBinary<std::uint8_t>(a_Stream, (std::uint8_t)((pCallback->GetUserData() != nullptr) | (pCallback->HasStrHash() << 1)));
+						WriteBinary<std::int32_t>(a_Stream, tok.Fun.argc);
+						WriteBinary<std::int32_t>(a_Stream, tok.Fun.idx);
+						WriteBinary<std::uint8_t>(a_Stream, tok.Fun.optimizable);
+					}
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		/** \brief 从内存区域读取 Save 写入的字节码，并把其中的变量和回调函数重新定位到给定的符号表。
+			\param a_pPos 读取位置，返回时指向字节码之后的数据
+			\param a_pEnd 内存区域的结尾
+			\param a_Symbols 加载解析器的符号表
+			\throw ParserError 如果数据损坏（ecINVALID_BYTECODE），或者某个符号未定义或签名不同（ecBYTECODE_SYMBOL_MISMATCH）。
+
+			函数的参数个数必须与加载解析器中的回调一致，栈的大小通过模拟加载的指令重新计算，因此损坏的数据
+			不会导致求值时越界访问栈。出错时当前字节码保持不变。
+		*/
+		void ParserByteCode::Load(const char *&a_pPos, const char *a_pEnd, const ParserByteCodeSymbols &a_Symbols)
+		{
+			// 保存的栈大小和栈位置不被使用，它们在读入全部指令之后重新计算
+			ReadBinary<std::uint64_t>(a_pPos, a_pEnd);
+			ReadBinary<std::uint32_t>(a_pPos, a_pEnd);
+			bool bEnableOptimizer = ReadBinary<std::uint8_t>(a_pPos, a_pEnd) != 0;
+			std::uint64_t nSize = ReadBinary<std::uint64_t>(a_pPos, a_pEnd);
+			if (nSize == 0 || nSize > MaxLenExpression * 4)
+				throw ParserError(ecINVALID_BYTECODE);
+
+			rpn_type vRPN(m_vRPN.get_allocator());
+			vRPN.resize((std::size_t)nSize);
+			for (std::size_t i = 0; i < vRPN.size(); ++i)
+			{
+				SToken &tok = vRPN[i];
+				std::int32_t iCmd = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+				if (iCmd < 0 || iCmd >= cmUNKNOWN)
+					throw ParserError(ecINVALID_BYTECODE);
+
+				tok.Cmd = (ECmdCode)iCmd;
+				switch (tok.Cmd)
+				{
+				case cmVAL:
+				case cmVAR:
+				case cmVARPOW2:
+				case cmVARPOW3:
+				case cmVARPOW4:
+				case cmVARMUL:
+					{
+						string_type sName = ReadString(a_pPos, a_pEnd);
+						tok.Val.ptr = nullptr;
+						tok.Val.stride = 0;
+						if (sName.length())
+						{
+							tok.Val.ptr = a_Symbols.GetVarAddr(sName, tok.Val.stride);
+							if (tok.Val.ptr == nullptr)
+								throw ParserError(ecBYTECODE_SYMBOL_MISMATCH, sName);
+						}
+
+						tok.Val.data = ReadBinary<value_type>(a_pPos, a_pEnd);
+						tok.Val.data2 = ReadBinary<value_type>(a_pPos, a_pEnd);
+					}
+					break;
+
+				case cmASSIGN:
+					{
+						string_type sName = ReadString(a_pPos, a_pEnd);
+						tok.Oprt.ptr = a_Symbols.GetVarAddr(sName, tok.Oprt.stride);
+						tok.Oprt.offset = 0;
+						if (tok.Oprt.ptr == nullptr)
+							throw ParserError(ecBYTECODE_SYMBOL_MISMATCH, sName);
+					}
+					break;
+
+				case cmIF:
+				case cmELSE:
+					tok.Oprt.ptr = nullptr;
+					tok.Oprt.stride = 0;
+					tok.Oprt.offset = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+					if (tok.Oprt.offset <= 0 || i + tok.Oprt.offset >= vRPN.size())
+						throw ParserError(ecINVALID_BYTECODE);
+					break;
+
+				case cmFUNC:
+				case cmFUNC_STR:
+				case cmFUNC_BULK:
+					{
+						std::int32_t iTable = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						string_type sName = ReadString(a_pPos, a_pEnd);
+						std::int32_t iArgc = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						std::int32_t iCode = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						std::int32_t iType = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						std::uint8_t nFlags = ReadBinary<std::uint8_t>(a_pPos, a_pEnd);
+						bool bUserData = (nFlags & 1) != 0;
+						bool bStrHash = (nFlags & 2) != 0;
+						tok.Fun.argc = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						tok.Fun.idx = ReadBinary<std::int32_t>(a_pPos, a_pEnd);
+						tok.Fun.optimizable = ReadBinary<std::uint8_t>(a_pPos, a_pEnd) != 0;
+
+						// 只有签名完全相同的回调才能替换原来的函数，否则调用时的参数类型不匹配
+						const ParserCallback *pCallback = a_Symbols.GetCallback(iTable, sName);
+						if (pCallback == nullptr ||
+							pCallback->GetArgc() != iArgc ||
+							pCallback->GetCode() != iCode ||
+							pCallback->GetType() != iType ||
+							(pCallback->GetUserData() != nullptr) != bUserData ||
+							pCallback->HasStrHash() != bStrHash)
+						{
+							throw ParserError(ecBYTECODE_SYMBOL_MISMATCH, sName);
+						}
+
+						// 参数个数决定求值时从栈中取出多少个值，因此必须与回调一致；只有多参数函数可以使用负数
+						bool bCodeOk = (tok.Cmd == cmFUNC)
+							? (iCode == cmFUNC || iCode == cmOPRT_BIN || iCode == cmOPRT_INFIX || iCode == cmOPRT_POSTFIX)
+							: (iCode == tok.Cmd);
+						bool bArgcOk = (iArgc >= 0)
+							? (tok.Fun.argc == iArgc)
+							: (tok.Cmd == cmFUNC && tok.Fun.argc < 0 && tok.Fun.argc >= -(int)MaxLenExpression);
+						if (!bCodeOk || !bArgcOk)
+							throw ParserError(ecINVALID_BYTECODE);
+
+						tok.Fun.cb = generic_callable_type{ (erased_fun_type)pCallback->GetAddr(), pCallback->GetUserData() };
+						tok.Fun.strhash = bStrHash;
+					}
+					break;
+
+				default:
+					break;
+				}
+			}
+
+			if (vRPN.back().Cmd != cmEND)
+				throw ParserError(ecINVALID_BYTECODE);
+
+			// 保存的栈大小不可信：模拟加载的逆波兰式以重新计算栈的最大深度，并检查每条指令都有足够的操作数。
+			// vBranchDepth 记录跳转目标处的栈深度，两个条件分支结束时的栈深度必须相同。
+			std::vector<int> vBranchDepth(vRPN.size(), -1);
+			int iDepth = 0, iMaxDepth = 0;
+			for (std::size_t i = 0; i < vRPN.size(); ++i)
+			{
+				const SToken &tok = vRPN[i];
+
+				// 紧跟在 cmELSE 之后的指令只能通过 cmIF 的跳转到达
+				if (i > 0 && vRPN[i - 1].Cmd == cmELSE)
+				{
+					if (vBranchDepth[i] < 0)
+						throw ParserError(ecINVALID_BYTECODE);
+
+					iDepth = vBranchDepth[i];
+				}
+				else if (vBranchDepth[i] >= 0 && vBranchDepth[i] != iDepth)
+					throw ParserError(ecINVALID_BYTECODE);
+
+				int nPop = 0, nPush = 0;
+				switch (tok.Cmd)
+				{
+				case cmLE:
+				case cmGE:
+				case cmNEQ:
+				case cmEQ:
+				case cmLT:
+				case cmGT:
+				case cmADD:
+				case cmSUB:
+				case cmMUL:
+				case cmDIV:
+				case cmPOW:
+				case cmLAND:
+				case cmLOR:
+				case cmASSIGN:
+					nPop = 2;
+					nPush = 1;
+					break;
+
+				case cmVAL:
+				case cmVAR:
+				case cmVARPOW2:
+				case cmVARPOW3:
+				case cmVARPOW4:
+				case cmVARMUL:
+					nPush = 1;
+					break;
+
+				case cmFUNC:
+				case cmFUNC_STR:
+				case cmFUNC_BULK:
+					nPop = std::abs(tok.Fun.argc);
+					nPush = 1;
+					break;
+
+				case cmIF:
+				case cmELSE:
+					{
+						// cmIF 跳过对应的 cmELSE，cmELSE 跳过对应的 cmENDIF
+						std::size_t iTarget = i + tok.Oprt.offset;
+						if (vRPN[iTarget].Cmd != ((tok.Cmd == cmIF) ? cmELSE : cmENDIF))
+							throw ParserError(ecINVALID_BYTECODE);
+
+						nPop = (tok.Cmd == cmIF) ? 1 : 0;
+						int &iTargetDepth = vBranchDepth[iTarget + 1];
+						if (iTargetDepth >= 0 && iTargetDepth != iDepth - nPop)
+							throw ParserError(ecINVALID_BYTECODE);
+
+						iTargetDepth = iDepth - nPop;
+					}
+					break;
+
+				case cmENDIF:
+					break;
+
+				case cmEND:
+					if (i + 1 != vRPN.size())
+						throw ParserError(ecINVALID_BYTECODE);
+					break;
+
+				default:
+					throw ParserError(ecINVALID_BYTECODE);
+				}
+
+				if (iDepth < nPop)
+					throw ParserError(ecINVALID_BYTECODE);
+
+				iDepth += nPush - nPop;
+				iMaxDepth = std::max(iMaxDepth, iDepth);
+			}
+
+			if (iDepth <= 0)
+				throw ParserError(ecINVALID_BYTECODE);
+
+			m_vRPN.swap(vRPN);
+			m_iMaxStackSize = (std::size_t)iMaxDepth;
+			m_iStackPos = (unsigned)iDepth;
+			m_bEnableOptimizer = bEnableOptimizer;
+		}
+
 		/** \brief 转储字节码（仅用于调试！）。 */
 		void ParserByteCode::AsciiDump()
 		{
@@ -621,6 +1075,8 @@ namespace mu
 					mu::console() << _T("CALL STRFUNC\t");
 					mu::console() << _T("[ARG:") << std::dec << m_vRPN[i].Fun.argc << _T("]");
 					mu::console() << _T("[IDX:") << std::dec << m_vRPN[i].Fun.idx << _T("]");
+					if (m_vRPN[i].Fun.strhash)
+						mu::console() << _T("[HASH]");
 					mu::console() << _T("[ADDR: 0x") << std::hex << reinterpret_cast<void *>(m_vRPN[i].Fun.cb._pRawFun) << _T("]");
 					mu::console() << _T("[USERDATA: 0x") << std::hex << reinterpret_cast<void *>(m_vRPN[i].Fun.cb._pUserData) << _T("]");
 					mu::console() << _T("\n");
@@ -693,6 +1149,7 @@ namespace mu
 
 			mu::console() << _T("END") << std::endl;
 		}
+} // namespace mu
 
 #if defined(_MSC_VER)
 #pragma warning(pop)
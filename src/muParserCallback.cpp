@@ -43,6 +43,7 @@ namespace mu
 	static constexpr int CALLBACK_INTERNAL_VAR_ARGS         = 1 << 14;
 	static constexpr int CALLBACK_INTERNAL_FIXED_ARGS_MASK  = 0xf;
 	static constexpr int CALLBACK_INTERNAL_WITH_USER_DATA	= 1 << 13;
+	static constexpr int CALLBACK_INTERNAL_STR_HASH		= 1 << 12;
 
 	struct CbWithUserData
 	{
@@ -654,6 +655,72 @@ namespace mu
 	{}
 
 
+	ParserCallback::ParserCallback(strhashfun_type1 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(0 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_type2 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(1 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_type3 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(2 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_type4 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(3 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_type5 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(4 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_type6 a_pFun, bool a_bAllowOpti)
+		:m_pFun((void*)a_pFun)
+		, m_iArgc(5 | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
 	ParserCallback::ParserCallback(strfun_userdata_type1 a_pFun, void* a_pUserData, bool a_bAllowOpti)
 		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
 		, m_iArgc(0 | CALLBACK_INTERNAL_WITH_USER_DATA)
@@ -719,6 +786,72 @@ namespace mu
 		, m_bAllowOpti(a_bAllowOpti)
 	{}
 
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type1 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(0 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type2 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(1 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type3 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(2 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type4 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(3 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type5 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(4 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
+
+	ParserCallback::ParserCallback(strhashfun_userdata_type6 a_pFun, void* a_pUserData, bool a_bAllowOpti)
+		:m_pFun(new CbWithUserData{reinterpret_cast<void*>(a_pFun), a_pUserData})
+		, m_iArgc(5 | CALLBACK_INTERNAL_WITH_USER_DATA | CALLBACK_INTERNAL_STR_HASH)
+		, m_iPri(-1)
+		, m_eOprtAsct(oaNONE)
+		, m_iCode(cmFUNC_STR)
+		, m_iType(tpSTR)
+		, m_bAllowOpti(a_bAllowOpti)
+	{}
+
 	/** \brief Default constructor.
 		\throw nothrow
 	*/
@@ -887,6 +1020,16 @@ namespace mu
 	{
 		return (m_iArgc & CALLBACK_INTERNAL_VAR_ARGS) ? -1 : (m_iArgc & CALLBACK_INTERNAL_FIXED_ARGS_MASK);
 	}
+
+
+	/** \brief Returns true for string functions receiving the length and hash of their string argument.
+	
+		\sa strhashfun_type1
+	*/
+	bool ParserCallback::HasStrHash() const
+	{
+		return (m_iArgc & CALLBACK_INTERNAL_STR_HASH) != 0;
+	}
 } // namespace mu
 
 #if defined(_MSC_VER)
@@ -252,6 +252,24 @@ API_EXPORT(void) mupEvalBulk(muParserHandle_t a_hParser, muFloat_t* a_res, int n
 }
 
 
+API_EXPORT(void) mupEvalBulkStrided(muParserHandle_t a_hParser, muFloat_t* a_res, int nSize, int nResultStride)
+{
+	MU_TRY
+		muParser_t* p(AsParser(a_hParser));
+		p->Eval(a_res, nSize, nResultStride);
+	MU_CATCH
+}
+
+
+API_EXPORT(void) mupEvalBulkMulti(muParserHandle_t a_hParser, muFloat_t** a_res, int nSize)
+{
+	MU_TRY
+		muParser_t* p(AsParser(a_hParser));
+		p->EvalColumns(a_res, nSize);
+	MU_CATCH
+}
+
+
 API_EXPORT(void) mupSetExpr(muParserHandle_t a_hParser, const muChar_t* a_szExpr)
 {
 	MU_TRY
@@ -849,6 +867,24 @@ API_EXPORT(void) mupDefineBulkVar(muParserHandle_t a_hParser, const muChar_t* a_
 }
 
 
+API_EXPORT(void) mupSetVarStride(muParserHandle_t a_hParser, const muChar_t* a_szName, int a_iStride)
+{
+	MU_TRY
+		muParser_t* const p(AsParser(a_hParser));
+		p->SetVarStride(a_szName, a_iStride);
+	MU_CATCH
+}
+
+
+API_EXPORT(void) mupSetVarBroadcast(muParserHandle_t a_hParser, const muChar_t* a_szName, muBool_t a_bBroadcast)
+{
+	MU_TRY
+		muParser_t* const p(AsParser(a_hParser));
+		p->SetVarBroadcast(a_szName, a_bBroadcast != 0);
+	MU_CATCH
+}
+
+
 API_EXPORT(void) mupDefineConst(muParserHandle_t a_hParser,	const muChar_t* a_szName, muFloat_t a_fVal)
 {
 	MU_TRY
@@ -73,6 +73,9 @@ namespace mu
 		m_vErrMsg[ecIDENTIFIER_TOO_LONG] = _T("Identifier too long.");
 		m_vErrMsg[ecEXPRESSION_TOO_LONG] = _T("Expression too long.");
 		m_vErrMsg[ecINVALID_CHARACTERS_FOUND] = _T("Invalid non printable characters found in expression/identifer!");
+		m_vErrMsg[ecINVALID_BYTECODE] = _T("Invalid or incompatible serialized bytecode.");
+		m_vErrMsg[ecBYTECODE_SYMBOL_MISMATCH] = _T("Symbol \"$TOK$\" of the serialized bytecode is undefined or has a different signature.");
+		m_vErrMsg[ecEDIT_OUT_OF_RANGE] = _T("The replaced range exceeds the expression.");
 
 		for (int i = 0; i < ecCOUNT; ++i)
 		{
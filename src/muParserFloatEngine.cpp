@@ -0,0 +1,602 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "muParserFloatEngine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "muParserBase.h"
+#include "muParserTemplateMagic.h"
+
+#ifdef MUP_USE_OPENMP
+	#include <omp.h>
+#endif
+
+/** \file
+	\brief Implementation of the single precision evaluation engine.
+*/
+
+namespace mu
+{
+	namespace
+	{
+		typedef ParserFloatEngine::float_type float_type;
+		typedef ParserFloatEngine::kernel_type kernel_type;
+
+		// Single precision versions of the built in functions of Parser
+		float_type FltSin(float_type v) { return std::sin(v); }
+		float_type FltCos(float_type v) { return std::cos(v); }
+		float_type FltTan(float_type v) { return std::tan(v); }
+		float_type FltASin(float_type v) { return std::asin(v); }
+		float_type FltACos(float_type v) { return std::acos(v); }
+		float_type FltATan(float_type v) { return std::atan(v); }
+		float_type FltSinh(float_type v) { return std::sinh(v); }
+		float_type FltCosh(float_type v) { return std::cosh(v); }
+		float_type FltTanh(float_type v) { return std::tanh(v); }
+		float_type FltASinh(float_type v) { return std::asinh(v); }
+		float_type FltACosh(float_type v) { return std::acosh(v); }
+		float_type FltATanh(float_type v) { return std::atanh(v); }
+		float_type FltLog(float_type v) { return std::log(v); }
+		float_type FltLog2(float_type v) { return std::log2(v); }
+		float_type FltLog10(float_type v) { return std::log10(v); }
+		float_type FltExp(float_type v) { return std::exp(v); }
+		float_type FltSqrt(float_type v) { return std::sqrt(v); }
+		float_type FltAbs(float_type v) { return std::fabs(v); }
+		float_type FltRint(float_type v) { return std::floor(v + (float_type)0.5); }
+		float_type FltSign(float_type v) { return (float_type)((v < 0) ? -1 : (v > 0) ? 1 : 0); }
+		float_type FltUnaryMinus(float_type v) { return -v; }
+		float_type FltUnaryPlus(float_type v) { return v; }
+
+		/** \brief Apply a function to a block of values; instantiated per function so that the call is inlined. */
+		template<float_type (*TFun)(float_type)>
+		void ApplyKernel(float_type* a_pVal, int a_nRows)
+		{
+			for (int i = 0; i < a_nRows; ++i)
+				a_pVal[i] = TFun(a_pVal[i]);
+		}
+
+		/** \brief A callback of the parser together with its float implementation. */
+		struct SKernel
+		{
+			fun_type1 pFun;
+			kernel_type pKernel;
+		};
+
+		const SKernel s_Kernels[] =
+		{
+			{ MathImpl<value_type>::Sin, ApplyKernel<FltSin> },
+			{ MathImpl<value_type>::Cos, ApplyKernel<FltCos> },
+			{ MathImpl<value_type>::Tan, ApplyKernel<FltTan> },
+			{ MathImpl<value_type>::ASin, ApplyKernel<FltASin> },
+			{ MathImpl<value_type>::ACos, ApplyKernel<FltACos> },
+			{ MathImpl<value_type>::ATan, ApplyKernel<FltATan> },
+			{ MathImpl<value_type>::Sinh, ApplyKernel<FltSinh> },
+			{ MathImpl<value_type>::Cosh, ApplyKernel<FltCosh> },
+			{ MathImpl<value_type>::Tanh, ApplyKernel<FltTanh> },
+			{ MathImpl<value_type>::ASinh, ApplyKernel<FltASinh> },
+			{ MathImpl<value_type>::ACosh, ApplyKernel<FltACosh> },
+			{ MathImpl<value_type>::ATanh, ApplyKernel<FltATanh> },
+			{ MathImpl<value_type>::Log, ApplyKernel<FltLog> },
+			{ MathImpl<value_type>::Log2, ApplyKernel<FltLog2> },
+			{ MathImpl<value_type>::Log10, ApplyKernel<FltLog10> },
+			{ MathImpl<value_type>::Exp, ApplyKernel<FltExp> },
+			{ MathImpl<value_type>::Sqrt, ApplyKernel<FltSqrt> },
+			{ MathImpl<value_type>::Abs, ApplyKernel<FltAbs> },
+			{ MathImpl<value_type>::Rint, ApplyKernel<FltRint> },
+			{ MathImpl<value_type>::Sign, ApplyKernel<FltSign> },
+			{ MathImpl<value_type>::UnaryMinus, ApplyKernel<FltUnaryMinus> },
+			{ MathImpl<value_type>::UnaryPlus, ApplyKernel<FltUnaryPlus> }
+		};
+
+		/** \brief Copy the values of a variable for a block of rows into a register. */
+		void LoadVar(const float_type* a_pVar, std::ptrdiff_t a_iStride, int a_iBegin, int a_nRows, float_type* a_pDst)
+		{
+			if (a_iStride == (std::ptrdiff_t)sizeof(float_type))
+			{
+				std::copy(a_pVar + a_iBegin, a_pVar + a_iBegin + a_nRows, a_pDst);
+				return;
+			}
+
+			const char* pVar = (const char*)a_pVar + a_iBegin * a_iStride;
+			for (int i = 0; i < a_nRows; ++i)
+				a_pDst[i] = *(const float_type*)(pVar + i * a_iStride);
+		}
+
+		/** \brief Call a callback of the parser for a single row. 
+			\param a_Tok The function token.
+			\param n The row index, passed to bulk functions.
+			\param t The id of the calling thread, passed to bulk functions.
+			\param a The arguments.
+			\param a_StrBuf The string arguments of string functions.
+		*/
+		value_type CallFun(const SToken& a_Tok, int n, int t, const value_type* a, const ParserStringPool& a_StrBuf)
+		{
+			if (a_Tok.Cmd == cmFUNC_BULK)
+			{
+				switch (a_Tok.Fun.argc)
+				{
+				case 0:  return a_Tok.Fun.cb.call_bulkfun<0>(n, t);
+				case 1:  return a_Tok.Fun.cb.call_bulkfun<1>(n, t, a[0]);
+				case 2:  return a_Tok.Fun.cb.call_bulkfun<2>(n, t, a[0], a[1]);
+				case 3:  return a_Tok.Fun.cb.call_bulkfun<3>(n, t, a[0], a[1], a[2]);
+				case 4:  return a_Tok.Fun.cb.call_bulkfun<4>(n, t, a[0], a[1], a[2], a[3]);
+				case 5:  return a_Tok.Fun.cb.call_bulkfun<5>(n, t, a[0], a[1], a[2], a[3], a[4]);
+				case 6:  return a_Tok.Fun.cb.call_bulkfun<6>(n, t, a[0], a[1], a[2], a[3], a[4], a[5]);
+				case 7:  return a_Tok.Fun.cb.call_bulkfun<7>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+				case 8:  return a_Tok.Fun.cb.call_bulkfun<8>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+				case 9:  return a_Tok.Fun.cb.call_bulkfun<9>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+				case 10: return a_Tok.Fun.cb.call_bulkfun<10>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+				default:
+					throw ParserError(ecINTERNAL_ERROR);
+				}
+			}
+
+			if (a_Tok.Cmd == cmFUNC_STR)
+				return ParserByteCode::CallStrFun(a_Tok, a_StrBuf, a);
+
+			switch (a_Tok.Fun.argc)
+			{
+			case 0:  return a_Tok.Fun.cb.call_fun<0>();
+			case 1:  return a_Tok.Fun.cb.call_fun<1>(a[0]);
+			case 2:  return a_Tok.Fun.cb.call_fun<2>(a[0], a[1]);
+			case 3:  return a_Tok.Fun.cb.call_fun<3>(a[0], a[1], a[2]);
+			case 4:  return a_Tok.Fun.cb.call_fun<4>(a[0], a[1], a[2], a[3]);
+			case 5:  return a_Tok.Fun.cb.call_fun<5>(a[0], a[1], a[2], a[3], a[4]);
+			case 6:  return a_Tok.Fun.cb.call_fun<6>(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case 7:  return a_Tok.Fun.cb.call_fun<7>(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+			case 8:  return a_Tok.Fun.cb.call_fun<8>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case 9:  return a_Tok.Fun.cb.call_fun<9>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+			case 10: return a_Tok.Fun.cb.call_fun<10>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+			default:
+				// functions with variable argument count store the number of arguments as a negative value
+				if (a_Tok.Fun.argc > 0)
+					throw ParserError(ecINTERNAL_ERROR);
+
+				return a_Tok.Fun.cb.call_multfun(a, -a_Tok.Fun.argc);
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	ParserFloatEngine::ParserFloatEngine()
+		: m_sExpr(), m_vInstr(), m_vVarName(), m_VarDef(), m_vVar(), m_vStringBuf(), m_nResults(0), m_nRegs(0), m_nArgStride(0), m_vReg(), m_vArg(), m_nBufThreads(0)
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Translate the current expression of a parser into float instructions.
+		\param a_Parser The parser defining the expression, variables, constants and functions.
+		\throw ParserError if the expression is invalid or contains an assignment.
+
+		The variables of the expression must be bound to float columns by DefineVar before 
+		the engine is evaluated. The engine keeps the addresses of the callbacks of the parser.
+		The registers for the evaluation are allocated here, Eval does not allocate memory 
+		unless the number of OpenMP threads has grown since.
+	*/
+	void ParserFloatEngine::Compile(const ParserBase& a_Parser)
+	{
+		a_Parser.Compile();
+
+		// The bytecode references variables by address, the engine binds them by name
+		std::map<const value_type*, string_type> vVarNames;
+		for (const auto& item : a_Parser.GetVar())
+			vVarNames[item.second] = item.first;
+
+		std::vector<SInstr> vInstr;
+		std::vector<string_type> vVarName;
+		int nSize = 0, nMaxSize = 0, nMaxArgs = 0;
+
+		for (const SToken* pTok = a_Parser.m_pRPN->GetBase(); pTok->Cmd != cmEND; ++pTok)
+		{
+			SInstr instr;
+			instr.Tok = *pTok;
+			instr.nArgs = 0;
+			instr.iVar = -1;
+			instr.fVal = 0;
+			instr.fOffset = 0;
+			instr.pKernel = nullptr;
+
+			switch (pTok->Cmd)
+			{
+			case cmVAR:
+			case cmVARPOW2:
+			case cmVARPOW3:
+			case cmVARPOW4:
+			case cmVARMUL:
+			{
+				auto item = vVarNames.find(pTok->Val.ptr);
+				if (item == vVarNames.end())
+					throw ParserError(ecINVALID_VAR_PTR, string_type(), a_Parser.GetExpr());
+
+				auto iVar = std::find(vVarName.begin(), vVarName.end(), item->second);
+				instr.iVar = (int)(iVar - vVarName.begin());
+				if (iVar == vVarName.end())
+					vVarName.push_back(item->second);
+
+				instr.fVal = (float_type)pTok->Val.data;
+				instr.fOffset = (float_type)pTok->Val.data2;
+				break;
+			}
+
+			case cmVAL:
+				instr.fVal = (float_type)pTok->Val.data2;
+				break;
+
+			case cmLE:
+			case cmGE:
+			case cmNEQ:
+			case cmEQ:
+			case cmLT:
+			case cmGT:
+			case cmADD:
+			case cmSUB:
+			case cmMUL:
+			case cmDIV:
+			case cmPOW:
+			case cmLAND:
+			case cmLOR:
+				instr.nArgs = 2;
+				break;
+
+			// Both branches of the ternary operator are computed on top of the condition, 
+			// the select instruction (cmIF with three arguments) replaces all three by the result
+			case cmIF:
+			case cmELSE:
+				continue;
+
+			case cmENDIF:
+				instr.Tok.Cmd = cmIF;
+				instr.nArgs = 3;
+				break;
+
+			case cmFUNC:
+				instr.nArgs = (pTok->Fun.argc >= 0) ? pTok->Fun.argc : -pTok->Fun.argc;
+				instr.pKernel = FindKernel(*pTok);
+				break;
+
+			case cmFUNC_BULK:
+			case cmFUNC_STR:
+				instr.nArgs = pTok->Fun.argc;
+				break;
+
+			case cmASSIGN:
+				throw ParserError(ecUNEXPECTED_OPERATOR, _T("="), a_Parser.GetExpr());
+
+			default:
+				throw ParserError(ecINTERNAL_ERROR);
+			}
+
+			if (nSize < instr.nArgs)
+				throw ParserError(ecINTERNAL_ERROR);
+
+			instr.iReg = nSize - instr.nArgs;
+			nSize = instr.iReg + 1;
+			nMaxSize = std::max(nMaxSize, nSize);
+			if (instr.Tok.Cmd == cmFUNC || instr.Tok.Cmd == cmFUNC_BULK || instr.Tok.Cmd == cmFUNC_STR)
+				nMaxArgs = std::max(nMaxArgs, instr.nArgs);
+
+			vInstr.push_back(instr);
+		}
+
+		if (nSize == 0)
+			throw ParserError(ecEMPTY_EXPRESSION);
+
+		m_sExpr = a_Parser.GetExpr();
+		m_vInstr.swap(vInstr);
+		m_vVarName.swap(vVarName);
+		m_vStringBuf.clear();
+		m_vStringBuf.Append(*a_Parser.m_pStringBuf);
+		m_nResults = nSize;
+		m_nRegs = nMaxSize;
+
+		// The arguments of different threads never share a cache line
+		const int nLine = std::max<int>(ParserBase::s_CacheLineSize / sizeof(value_type), 1);
+		m_nArgStride = (std::max(nMaxArgs, 1) + nLine - 1) / nLine * nLine;
+
+		BindVars();
+		m_nBufThreads = 0;
+		ReserveBuffers(GetMaxThreads());
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the float implementation of a built in function or nullptr. */
+	ParserFloatEngine::kernel_type ParserFloatEngine::FindKernel(const SToken& a_Tok)
+	{
+		if (a_Tok.Fun.argc != 1 || a_Tok.Fun.cb._pUserData != nullptr)
+			return nullptr;
+
+		for (const SKernel& kernel : s_Kernels)
+		{
+			if (a_Tok.Fun.cb._pRawFun == reinterpret_cast<erased_fun_type>(kernel.pFun))
+				return kernel.pKernel;
+		}
+
+		return nullptr;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Bind a variable to a column of floats.
+		\param a_sName The name of the variable in the expression.
+		\param a_pVar The first value of the column.
+
+		Variables not used by the current expression may be bound as well. Rebinding a 
+		variable resets its stride to sizeof(float_type).
+		\throw ParserError if a_pVar is a null pointer.
+	*/
+	void ParserFloatEngine::DefineVar(const string_type& a_sName, const float_type* a_pVar)
+	{
+		if (a_pVar == nullptr)
+			throw ParserError(ecINVALID_VAR_PTR, a_sName);
+
+		SVarBinding& var = m_VarDef[a_sName];
+		var.pVar = a_pVar;
+		var.iStride = sizeof(float_type);
+		BindVars();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Set the distance in bytes between two consecutive values of a variable.
+		\param a_sName The name of a variable bound by DefineVar.
+		\param a_iStride The distance in bytes, 0 makes the variable a scalar shared by all rows.
+		\throw ParserError if the variable is not bound.
+	*/
+	void ParserFloatEngine::SetVarStride(const string_type& a_sName, int a_iStride)
+	{
+		auto item = m_VarDef.find(a_sName);
+		if (item == m_VarDef.end())
+			throw ParserError(ecINVALID_NAME, a_sName);
+
+		item->second.iStride = a_iStride;
+		BindVars();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Remove all variable bindings. */
+	void ParserFloatEngine::ClearVar()
+	{
+		m_VarDef.clear();
+		BindVars();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Look up the columns of the variables used by the instructions. 
+	
+		Called whenever the instructions or the bindings change, so that Eval does not 
+		search the bindings.
+	*/
+	void ParserFloatEngine::BindVars()
+	{
+		m_vVar.resize(m_vVarName.size());
+		for (std::size_t i = 0; i < m_vVarName.size(); ++i)
+		{
+			auto item = m_VarDef.find(m_vVarName[i]);
+			if (item != m_VarDef.end())
+			{
+				m_vVar[i] = item->second;
+			}
+			else
+			{
+				m_vVar[i].pVar = nullptr;
+				m_vVar[i].iStride = 0;
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Make sure the registers and the argument buffers can be used by the given number of threads. */
+	void ParserFloatEngine::ReserveBuffers(int a_nThreads) const
+	{
+		if (a_nThreads <= m_nBufThreads)
+			return;
+
+		m_vReg.resize((std::size_t)a_nThreads * m_nRegs * s_nBlockSize);
+		m_vArg.resize((std::size_t)a_nThreads * m_nArgStride);
+		m_nBufThreads = a_nThreads;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of threads used by the evaluation. */
+	int ParserFloatEngine::GetMaxThreads()
+	{
+#ifdef MUP_USE_OPENMP
+		return std::min(omp_get_max_threads(), ParserBase::s_MaxNumOpenMPThreads);
+#else
+		return 1;
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Execute all instructions for a block of rows.
+		\param a_iBegin The index of the first row.
+		\param a_nRows The number of rows, at most s_nBlockSize.
+		\param a_nThreadID The id of the calling thread, passed to bulk functions.
+		\param a_pVar The columns of the variables.
+		\param a_pReg The registers, s_nBlockSize values each.
+		\param a_pArg Scratch space for the arguments of callbacks.
+	*/
+	void ParserFloatEngine::Run(int a_iBegin, int a_nRows, int a_nThreadID, const SVarBinding* a_pVar, float_type* a_pReg, value_type* a_pArg) const
+	{
+		const int n = a_nRows;
+
+		for (const SInstr& instr : m_vInstr)
+		{
+			float_type* r = a_pReg + instr.iReg * s_nBlockSize;
+			const float_type* b = r + s_nBlockSize;
+			const float_type* c = b + s_nBlockSize;
+
+			switch (instr.Tok.Cmd)
+			{
+			case cmVAL:
+				std::fill(r, r + n, instr.fVal);
+				continue;
+
+			case cmVAR:
+				LoadVar(a_pVar[instr.iVar].pVar, a_pVar[instr.iVar].iStride, a_iBegin, n, r);
+				continue;
+
+			case cmVARPOW2:
+				LoadVar(a_pVar[instr.iVar].pVar, a_pVar[instr.iVar].iStride, a_iBegin, n, r);
+				for (int i = 0; i < n; ++i) r[i] = r[i] * r[i];
+				continue;
+
+			case cmVARPOW3:
+				LoadVar(a_pVar[instr.iVar].pVar, a_pVar[instr.iVar].iStride, a_iBegin, n, r);
+				for (int i = 0; i < n; ++i) r[i] = r[i] * r[i] * r[i];
+				continue;
+
+			case cmVARPOW4:
+				LoadVar(a_pVar[instr.iVar].pVar, a_pVar[instr.iVar].iStride, a_iBegin, n, r);
+				for (int i = 0; i < n; ++i) r[i] = r[i] * r[i] * r[i] * r[i];
+				continue;
+
+			case cmVARMUL:
+				LoadVar(a_pVar[instr.iVar].pVar, a_pVar[instr.iVar].iStride, a_iBegin, n, r);
+				for (int i = 0; i < n; ++i) r[i] = r[i] * instr.fVal + instr.fOffset;
+				continue;
+
+			case cmLE:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] <= b[i]); continue;
+			case cmGE:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] >= b[i]); continue;
+			case cmNEQ:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] != b[i]); continue;
+			case cmEQ:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] == b[i]); continue;
+			case cmLT:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] < b[i]); continue;
+			case cmGT:	for (int i = 0; i < n; ++i) r[i] = (float_type)(r[i] > b[i]); continue;
+			case cmADD:	for (int i = 0; i < n; ++i) r[i] += b[i]; continue;
+			case cmSUB:	for (int i = 0; i < n; ++i) r[i] -= b[i]; continue;
+			case cmMUL:	for (int i = 0; i < n; ++i) r[i] *= b[i]; continue;
+			case cmDIV:	for (int i = 0; i < n; ++i) r[i] /= b[i]; continue;
+			case cmPOW:	for (int i = 0; i < n; ++i) r[i] = std::pow(r[i], b[i]); continue;
+			case cmLAND: for (int i = 0; i < n; ++i) r[i] = (float_type)((r[i] != 0) & (b[i] != 0)); continue;
+			case cmLOR:	for (int i = 0; i < n; ++i) r[i] = (float_type)((r[i] != 0) | (b[i] != 0)); continue;
+
+			// select: both branches have already been computed
+			case cmIF:	for (int i = 0; i < n; ++i) r[i] = (r[i] != 0) ? b[i] : c[i]; continue;
+
+			case cmFUNC:
+			case cmFUNC_BULK:
+			case cmFUNC_STR:
+				if (instr.pKernel != nullptr)
+				{
+					instr.pKernel(r, n);
+					continue;
+				}
+
+				// Other callbacks are called row by row in the precision of the parser
+				for (int i = 0; i < n; ++i)
+				{
+					for (int k = 0; k < instr.nArgs; ++k)
+						a_pArg[k] = r[k * s_nBlockSize + i];
+
+					r[i] = (float_type)CallFun(instr.Tok, a_iBegin + i, a_nThreadID, a_pArg, m_vStringBuf);
+				}
+				continue;
+
+			default:
+				throw ParserError(ecINTERNAL_ERROR);
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Evaluate the instructions for all rows and copy a range of registers to the result columns. */
+	void ParserFloatEngine::EvalBlocks(float_type* const* a_pResults, int a_iFirstResult, int a_nResults, int a_nBulkSize) const
+	{
+		if (m_vInstr.empty())
+			throw ParserError(ecEMPTY_EXPRESSION);
+
+		for (std::size_t i = 0; i < m_vVar.size(); ++i)
+		{
+			if (m_vVar[i].pVar == nullptr)
+				throw ParserError(ecINVALID_VAR_PTR, m_vVarName[i], m_sExpr);
+		}
+
+		const int nMaxThreads = GetMaxThreads();
+		ReserveBuffers(nMaxThreads);
+
+		const int nBlocks = (a_nBulkSize + s_nBlockSize - 1) / s_nBlockSize;
+		const std::size_t nRegs = (std::size_t)m_nRegs * s_nBlockSize;
+
+		auto evalBlock = [&](int iBlock, int nThread)
+		{
+			float_type* pReg = &m_vReg[nThread * nRegs];
+			const int iBegin = iBlock * s_nBlockSize;
+			const int nRows = std::min(s_nBlockSize, a_nBulkSize - iBegin);
+			Run(iBegin, nRows, nThread, m_vVar.data(), pReg, &m_vArg[nThread * m_nArgStride]);
+
+			for (int k = 0; k < a_nResults; ++k)
+			{
+				const float_type* pRes = pReg + (a_iFirstResult + k) * s_nBlockSize;
+				std::copy(pRes, pRes + nRows, a_pResults[k] + iBegin);
+			}
+		};
+
+#ifdef MUP_USE_OPENMP
+#pragma omp parallel for schedule(static) num_threads(nMaxThreads)
+		for (int iBlock = 0; iBlock < nBlocks; ++iBlock)
+			evalBlock(iBlock, omp_get_thread_num());
+#else
+		for (int iBlock = 0; iBlock < nBlocks; ++iBlock)
+			evalBlock(iBlock, 0);
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Evaluate the expression for all rows.
+		\param [out] a_pResults Array receiving a_nBulkSize values of the last result.
+		\param a_nBulkSize The number of rows.
+		\throw ParserError if no expression was compiled or a variable is not bound.
+	*/
+	void ParserFloatEngine::Eval(float_type* a_pResults, int a_nBulkSize) const
+	{
+		EvalBlocks(&a_pResults, m_nResults - 1, 1, a_nBulkSize);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Evaluate all results of comma separated expressions for all rows.
+		\param [out] a_pResults Array of GetNumResults() result columns with a_nBulkSize entries each.
+		\param a_nBulkSize The number of rows.
+		\throw ParserError if no expression was compiled or a variable is not bound.
+	*/
+	void ParserFloatEngine::EvalColumns(float_type* const* a_pResults, int a_nBulkSize) const
+	{
+		EvalBlocks(a_pResults, 0, m_nResults, a_nBulkSize);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of results written per row by EvalColumns. */
+	int ParserFloatEngine::GetNumResults() const
+	{
+		return m_nResults;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the expression compiled last. */
+	const string_type& ParserFloatEngine::GetExpr() const
+	{
+		return m_sExpr;
+	}
+} // namespace mu
@@ -88,27 +88,20 @@ namespace mu
 
 	int ParserInt::IsVal(const char_type* a_szExpr, int* a_iPos, value_type* a_fVal)
 	{
-		string_type buf(a_szExpr);
-		std::size_t pos = buf.find_first_not_of(_T("0123456789"));
+		// 与流一样，超出 int 范围的数字不被识别为值
+		long long iVal(0);
+		int i(0);
+		for (i = 0; a_szExpr[i] >= '0' && a_szExpr[i] <= '9'; ++i)
+		{
+			iVal = iVal * 10 + (a_szExpr[i] - '0');
+			if (iVal > INT_MAX)
+				return 0;
+		}
 
-		if (pos == std::string::npos)
-			return 0;
-
-		stringstream_type stream(buf.substr(0, pos));
-		int iVal(0);
-
-		stream >> iVal;
-		if (stream.fail())
-			return 0;
-
-		stringstream_type::pos_type iEnd = stream.tellg();   // 读取后的位置
-		if (stream.fail())
-			iEnd = stream.str().length();
-
-		if (iEnd == (stringstream_type::pos_type) - 1)
+		if (i == 0)
 			return 0;
 
-		*a_iPos += (int)iEnd;
+		*a_iPos += i;
 		*a_fVal = (value_type)iVal;
 		return 1;
 	}
@@ -127,17 +120,30 @@ namespace mu
 			return 0;
 
 		unsigned iVal(0);
+		int i(0);
+		for (i = 2; ; ++i)
+		{
+			char_type c = a_szExpr[i];
+			unsigned iDigit(0);
+			if (c >= '0' && c <= '9')
+				iDigit = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				iDigit = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				iDigit = c - 'A' + 10;
+			else
+				break;
+
+			if (iVal > (UINT_MAX >> 4))
+				throw exception_type(_T("Hexadecimal to integer conversion error (overflow)."));
+
+			iVal = (iVal << 4) | iDigit;
+		}
+
+		if (i == 2)
+			return 0;
 
-		// 基于流的新代码，以支持UNICODE:
-		stringstream_type::pos_type nPos(0);
-		stringstream_type ss(a_szExpr + 2);
-		ss >> std::hex >> iVal;
-		nPos = ss.tellg();
-
-		if (nPos == (stringstream_type::pos_type)0)
-			return 1;
-
-		*a_iPos += (int)(2 + nPos);
+		*a_iPos += i;
 		*a_fVal = (value_type)iVal;
 		return 1;
 	}
@@ -170,14 +176,32 @@ namespace mu
 
 	/** \brief 构造函数。
 
-		调用 ParserBase 类的构造函数，并触发 Function、Operator 和 Constant 的初始化。
+		从内置符号的原型拷贝构造，符号表在第一次定义新的符号之前与原型共享。
 	*/
 	ParserInt::ParserInt()
+		:ParserBase(GetBuiltIns())
+	{
+	}
+
+
+	/** \brief 返回定义了所有内置符号的原型，它在第一次使用时创建并且不再改变。 */
+	const ParserInt& ParserInt::GetBuiltIns()
+	{
+		static const ParserInt s_BuiltIns{ SBuiltInTag() };
+		return s_BuiltIns;
+	}
+
+
+	/** \brief 原型的构造函数。
+
+		调用 ParserBase 类的构造函数，并触发 Function、Operator 和 Constant 的初始化。
+	*/
+	ParserInt::ParserInt(SBuiltInTag)
 		:ParserBase()
 	{
-		AddValIdent(IsVal);    // 优先级最低
-		AddValIdent(IsBinVal);
-		AddValIdent(IsHexVal); // 优先级最高
+		AddValIdent(IsVal, _T("0123456789"));    // 优先级最低
+		AddValIdent(IsBinVal, _T("#"));
+		AddValIdent(IsHexVal, _T("0")); // 优先级最高
 
 		InitCharSets();
 		InitFun();
@@ -0,0 +1,162 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "muParserMemory.h"
+
+#include <algorithm>
+#include <cstdint>
+
+/** \file
+	\brief Implementation of the memory resources.
+*/
+
+namespace mu
+{
+	namespace
+	{
+		/** \brief The default resource, forwarding to the global operator new and delete. */
+		class ParserNewDeleteResource final : public ParserMemoryResource
+		{
+		public:
+
+			void* Allocate(std::size_t a_nBytes, std::size_t) override
+			{
+				return ::operator new(a_nBytes);
+			}
+
+			void Deallocate(void* a_pMem, std::size_t, std::size_t) noexcept override
+			{
+				::operator delete(a_pMem);
+			}
+		};
+	}
+
+	//------------------------------------------------------------------------------
+	ParserMemoryResource* ParserMemoryResource::GetDefault() noexcept
+	{
+		static ParserNewDeleteResource resource;
+		return &resource;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Create an empty arena.
+		\param a_nBlockSize Size of the first block requested from the upstream resource.
+		\param a_pUpstream The resource supplying the blocks, nullptr selects the default resource.
+	*/
+	ParserArenaResource::ParserArenaResource(std::size_t a_nBlockSize, ParserMemoryResource* a_pUpstream)
+		:m_pUpstream((a_pUpstream != nullptr) ? a_pUpstream : ParserMemoryResource::GetDefault())
+		, m_vBlocks()
+		, m_nBlockSize(std::max<std::size_t>(a_nBlockSize, 64))
+		, m_pPos(nullptr)
+		, m_pEnd(nullptr)
+		, m_nAllocated(0)
+		, m_nReserved(0)
+	{}
+
+	//------------------------------------------------------------------------------
+	ParserArenaResource::~ParserArenaResource()
+	{
+		Release();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Hand out memory from the current block, start a new block if it is exhausted.
+
+		Block sizes grow geometrically so the number of upstream allocations stays 
+		logarithmic in the total amount of memory used.
+	*/
+	void* ParserArenaResource::Allocate(std::size_t a_nBytes, std::size_t a_nAlign)
+	{
+		if (a_nAlign == 0)
+			a_nAlign = 1;
+
+		std::uintptr_t nPos = reinterpret_cast<std::uintptr_t>(m_pPos);
+		std::uintptr_t nAligned = (nPos + a_nAlign - 1) & ~(std::uintptr_t)(a_nAlign - 1);
+		if (m_pPos == nullptr || nAligned + a_nBytes > reinterpret_cast<std::uintptr_t>(m_pEnd))
+		{
+			std::size_t nSize = std::max(m_nBlockSize, a_nBytes + a_nAlign);
+			SBlock block = { m_pUpstream->Allocate(nSize, alignof(std::max_align_t)), nSize };
+			try
+			{
+				m_vBlocks.push_back(block);
+			}
+			catch (...)
+			{
+				m_pUpstream->Deallocate(block.pMem, block.nSize, alignof(std::max_align_t));
+				throw;
+			}
+
+			m_pPos = static_cast<char*>(block.pMem);
+			m_pEnd = m_pPos + nSize;
+			m_nReserved += nSize;
+			m_nBlockSize = std::max(m_nBlockSize, nSize) * 2;
+
+			nPos = reinterpret_cast<std::uintptr_t>(m_pPos);
+			nAligned = (nPos + a_nAlign - 1) & ~(std::uintptr_t)(a_nAlign - 1);
+		}
+
+		m_pPos += (nAligned - nPos) + a_nBytes;
+		m_nAllocated += a_nBytes;
+		return reinterpret_cast<void*>(nAligned);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Does nothing, the memory is reclaimed by Release. */
+	void ParserArenaResource::Deallocate(void*, std::size_t, std::size_t) noexcept
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Return all blocks to the upstream resource.
+
+		Every pointer handed out by the arena is invalid afterwards.
+	*/
+	void ParserArenaResource::Release() noexcept
+	{
+		for (const auto& block : m_vBlocks)
+			m_pUpstream->Deallocate(block.pMem, block.nSize, alignof(std::max_align_t));
+
+		m_vBlocks.clear();
+		m_pPos = nullptr;
+		m_pEnd = nullptr;
+		m_nAllocated = 0;
+		m_nReserved = 0;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of bytes handed out since the last release. */
+	std::size_t ParserArenaResource::GetBytesAllocated() const noexcept
+	{
+		return m_nAllocated;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of bytes currently held from the upstream resource. */
+	std::size_t ParserArenaResource::GetBytesReserved() const noexcept
+	{
+		return m_nReserved;
+	}
+} // namespace mu
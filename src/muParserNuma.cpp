@@ -0,0 +1,215 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "muParserNuma.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+	#include <sched.h>
+#endif
+
+/** \file
+	\brief Implementation of the NUMA topology helper.
+*/
+
+namespace mu
+{
+	//------------------------------------------------------------------------------
+	const ParserNumaTopology& ParserNumaTopology::Instance()
+	{
+		static const ParserNumaTopology instance;
+		return instance;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Read the node layout from sysfs.
+
+		Only nodes owning CPUs are recorded, memory only nodes can not run worker threads.
+	*/
+	ParserNumaTopology::ParserNumaTopology()
+		: m_vNodeCpus()
+	{
+#if defined(__linux__)
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string sOnline;
+		if (online && std::getline(online, sOnline))
+		{
+			std::vector<int> vNodes = ParseCpuList(sOnline);
+			for (std::size_t i = 0; i < vNodes.size(); ++i)
+			{
+				std::ostringstream ss;
+				ss << "/sys/devices/system/node/node" << vNodes[i] << "/cpulist";
+
+				std::ifstream cpulist(ss.str().c_str());
+				std::string sCpus;
+				if (!cpulist || !std::getline(cpulist, sCpus))
+					continue;
+
+				std::vector<int> vCpus = ParseCpuList(sCpus);
+				if (vCpus.size())
+					m_vNodeCpus.push_back(vCpus);
+			}
+		}
+#endif
+
+		// No usable topology information: treat the host as a single node without binding.
+		if (m_vNodeCpus.empty())
+			m_vNodeCpus.push_back(std::vector<int>());
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Parse a sysfs list such as "0-3,8-11" into its ids. */
+	std::vector<int> ParserNumaTopology::ParseCpuList(const std::string& a_sList)
+	{
+		std::vector<int> vIds;
+		std::istringstream ss(a_sList);
+		std::string sRange;
+		while (std::getline(ss, sRange, ','))
+		{
+			int iFirst = 0, iLast = 0;
+			char cDash = 0;
+			std::istringstream range(sRange);
+			if (!(range >> iFirst))
+				continue;
+
+			if (range >> cDash >> iLast && cDash == '-')
+			{
+				for (int i = iFirst; i <= iLast; ++i)
+					vIds.push_back(i);
+			}
+			else
+				vIds.push_back(iFirst);
+		}
+
+		return vIds;
+	}
+
+	//------------------------------------------------------------------------------
+	int ParserNumaTopology::GetNumNodes() const
+	{
+		return (int)m_vNodeCpus.size();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the CPUs of a node; the list is empty if the topology is unknown. */
+	const std::vector<int>& ParserNumaTopology::GetNodeCpus(int a_iNode) const
+	{
+		return m_vNodeCpus[a_iNode];
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the node a worker thread is assigned to.
+
+		Threads are distributed over the nodes in contiguous blocks so that neighbouring
+		row ranges end up on the same node.
+	*/
+	int ParserNumaTopology::GetThreadNode(int a_iThread, int a_nThreads) const
+	{
+		if (a_nThreads <= 0)
+			return 0;
+
+		return (int)(((long long)a_iThread * GetNumNodes()) / a_nThreads);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Restrict the calling thread to the CPUs of its node.
+		\return true if the thread was bound, false if binding is not possible or not needed.
+
+		The binding of the worker threads is left in place after the bulk evaluation. OpenMP 
+		reuses its worker threads, so subsequent evaluations run on the same nodes as the 
+		first touch did. The calling thread must be protected by a ParserAffinityGuard.
+	*/
+	bool ParserNumaTopology::BindThread(int a_iThread, int a_nThreads) const
+	{
+#if defined(__linux__)
+		if (GetNumNodes() < 2)
+			return false;
+
+		const std::vector<int>& vCpus = m_vNodeCpus[GetThreadNode(a_iThread, a_nThreads)];
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (std::size_t i = 0; i < vCpus.size(); ++i)
+		{
+			if (vCpus[i] < CPU_SETSIZE)
+				CPU_SET(vCpus[i], &set);
+		}
+
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+		(void)a_iThread;
+		(void)a_nThreads;
+		return false;
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Save the affinity of the calling thread if BindThread may change it. */
+	ParserAffinityGuard::ParserAffinityGuard()
+		: m_vMask()
+	{
+#if defined(__linux__)
+		if (ParserNumaTopology::Instance().GetNumNodes() < 2)
+			return;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			const unsigned char* pMask = reinterpret_cast<const unsigned char*>(&set);
+			m_vMask.assign(pMask, pMask + sizeof(set));
+		}
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Restore the saved affinity of the calling thread. */
+	ParserAffinityGuard::~ParserAffinityGuard()
+	{
+#if defined(__linux__)
+		if (m_vMask.size() != sizeof(cpu_set_t))
+			return;
+
+		cpu_set_t set;
+		std::copy(m_vMask.begin(), m_vMask.end(), reinterpret_cast<unsigned char*>(&set));
+		sched_setaffinity(0, sizeof(set), &set);
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Compute the contiguous row range [a_iBegin, a_iEnd) of a worker thread. */
+	void ParserNumaTopology::GetThreadRange(int a_iThread, int a_nThreads, int a_nSize, int& a_iBegin, int& a_iEnd)
+	{
+		a_iBegin = (int)(((long long)a_nSize * a_iThread) / a_nThreads);
+		a_iEnd = (int)(((long long)a_nSize * (a_iThread + 1)) / a_nThreads);
+	}
+} // namespace mu
@@ -0,0 +1,440 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "muParserProgram.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "muParserBase.h"
+#include "muParserNuma.h"
+#include "muParserTemplateMagic.h"
+
+#ifdef MUP_USE_OPENMP
+	#include <omp.h>
+#endif
+
+/** \file
+	\brief Implementation of the program class for evaluating several expressions at once.
+*/
+
+namespace mu
+{
+	//------------------------------------------------------------------------------
+	bool ParserProgram::SNodeKey::operator<(const SNodeKey& a_Key) const
+	{
+		if (iCmd != a_Key.iCmd)
+			return iCmd < a_Key.iCmd;
+
+		if (vOperand != a_Key.vOperand)
+			return vOperand < a_Key.vOperand;
+
+		return vArgs < a_Key.vArgs;
+	}
+
+	//------------------------------------------------------------------------------
+	ParserProgram::ParserProgram()
+		: m_vInstr(), m_vArgs(), m_vResults(), m_vStringBuf(), m_nMaxArgs(0), m_vReg()
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Compile a set of expressions into this program.
+		\param a_Parser The parser defining variables, constants and functions. Its expression is
+						changed by this function.
+		\param a_vExpr The expressions.
+		\throw ParserError if an expression is invalid or contains an assignment.
+	*/
+	void ParserProgram::Compile(ParserBase& a_Parser, const std::vector<string_type>& a_vExpr)
+	{
+		m_vInstr.clear();
+		m_vArgs.clear();
+		m_vResults.clear();
+		m_vStringBuf.clear();
+		m_nMaxArgs = 0;
+
+		nodemap_type vNodes;
+		std::vector<int> stVal, stCond, stThen;
+
+		for (std::size_t i = 0; i < a_vExpr.size(); ++i)
+		{
+			a_Parser.SetExpr(a_vExpr[i]);
+			a_Parser.CreateRPN();
+
+			// string arguments are referenced by their index in the string buffer
+			int nStrOffset = (int)m_vStringBuf.size();
+			m_vStringBuf.Append(*a_Parser.m_pStringBuf);
+
+			stVal.clear();
+			for (const SToken* pTok = a_Parser.m_pRPN->GetBase(); pTok->Cmd != cmEND; ++pTok)
+			{
+				SToken tok = *pTok;
+				std::size_t nArgs = 0;
+
+				switch (tok.Cmd)
+				{
+				case cmVAL:
+				case cmVAR:
+				case cmVARPOW2:
+				case cmVARPOW3:
+				case cmVARPOW4:
+				case cmVARMUL:
+					break;
+
+				case cmLE:
+				case cmGE:
+				case cmNEQ:
+				case cmEQ:
+				case cmLT:
+				case cmGT:
+				case cmADD:
+				case cmSUB:
+				case cmMUL:
+				case cmDIV:
+				case cmPOW:
+				case cmLAND:
+				case cmLOR:
+					nArgs = 2;
+					break;
+
+				// The ternary operator is turned into a select instruction (cmIF with three arguments)
+				case cmIF:
+					MUP_ASSERT(stVal.size() >= 1);
+					stCond.push_back(stVal.back());
+					stVal.pop_back();
+					continue;
+
+				case cmELSE:
+					MUP_ASSERT(stVal.size() >= 1);
+					stThen.push_back(stVal.back());
+					stVal.pop_back();
+					continue;
+
+				case cmENDIF:
+					MUP_ASSERT(stCond.size() >= 1 && stThen.size() >= 1);
+					stVal.insert(stVal.end() - 1, stThen.back());
+					stVal.insert(stVal.end() - 2, stCond.back());
+					stThen.pop_back();
+					stCond.pop_back();
+					tok.Cmd = cmIF;
+					nArgs = 3;
+					break;
+
+				case cmFUNC:
+					nArgs = (tok.Fun.argc >= 0) ? tok.Fun.argc : -tok.Fun.argc;
+					break;
+
+				case cmFUNC_BULK:
+					nArgs = tok.Fun.argc;
+					break;
+
+				case cmFUNC_STR:
+					nArgs = tok.Fun.argc;
+					tok.Fun.idx += nStrOffset;
+					break;
+
+				case cmASSIGN:
+					throw ParserError(ecUNEXPECTED_OPERATOR, _T("="), a_vExpr[i]);
+
+				default:
+					throw ParserError(ecINTERNAL_ERROR);
+				}
+
+				MUP_ASSERT(stVal.size() >= nArgs);
+				std::vector<int> vArgs(stVal.end() - nArgs, stVal.end());
+				stVal.erase(stVal.end() - nArgs, stVal.end());
+				stVal.push_back(AddNode(tok, vArgs, vNodes));
+			}
+
+			// comma separated subexpressions each contribute a result
+			m_vResults.insert(m_vResults.end(), stVal.begin(), stVal.end());
+		}
+
+		m_vReg.resize(std::max<std::size_t>(m_vInstr.size() + m_nMaxArgs, 1));
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add an instruction unless an identical one already exists.
+		\return The register holding the result.
+	*/
+	int ParserProgram::AddNode(const SToken& a_Tok, const std::vector<int>& a_vArgs, nodemap_type& a_vNodes)
+	{
+		SNodeKey key;
+		key.iCmd = a_Tok.Cmd;
+		key.vArgs = a_vArgs;
+
+		// Operands are compared bitwise so that NaN constants are handled correctly.
+		auto append = [&key](const void* a_pData, std::size_t a_nSize)
+		{
+			const unsigned char* pData = static_cast<const unsigned char*>(a_pData);
+			key.vOperand.insert(key.vOperand.end(), pData, pData + a_nSize);
+		};
+
+		bool bShare = true;
+		switch (a_Tok.Cmd)
+		{
+		case cmVAL:
+			append(&a_Tok.Val.data2, sizeof(a_Tok.Val.data2));
+			break;
+
+		case cmVAR:
+		case cmVARPOW2:
+		case cmVARPOW3:
+		case cmVARPOW4:
+			append(&a_Tok.Val.ptr, sizeof(a_Tok.Val.ptr));
+			append(&a_Tok.Val.stride, sizeof(a_Tok.Val.stride));
+			break;
+
+		case cmVARMUL:
+			append(&a_Tok.Val.ptr, sizeof(a_Tok.Val.ptr));
+			append(&a_Tok.Val.stride, sizeof(a_Tok.Val.stride));
+			append(&a_Tok.Val.data, sizeof(a_Tok.Val.data));
+			append(&a_Tok.Val.data2, sizeof(a_Tok.Val.data2));
+			break;
+
+		case cmADD:
+		case cmMUL:
+		case cmEQ:
+		case cmNEQ:
+		case cmLAND:
+		case cmLOR:
+			if (key.vArgs[0] > key.vArgs[1])
+				std::swap(key.vArgs[0], key.vArgs[1]);
+			break;
+
+		case cmFUNC:
+			bShare = a_Tok.Fun.optimizable;
+			append(&a_Tok.Fun.cb, sizeof(a_Tok.Fun.cb));
+			append(&a_Tok.Fun.argc, sizeof(a_Tok.Fun.argc));
+			break;
+
+		case cmFUNC_BULK:
+		case cmFUNC_STR:
+			bShare = false;
+			break;
+
+		default:
+			break;
+		}
+
+		if (bShare)
+		{
+			nodemap_type::const_iterator item = a_vNodes.find(key);
+			if (item != a_vNodes.end())
+				return item->second;
+		}
+
+		SInstr instr;
+		instr.Tok = a_Tok;
+		instr.iArg = (int)m_vArgs.size();
+		instr.nArgs = (int)key.vArgs.size();
+		m_vArgs.insert(m_vArgs.end(), key.vArgs.begin(), key.vArgs.end());
+		m_nMaxArgs = std::max(m_nMaxArgs, instr.nArgs);
+
+		int iReg = (int)m_vInstr.size();
+		m_vInstr.push_back(instr);
+
+		if (bShare)
+			a_vNodes[key] = iReg;
+
+		return iReg;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Execute all instructions for a single row.
+		\param a_nOffset The row index (bulk mode) or 0.
+		\param a_nThreadID The id of the calling thread, passed to bulk functions.
+		\param a_pReg The register file, followed by scratch space for function arguments.
+	*/
+	void ParserProgram::Run(int a_nOffset, int a_nThreadID, value_type* a_pReg) const
+	{
+		value_type* pArgBuf = a_pReg + m_vInstr.size();
+
+		for (std::size_t i = 0; i < m_vInstr.size(); ++i)
+		{
+			const SToken& tok = m_vInstr[i].Tok;
+			const int* arg = m_vArgs.data() + m_vInstr[i].iArg;
+			value_type buf;
+
+			switch (tok.Cmd)
+			{
+			case cmVAL:		a_pReg[i] = tok.Val.data2; continue;
+			case cmVAR:		a_pReg[i] = *(value_type*)((char*)tok.Val.ptr + a_nOffset * tok.Val.stride); continue;
+			case cmVARPOW2: buf = *(value_type*)((char*)tok.Val.ptr + a_nOffset * tok.Val.stride); a_pReg[i] = buf * buf; continue;
+			case cmVARPOW3: buf = *(value_type*)((char*)tok.Val.ptr + a_nOffset * tok.Val.stride); a_pReg[i] = buf * buf * buf; continue;
+			case cmVARPOW4: buf = *(value_type*)((char*)tok.Val.ptr + a_nOffset * tok.Val.stride); a_pReg[i] = buf * buf * buf * buf; continue;
+			case cmVARMUL:	a_pReg[i] = *(value_type*)((char*)tok.Val.ptr + a_nOffset * tok.Val.stride) * tok.Val.data + tok.Val.data2; continue;
+
+			case cmLE:		a_pReg[i] = a_pReg[arg[0]] <= a_pReg[arg[1]]; continue;
+			case cmGE:		a_pReg[i] = a_pReg[arg[0]] >= a_pReg[arg[1]]; continue;
+			case cmNEQ:		a_pReg[i] = a_pReg[arg[0]] != a_pReg[arg[1]]; continue;
+			case cmEQ:		a_pReg[i] = a_pReg[arg[0]] == a_pReg[arg[1]]; continue;
+			case cmLT:		a_pReg[i] = a_pReg[arg[0]] < a_pReg[arg[1]]; continue;
+			case cmGT:		a_pReg[i] = a_pReg[arg[0]] > a_pReg[arg[1]]; continue;
+			case cmADD:		a_pReg[i] = a_pReg[arg[0]] + a_pReg[arg[1]]; continue;
+			case cmSUB:		a_pReg[i] = a_pReg[arg[0]] - a_pReg[arg[1]]; continue;
+			case cmMUL:		a_pReg[i] = a_pReg[arg[0]] * a_pReg[arg[1]]; continue;
+			case cmDIV:		a_pReg[i] = a_pReg[arg[0]] / a_pReg[arg[1]]; continue;
+			case cmPOW:		a_pReg[i] = MathImpl<value_type>::Pow(a_pReg[arg[0]], a_pReg[arg[1]]); continue;
+			case cmLAND:	a_pReg[i] = a_pReg[arg[0]] && a_pReg[arg[1]]; continue;
+			case cmLOR:		a_pReg[i] = a_pReg[arg[0]] || a_pReg[arg[1]]; continue;
+
+			// select: both branches have already been computed
+			case cmIF:		a_pReg[i] = (a_pReg[arg[0]] != 0) ? a_pReg[arg[1]] : a_pReg[arg[2]]; continue;
+
+			case cmFUNC:
+			case cmFUNC_BULK:
+			case cmFUNC_STR:
+				for (int k = 0; k < m_vInstr[i].nArgs; ++k)
+					pArgBuf[k] = a_pReg[arg[k]];
+
+				if (tok.Cmd == cmFUNC)
+					a_pReg[i] = CallFun(tok, pArgBuf);
+				else if (tok.Cmd == cmFUNC_BULK)
+					a_pReg[i] = CallBulkFun(tok, a_nOffset, a_nThreadID, pArgBuf);
+				else
+					a_pReg[i] = ParserByteCode::CallStrFun(tok, m_vStringBuf, pArgBuf);
+				continue;
+
+			default:
+				throw ParserError(ecINTERNAL_ERROR);
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	value_type ParserProgram::CallFun(const SToken& a_Tok, const value_type* a)
+	{
+		switch (a_Tok.Fun.argc)
+		{
+		case 0:  return a_Tok.Fun.cb.call_fun<0>();
+		case 1:  return a_Tok.Fun.cb.call_fun<1>(a[0]);
+		case 2:  return a_Tok.Fun.cb.call_fun<2>(a[0], a[1]);
+		case 3:  return a_Tok.Fun.cb.call_fun<3>(a[0], a[1], a[2]);
+		case 4:  return a_Tok.Fun.cb.call_fun<4>(a[0], a[1], a[2], a[3]);
+		case 5:  return a_Tok.Fun.cb.call_fun<5>(a[0], a[1], a[2], a[3], a[4]);
+		case 6:  return a_Tok.Fun.cb.call_fun<6>(a[0], a[1], a[2], a[3], a[4], a[5]);
+		case 7:  return a_Tok.Fun.cb.call_fun<7>(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+		case 8:  return a_Tok.Fun.cb.call_fun<8>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+		case 9:  return a_Tok.Fun.cb.call_fun<9>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+		case 10: return a_Tok.Fun.cb.call_fun<10>(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+		default:
+			// functions with variable argument count store the number of arguments as a negative value
+			if (a_Tok.Fun.argc > 0)
+				throw ParserError(ecINTERNAL_ERROR);
+
+			return a_Tok.Fun.cb.call_multfun(a, -a_Tok.Fun.argc);
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	value_type ParserProgram::CallBulkFun(const SToken& a_Tok, int n, int t, const value_type* a)
+	{
+		switch (a_Tok.Fun.argc)
+		{
+		case 0:  return a_Tok.Fun.cb.call_bulkfun<0>(n, t);
+		case 1:  return a_Tok.Fun.cb.call_bulkfun<1>(n, t, a[0]);
+		case 2:  return a_Tok.Fun.cb.call_bulkfun<2>(n, t, a[0], a[1]);
+		case 3:  return a_Tok.Fun.cb.call_bulkfun<3>(n, t, a[0], a[1], a[2]);
+		case 4:  return a_Tok.Fun.cb.call_bulkfun<4>(n, t, a[0], a[1], a[2], a[3]);
+		case 5:  return a_Tok.Fun.cb.call_bulkfun<5>(n, t, a[0], a[1], a[2], a[3], a[4]);
+		case 6:  return a_Tok.Fun.cb.call_bulkfun<6>(n, t, a[0], a[1], a[2], a[3], a[4], a[5]);
+		case 7:  return a_Tok.Fun.cb.call_bulkfun<7>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+		case 8:  return a_Tok.Fun.cb.call_bulkfun<8>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+		case 9:  return a_Tok.Fun.cb.call_bulkfun<9>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+		case 10: return a_Tok.Fun.cb.call_bulkfun<10>(n, t, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+		default:
+			throw ParserError(ecINTERNAL_ERROR);
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Evaluate all expressions for the current variable values.
+		\param [out] a_pResults Array receiving GetNumResults() values.
+	*/
+	void ParserProgram::Eval(value_type* a_pResults) const
+	{
+		Run(0, 0, &m_vReg[0]);
+
+		for (std::size_t k = 0; k < m_vResults.size(); ++k)
+			a_pResults[k] = m_vReg[m_vResults[k]];
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Evaluate all expressions in bulk mode.
+		\param [out] a_ppResults Array of GetNumResults() result columns with a_nBulkSize entries each.
+		\param a_nBulkSize The number of rows.
+
+		Variables are addressed as in ParserBase::Eval(value_type*, int), including their strides.
+	*/
+	void ParserProgram::Eval(value_type* const* a_ppResults, int a_nBulkSize) const
+	{
+		const std::size_t nRegs = m_vReg.size();
+
+#ifdef MUP_USE_OPENMP
+		int nMaxThreads = std::min(omp_get_max_threads(), ParserBase::s_MaxNumOpenMPThreads);
+
+#pragma omp parallel num_threads(nMaxThreads)
+		{
+			int nThread = omp_get_thread_num();
+			int nThreads = omp_get_num_threads();
+			std::vector<value_type> vReg(nRegs);
+
+			int iBegin, iEnd;
+			ParserNumaTopology::GetThreadRange(nThread, nThreads, a_nBulkSize, iBegin, iEnd);
+			for (int i = iBegin; i < iEnd; ++i)
+			{
+				Run(i, nThread, &vReg[0]);
+				for (std::size_t k = 0; k < m_vResults.size(); ++k)
+					a_ppResults[k][i] = vReg[m_vResults[k]];
+			}
+		}
+#else
+		std::vector<value_type> vReg(nRegs);
+		for (int i = 0; i < a_nBulkSize; ++i)
+		{
+			Run(i, 0, &vReg[0]);
+			for (std::size_t k = 0; k < m_vResults.size(); ++k)
+				a_ppResults[k][i] = vReg[m_vResults[k]];
+		}
+#endif
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of results written per row. */
+	int ParserProgram::GetNumResults() const
+	{
+		return (int)m_vResults.size();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the number of instructions executed per row. */
+	std::size_t ParserProgram::GetNumInstructions() const
+	{
+		return m_vInstr.size();
+	}
+} // namespace mu
@@ -0,0 +1,202 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "muParserStringPool.h"
+
+#include <functional>
+
+/** \file
+	\brief Implementation of the string pool.
+*/
+
+namespace mu
+{
+	//------------------------------------------------------------------------------
+	ParserStringPool::ParserStringPool()
+		:m_vStr()
+		, m_vHash()
+		, m_vSlot()
+		, m_nDistinct(0)
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Create an empty pool allocating its memory from the given resource. */
+	ParserStringPool::ParserStringPool(ParserMemoryResource* a_pResource)
+		:m_vStr(strbuf_type::allocator_type(a_pResource))
+		, m_vHash(ParserAllocator<std::size_t>(a_pResource))
+		, m_vSlot(ParserAllocator<int>(a_pResource))
+		, m_nDistinct(0)
+	{}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add a string unless an equal string is already in the pool.
+		\return The index of the string.
+	*/
+	int ParserStringPool::Intern(const string_type& a_sStr)
+	{
+		std::size_t nHash = std::hash<string_type>()(a_sStr);
+		int iIdx = Find(a_sStr, nHash);
+		if (iIdx >= 0)
+			return iIdx;
+
+		m_vStr.push_back(a_sStr);
+		m_vHash.push_back(nHash);
+		Index((int)m_vStr.size() - 1);
+		return (int)m_vStr.size() - 1;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add a string at the end of the pool, even if an equal string is already in it.
+		\return The index of the string.
+	*/
+	int ParserStringPool::Add(const string_type& a_sStr)
+	{
+		m_vStr.push_back(a_sStr);
+		m_vHash.push_back(std::hash<string_type>()(a_sStr));
+		Index((int)m_vStr.size() - 1);
+		return (int)m_vStr.size() - 1;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add all strings of another pool, their indices are shifted by the size of this pool. */
+	void ParserStringPool::Append(const ParserStringPool& a_Pool)
+	{
+		std::size_t nFirst = m_vStr.size();
+		m_vStr.insert(m_vStr.end(), a_Pool.m_vStr.begin(), a_Pool.m_vStr.end());
+		m_vHash.insert(m_vHash.end(), a_Pool.m_vHash.begin(), a_Pool.m_vHash.end());
+		for (std::size_t i = nFirst; i < m_vStr.size(); ++i)
+			Index((int)i);
+	}
+
+	//------------------------------------------------------------------------------
+	void ParserStringPool::clear()
+	{
+		m_vStr.clear();
+		m_vHash.clear();
+		m_vSlot.clear();
+		m_nDistinct = 0;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Look up a string in the hash index.
+		\return The index of the first equal string in the pool or -1 if there is none.
+	*/
+	int ParserStringPool::Find(const string_type& a_sStr, std::size_t a_nHash) const
+	{
+		if (m_vSlot.empty())
+			return -1;
+
+		std::size_t nMask = m_vSlot.size() - 1;
+		for (std::size_t i = a_nHash & nMask; m_vSlot[i] >= 0; i = (i + 1) & nMask)
+		{
+			int iIdx = m_vSlot[i];
+			if (m_vHash[iIdx] == a_nHash && m_vStr[iIdx] == a_sStr)
+				return iIdx;
+		}
+
+		return -1;
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Add the string with the given index to the hash index, growing it if it is half full. */
+	void ParserStringPool::Index(int a_iIdx)
+	{
+		if ((m_nDistinct + 1) * 2 > m_vSlot.size())
+			Rehash();
+		else
+			InsertSlot(a_iIdx);
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Store a string index in a free slot unless an equal string is already indexed. */
+	void ParserStringPool::InsertSlot(int a_iIdx)
+	{
+		std::size_t nMask = m_vSlot.size() - 1;
+		for (std::size_t i = m_vHash[a_iIdx] & nMask; ; i = (i + 1) & nMask)
+		{
+			int& iSlot = m_vSlot[i];
+			if (iSlot < 0)
+			{
+				iSlot = a_iIdx;
+				++m_nDistinct;
+				return;
+			}
+
+			if (m_vHash[iSlot] == m_vHash[a_iIdx] && m_vStr[iSlot] == m_vStr[a_iIdx])
+				return;
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Rebuild the hash index with room for twice the number of strings in the pool. */
+	void ParserStringPool::Rehash()
+	{
+		std::size_t nCap = 16;
+		while (nCap < m_vStr.size() * 2)
+			nCap *= 2;
+
+		m_vSlot.assign(nCap, -1);
+		m_nDistinct = 0;
+		for (std::size_t i = 0; i < m_vStr.size(); ++i)
+			InsertSlot((int)i);
+	}
+
+	//------------------------------------------------------------------------------
+	std::size_t ParserStringPool::size() const
+	{
+		return m_vStr.size();
+	}
+
+	//------------------------------------------------------------------------------
+	bool ParserStringPool::empty() const
+	{
+		return m_vStr.empty();
+	}
+
+	//------------------------------------------------------------------------------
+	ParserStringPool::const_iterator ParserStringPool::begin() const
+	{
+		return m_vStr.begin();
+	}
+
+	//------------------------------------------------------------------------------
+	ParserStringPool::const_iterator ParserStringPool::end() const
+	{
+		return m_vStr.end();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Returns the heap memory held by the pool in bytes. */
+	std::size_t ParserStringPool::GetMemoryUsage() const
+	{
+		std::size_t nBytes = m_vStr.capacity() * sizeof(string_type) + m_vHash.capacity() * sizeof(std::size_t) + m_vSlot.capacity() * sizeof(int);
+		for (const auto& str : m_vStr)
+			nBytes += GetHeapSize(str);
+
+		return nBytes;
+	}
+} // namespace mu
@@ -27,11 +27,23 @@
 */
 
 #include "muParserTest.h"
+#include "muParserNuma.h"
+#include "muParserProgram.h"
+#include "muParserBundle.h"
+#include "muParserFloatEngine.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+	#include <sched.h>
+#endif
 
 using namespace std;
 
@@ -63,64 +75,1600 @@ namespace mu
 			AddTest(&ParserTester::TestStrArg);
 			AddTest(&ParserTester::TestBulkMode);
 			AddTest(&ParserTester::TestOptimizer);
+			AddTest(&ParserTester::TestProgram);
+			AddTest(&ParserTester::TestExprCache);
+			AddTest(&ParserTester::TestSymbolIndex);
+			AddTest(&ParserTester::TestValueScan);
+			AddTest(&ParserTester::TestByteCodeIO);
+			AddTest(&ParserTester::TestBundle);
+			AddTest(&ParserTester::TestBatchCompile);
+			AddTest(&ParserTester::TestDependencyTracking);
+			AddTest(&ParserTester::TestReplaceRange);
+			AddTest(&ParserTester::TestSharedSymbols);
+			AddTest(&ParserTester::TestClone);
+			AddTest(&ParserTester::TestMemoryResource);
+			AddTest(&ParserTester::TestStringPool);
+			AddTest(&ParserTester::TestMemoryUsage);
+			AddTest(&ParserTester::TestFloatEngine);
 
 			ParserTester::c_iCount = 0;
 		}
 
-		//---------------------------------------------------------------------------------------------
-		int ParserTester::IsHexVal(const char_type* a_szExpr, int* a_iPos, value_type* a_fVal)
-		{
-			if (a_szExpr[1] == 0 || (a_szExpr[0] != '0' || a_szExpr[1] != 'x'))
-				return 0;
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::IsHexVal(const char_type* a_szExpr, int* a_iPos, value_type* a_fVal)
+		{
+			if (a_szExpr[1] == 0 || (a_szExpr[0] != '0' || a_szExpr[1] != 'x'))
+				return 0;
+
+			unsigned iVal(0);
+
+			// New code based on streams for UNICODE compliance:
+			stringstream_type::pos_type nPos(0);
+			stringstream_type ss(a_szExpr + 2);
+			ss >> std::hex >> iVal;
+			nPos = ss.tellg();
+
+			if (nPos == (stringstream_type::pos_type)0)
+				return 1;
+
+			*a_iPos += (int)(2 + nPos);
+			*a_fVal = (value_type)iVal;
+			return 1;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestInterface()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing member functions...");
+
+			// Test RemoveVar
+			value_type afVal[3] = { 1,2,3 };
+			Parser p;
+
+			try
+			{
+				p.DefineVar(_T("a"), &afVal[0]);
+				p.DefineVar(_T("b"), &afVal[1]);
+				p.DefineVar(_T("c"), &afVal[2]);
+				p.SetExpr(_T("a+b+c"));
+				p.Eval();
+			}
+			catch (...)
+			{
+				iStat += 1;  // this is not supposed to happen 
+			}
+
+			try
+			{
+				p.RemoveVar(_T("c"));
+				p.Eval();
+				iStat += 1;  // not supposed to reach this, nonexisting variable "c" deleted...
+			}
+			catch (...)
+			{
+				// failure is expected...
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestOptimizer()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing optimizer...");
+
+			// Test RemoveVar
+			Parser p;
+			try
+			{
+				// test for #93 (https://github.com/beltoforion/muparser/issues/93)
+				// expected bytecode is:
+				// VAL, FUN
+				{
+					p.DefineFun(_T("unoptimizable"), f1of1, false);
+					p.SetExpr(_T("unoptimizable(1)"));
+					p.Eval();
+
+					auto& bc = p.GetByteCode();
+					const SToken* tok = bc.GetBase();
+					if (bc.GetSize() != 2 && tok[1].Cmd != cmFUNC)
+					{
+						mu::console() << _T("#93 an unoptimizable expression was optimized!") << endl;
+						iStat += 1;
+					}
+				}
+
+				{
+					p.ClearFun();
+					p.DefineFun(_T("unoptimizable"), f1of1, true);
+					p.SetExpr(_T("unoptimizable(1)"));
+					p.Eval();
+
+					auto& bc = p.GetByteCode();
+					const SToken* tok = bc.GetBase();
+					if (bc.GetSize() != 1 && tok[0].Cmd != cmVAL)
+					{
+						mu::console() << _T("#93 optimizer error") << endl;
+						iStat += 1;
+					}
+				}
+			}
+			catch (...)
+			{
+				iStat += 1;  // this is not supposed to happen 
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestProgram()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing programs...");
+
+			value_type vA[] = { 1, 2, 3, 4 };
+			value_type vB[] = { 2, 3, 4, 5 };
+
+			try
+			{
+				Parser p;
+				p.DefineVar(_T("a"), vA);
+				p.DefineVar(_T("b"), vB);
+				p.DefineFun(_T("sum"), Sum);
+				p.DefineFun(_T("strfun2"), StrFun2);
+
+				std::vector<string_type> vExpr;
+				vExpr.push_back(_T("a*b + sin(a*b)"));
+				vExpr.push_back(_T("sin(b*a) * 2"));
+				vExpr.push_back(_T("a > 2 ? a*b : -b"));
+				vExpr.push_back(_T("sum(a, b, a*b), a^2"));
+				vExpr.push_back(_T("strfun2(\"100\", b*a)"));
+
+				ParserProgram prog;
+				prog.Compile(p, vExpr);
+				iStat += (prog.GetNumResults() == 6) ? 0 : 1;
+
+				// a, b, a*b, sin, + | 2, * | >, -b, select | sum, a^2 | strfun2
+				iStat += (prog.GetNumInstructions() == 13) ? 0 : 1;
+
+				value_type vRes[4][6];
+				value_type* vCol[6];
+				for (int k = 0; k < 6; ++k)
+					vCol[k] = &vRes[0][0] + k * 4;
+
+				prog.Eval(vCol, 4);
+				for (int i = 0; i < 4; ++i)
+				{
+					value_type a = vA[i], b = vB[i];
+					value_type vExpected[] = { a * b + std::sin(a * b), std::sin(a * b) * 2, (a > 2) ? a * b : -b, a + b + a * b, a * a, 100 + a * b };
+					for (int k = 0; k < 6; ++k)
+						iStat += (vCol[k][i] == vExpected[k]) ? 0 : 1;
+				}
+
+				// single row evaluation uses the first element of each variable
+				value_type vRow[6];
+				prog.Eval(vRow);
+				for (int k = 0; k < 6; ++k)
+					iStat += (vRow[k] == vCol[k][0]) ? 0 : 1;
+
+				// functions that are not optimizable must not be shared
+				p.DefineFun(_T("unoptimizable"), f1of1, false);
+				std::vector<string_type> vVolatile;
+				vVolatile.push_back(_T("unoptimizable(a)"));
+				vVolatile.push_back(_T("unoptimizable(a)"));
+				prog.Compile(p, vVolatile);
+				iStat += (prog.GetNumInstructions() == 3) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			try
+			{
+				Parser p;
+				p.DefineVar(_T("a"), vA);
+
+				std::vector<string_type> vExpr;
+				vExpr.push_back(_T("a = 1"));
+
+				ParserProgram prog;
+				prog.Compile(p, vExpr);
+				iStat += 1;  // assignments are not supported in programs
+			}
+			catch (ParserError&)
+			{
+				// failure is expected...
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestExprCache()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing expression cache...");
+
+			try
+			{
+				value_type a = 2, b = 3;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.EnableExprCache(2);
+
+				p.SetExpr(_T("a*b+1"));
+				iStat += (p.Eval() == 7) ? 0 : 1;
+				p.SetExpr(_T("a+b"));
+				iStat += (p.Eval() == 5) ? 0 : 1;
+
+				// a hit restores the bytecode without compiling the expression
+				p.SetExpr(_T("a*b+1"));
+				iStat += (p.GetByteCode().GetSize() > 0) ? 0 : 1;
+				a = 3;
+				iStat += (p.Eval() == 10) ? 0 : 1;
+
+				// multiple return values and string arguments
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.SetExpr(_T("strfun2(\"100\", a), b"));
+				p.Eval();
+				p.SetExpr(_T("strfun2(\"100\", a), b"));
+				int nNum = 0;
+				value_type* v = p.Eval(nNum);
+				iStat += (nNum == 2 && v[0] == 103 && v[1] == 3) ? 0 : 1;
+
+				Parser::SExprCacheStats stats = p.GetExprCacheStats();
+				iStat += (stats.nHits == 2) ? 0 : 1;
+				iStat += (stats.nMisses == 3) ? 0 : 1;
+				iStat += (stats.nEvictions == 1) ? 0 : 1;
+				iStat += (stats.nEntries == 2) ? 0 : 1;
+
+				// changing the definitions invalidates the cached bytecode
+				value_type c = 10;
+				p.DefineVar(_T("a"), &c);
+				p.SetExpr(_T("strfun2(\"100\", a), b"));
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+				v = p.Eval(nNum);
+				iStat += (nNum == 2 && v[0] == 110) ? 0 : 1;
+				iStat += (p.GetExprCacheStats().nMisses == 4) ? 0 : 1;
+
+				// a byte limit evicts entries as well
+				p.EnableExprCache(10, 1);
+				iStat += (p.GetExprCacheStats().nEntries == 0) ? 0 : 1;
+				p.SetExpr(_T("a+b"));
+				iStat += (p.Eval() == 13) ? 0 : 1;
+				iStat += (p.GetExprCacheStats().nEntries == 0) ? 0 : 1;
+
+				// disabled cache
+				p.EnableExprCache(0);
+				p.SetExpr(_T("a+b"));
+				iStat += (p.Eval() == 13 && p.GetExprCacheStats().nMisses == 5) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			// the locale is shared, a change by another parser invalidates cached entries and recorded tokens
+			try
+			{
+				Parser p1, p2;
+				p2.EnableExprCache(10);
+				p1.SetThousandsSep('\'');
+
+				p2.SetExpr(_T("1'000+1"));
+				iStat += (p2.Eval() == 1001) ? 0 : 1;
+				p2.SetExpr(_T("2"));
+				iStat += (p2.Eval() == 2) ? 0 : 1;
+
+				p1.ResetLocale();
+				try
+				{
+					p2.SetExpr(_T("1'000+1"));
+					p2.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+				}
+
+				// the edit leaves "1'000" in front of it, its recorded tokens must not be replayed
+				p1.SetThousandsSep('\'');
+				p2.EnableExprCache(0);
+				p2.SetExpr(_T("1'000+1"));
+				p2.ReplaceRange(6, 1, _T("2"));
+				iStat += (p2.Eval() == 1002) ? 0 : 1;
+
+				p1.ResetLocale();
+				try
+				{
+					p2.ReplaceRange(6, 1, _T("3"));
+					p2.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+				}
+			}
+			catch (...)
+			{
+				Parser().ResetLocale();
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestSymbolIndex()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing symbol index...");
+
+			try
+			{
+				std::vector<value_type> vVar(1000);
+				Parser p;
+				p.EnableSymbolIndex();
+				for (int i = 0; i < (int)vVar.size(); ++i)
+				{
+					vVar[i] = i;
+					stringstream_type ss;
+					ss << _T("v") << i;
+					p.DefineVar(ss.str(), &vVar[i]);
+					p.DefineConst(_T("c") + ss.str(), 2 * i);
+				}
+
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.DefineStrConst(_T("strval"), _T("10"));
+
+				p.SetExpr(_T("v1 + v999 * cv3 - sin(v0) + strfun2(strval, v10) + _pi"));
+				value_type fExpected = 1 + 999 * 6 - 0 + 20 + (value_type)MathImpl<value_type>::CONST_PI;
+				iStat += (p.Eval() == fExpected) ? 0 : 1;
+
+				// unknown names are still rejected
+				p.SetExpr(_T("v1000 + 1"));
+				try
+				{
+					p.Eval();
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecUNASSIGNABLE_TOKEN) ? 0 : 1;
+				}
+
+				// the index picks up changes of the symbol tables
+				value_type fNew = 100;
+				p.DefineVar(_T("v1000"), &fNew);
+				p.RemoveVar(_T("v999"));
+				p.SetExpr(_T("v1000 + 1"));
+				iStat += (p.Eval() == 101) ? 0 : 1;
+				p.SetExpr(_T("v999"));
+				try
+				{
+					p.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+					// failure is expected...
+				}
+
+				// copies rebuild the index for their own symbol tables
+				Parser p2(p);
+				p2.SetExpr(_T("v1000 * v2"));
+				iStat += (p2.Eval() == 200) ? 0 : 1;
+
+				// variables created by the factory are indexed as well
+				value_type vFactory[] = { 0, 5, 7 };
+				p.SetVarFactory(VarFactory, vFactory);
+				p.SetExpr(_T("new1 + v2"));
+				iStat += (p.Eval() == 7) ? 0 : 1;
+				p.SetExpr(_T("new1 * new2"));
+				iStat += (p.Eval() == 35 && vFactory[0] == 2) ? 0 : 1;
+
+				// the variables were added to a copy of the table shared with p2
+				iStat += (p2.GetVar().count(_T("new1")) == 0 && p.GetVar().count(_T("new1")) == 1) ? 0 : 1;
+
+				p.EnableSymbolIndex(false);
+				p.SetExpr(_T("new1 + v1000 + cv1"));
+				iStat += (p.Eval() == 107) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestValueScan()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing value recognition...");
+
+			// The scanner must produce the same values as a stream
+			const char_type* szLiteral[] = {
+				_T("0"), _T("1"), _T("3.14159"), _T("0.1"), _T("1e10"), _T("1.5e-7"), _T("2E+3"),
+				_T("123456789012345678901234567890"), _T("0.000000000000000000000000001"),
+				_T("9007199254740993"), _T("1.7976931348623157e308"), _T("2.2250738585072014e-308"),
+				_T("4.9406564584124654e-324"), _T(".5"), _T("5."), _T("1.e3"), _T("00012.5000"), 
+				_T("0.30000000000000004"), _T("123.456e-20"), 0 };
+
+			try
+			{
+				Parser p;
+				for (int i = 0; szLiteral[i]; ++i)
+				{
+					stringstream_type stream(szLiteral[i]);
+					stream.imbue(std::locale::classic());
+					value_type fExpected(0);
+					stream >> fExpected;
+
+					p.SetExpr(szLiteral[i]);
+					iStat += (p.Eval() == fExpected) ? 0 : 1;
+				}
+
+				// a custom decimal separator
+				p.SetDecSep(',');
+				p.SetArgSep(';');
+				p.SetExpr(_T("1,25*4 + min(0,5; 2)"));
+				iStat += (p.Eval() == 5.5) ? 0 : 1;
+
+				// thousands separators are handled by the stream
+				p.SetThousandsSep('\'');
+				p.SetExpr(_T("1'000'000 + 0,5"));
+				iStat += (p.Eval() == 1000000.5) ? 0 : 1;
+				p.ResetLocale();
+
+				p.SetExpr(_T("1.5+2"));
+				iStat += (p.Eval() == 3.5) ? 0 : 1;
+			}
+			catch (...)
+			{
+				Parser().ResetLocale();
+				iStat += 1;
+			}
+
+			// an exponent without digits is no value
+			iStat += ThrowTest(_T("1e+2*3e"), ecUNASSIGNABLE_TOKEN);
+
+			ParserInt pInt;
+			try
+			{
+				pInt.SetExpr(_T("0xff + #101 + 0x7FFFFFFF - 2147483647"));
+				iStat += (pInt.Eval() == 260) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			try
+			{
+				pInt.SetExpr(_T("0x1ffffffff"));
+				pInt.Eval();
+				iStat += 1;
+			}
+			catch (ParserError&)
+			{
+				// overflow is expected...
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestByteCodeIO()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing bytecode serialization...");
+
+			const char_type* szExpr[] = {
+				_T("a*b+sin(a)"),
+				_T("a=b*2, a+1"),
+				_T("a<b ? strfun2(\"100\", b) : 0"),
+				_T("-a + b{m} + (a add b)"),
+				_T("sum(a, b, 4)*funud1_16(a)"),
+				_T("a^2"),
+				_T("3*4") };
+			const int nExpr = sizeof(szExpr) / sizeof(szExpr[0]);
+
+			auto defineSymbols = [](Parser& p, value_type* pA, value_type* pB)
+			{
+				p.DefineVar(_T("a"), pA);
+				p.DefineVar(_T("b"), pB);
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.DefineFun(_T("sum"), Sum);
+				p.DefineFunUserData(_T("funud1_16"), FunUd1, reinterpret_cast<void*>(16));
+				p.DefineOprt(_T("add"), add, 0);
+				p.DefinePostfixOprt(_T("{m}"), Milli);
+			};
+
+			try
+			{
+				// save with one set of variable addresses, load into a parser with different ones
+				value_type a1 = 0, b1 = 0, a2 = 0, b2 = 0, a3 = 0, b3 = 0;
+				Parser p1, p2, p3;
+				defineSymbols(p1, &a1, &b1);
+				defineSymbols(p2, &a2, &b2);
+				defineSymbols(p3, &a3, &b3);
+
+				std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+				for (int i = 0; i < nExpr; ++i)
+				{
+					p1.SetExpr(szExpr[i]);
+					p1.SaveByteCode(ss);
+				}
+
+				for (int i = 0; i < nExpr; ++i)
+				{
+					p2.LoadByteCode(ss);
+					p3.SetExpr(szExpr[i]);
+					iStat += (p2.GetExpr() == string_type(szExpr[i]) + _T(" ")) ? 0 : 1;
+					iStat += (p2.GetByteCode().GetSize() > 0) ? 0 : 1;
+
+					a2 = a3 = 1;
+					b2 = b3 = 2;
+					int n2 = 0, n3 = 0;
+					value_type* v2 = p2.Eval(n2);
+					value_type* v3 = p3.Eval(n3);
+					iStat += (n2 == n3) ? 0 : 1;
+					for (int k = 0; k < n2 && k < n3; ++k)
+						iStat += (v2[k] == v3[k]) ? 0 : 1;
+
+					iStat += (a2 == a3 && b2 == b3) ? 0 : 1;
+				}
+
+				// damaged data
+				ss.clear();
+				ss.str(std::string());
+				p1.SetExpr(szExpr[0]);
+				p1.SaveByteCode(ss);
+				std::string sData = ss.str();
+				sData[sData.size() - 3] ^= 0x55;
+				std::stringstream ssBad(sData, std::ios::in | std::ios::binary);
+				try
+				{
+					p2.LoadByteCode(ssBad);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_BYTECODE) ? 0 : 1;
+				}
+
+				// truncated data
+				std::stringstream ssShort(sData.substr(0, 10), std::ios::in | std::ios::binary);
+				try
+				{
+					p2.LoadByteCode(ssShort);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_BYTECODE) ? 0 : 1;
+				}
+
+				// a failed load keeps the current expression
+				iStat += (p2.GetExpr() == string_type(szExpr[nExpr - 1]) + _T(" ") && p2.Eval() == 12) ? 0 : 1;
+
+				// symbols which are undefined or have a different signature in the loading parser
+				ss.clear();
+				ss.str(std::string());
+				p1.SetExpr(_T("a + strfun2(\"1\", b)"));
+				p1.SaveByteCode(ss);
+				sData = ss.str();
+
+				Parser p4;
+				p4.DefineVar(_T("a"), &a2);
+				p4.DefineFun(_T("strfun2"), StrFun2);
+				std::stringstream ss4(sData, std::ios::in | std::ios::binary);
+				try
+				{
+					p4.LoadByteCode(ss4);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecBYTECODE_SYMBOL_MISMATCH && e.GetToken() == _T("b")) ? 0 : 1;
+				}
+
+				Parser p5;
+				p5.DefineVar(_T("a"), &a2);
+				p5.DefineVar(_T("b"), &b2);
+				p5.DefineFun(_T("strfun2"), StrFun3);
+				std::stringstream ss5(sData, std::ios::in | std::ios::binary);
+				try
+				{
+					p5.LoadByteCode(ss5);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecBYTECODE_SYMBOL_MISMATCH && e.GetToken() == _T("strfun2")) ? 0 : 1;
+				}
+
+				// handcrafted bytecode: the stack size and the argument counts stored in the data are not trusted
+				struct SFunSymbols : public ParserByteCodeSymbols
+				{
+					ParserCallback m_Fun;
+					SFunSymbols() : m_Fun(f1of1, true) {}
+					bool FindVarName(const value_type*, string_type&) const override { return false; }
+					value_type* GetVarAddr(const string_type&, std::ptrdiff_t&) const override { return nullptr; }
+					bool FindCallbackName(const generic_callable_type&, int&, string_type&) const override { return false; }
+					const ParserCallback* GetCallback(int a_iTable, const string_type& a_sName) const override
+					{
+						return (a_iTable == ctFUN && a_sName == _T("f")) ? &m_Fun : nullptr;
+					}
+				} funSymbols;
+
+				auto loadRPN = [&funSymbols](const std::vector<int>& a_vCmd, std::uint64_t a_nMaxStackSize, int a_iFunArgc) -> ParserByteCode
+				{
+					std::ostringstream os;
+					ParserByteCode::WriteBinary<std::uint64_t>(os, a_nMaxStackSize);
+					ParserByteCode::WriteBinary<std::uint32_t>(os, 1);
+					ParserByteCode::WriteBinary<std::uint8_t>(os, 1);
+					ParserByteCode::WriteBinary<std::uint64_t>(os, a_vCmd.size());
+					for (int iCmd : a_vCmd)
+					{
+						ParserByteCode::WriteBinary<std::int32_t>(os, iCmd);
+						if (iCmd == cmVAL)
+						{
+							ParserByteCode::WriteString(os, string_type());
+							ParserByteCode::WriteBinary<value_type>(os, 0);
+							ParserByteCode::WriteBinary<value_type>(os, 1);
+						}
+						else if (iCmd == cmFUNC)
+						{
+							ParserByteCode::WriteBinary<std::int32_t>(os, ParserByteCodeSymbols::ctFUN);
+							ParserByteCode::WriteString(os, _T("f"));
+							ParserByteCode::WriteBinary<std::int32_t>(os, funSymbols.m_Fun.GetArgc());
+							ParserByteCode::WriteBinary<std::int32_t>(os, funSymbols.m_Fun.GetCode());
+							ParserByteCode::WriteBinary<std::int32_t>(os, funSymbols.m_Fun.GetType());
+							ParserByteCode::WriteBinary<std::uint8_t>(os, 0);
+							ParserByteCode::WriteBinary<std::int32_t>(os, a_iFunArgc);
+							ParserByteCode::WriteBinary<std::int32_t>(os, 0);
+							ParserByteCode::WriteBinary<std::uint8_t>(os, 1);
+						}
+					}
+
+					const std::string sRPN = os.str();
+					const char* pPos = sRPN.data();
+					ParserByteCode bc;
+					bc.Load(pPos, sRPN.data() + sRPN.size(), funSymbols);
+					return bc;
+				};
+
+				auto isInvalid = [&loadRPN](const std::vector<int>& a_vCmd, int a_iFunArgc)
+				{
+					try
+					{
+						loadRPN(a_vCmd, 100, a_iFunArgc);
+						return false;
+					}
+					catch (ParserError& e)
+					{
+						return e.GetCode() == ecINVALID_BYTECODE;
+					}
+				};
+
+				// the stack depth is recomputed from the instructions, not taken from the data
+				iStat += (loadRPN({ cmVAL, cmVAL, cmVAL, cmADD, cmADD, cmEND }, 0, 1).GetMaxStackSize() == 4) ? 0 : 1;
+				iStat += (loadRPN({ cmVAL, cmFUNC, cmEND }, 100, 1).GetMaxStackSize() == 2) ? 0 : 1;
+
+				// stack underflow, argument counts differing from the callback, instructions not allowed in bytecode
+				iStat += isInvalid({ cmVAL, cmADD, cmEND }, 1) ? 0 : 1;
+				iStat += isInvalid({ cmVAL, cmFUNC, cmEND }, 2) ? 0 : 1;
+				iStat += isInvalid({ cmVAL, cmFUNC, cmEND }, -1) ? 0 : 1;
+				iStat += isInvalid({ cmFUNC, cmEND }, 1) ? 0 : 1;
+				iStat += isInvalid({ cmVAL, cmBO, cmEND }, 1) ? 0 : 1;
+				iStat += isInvalid({ cmVAL, cmEND, cmVAL, cmEND }, 1) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestBundle()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing expression bundles...");
+
+			const char* szFile = "muparser_test_bundle.bin";
+			try
+			{
+				value_type a1 = 0, b1 = 0, a2 = 0, b2 = 0;
+				Parser p1, p2;
+				p1.DefineVar(_T("a"), &a1);
+				p1.DefineVar(_T("b"), &b1);
+				p1.DefineFun(_T("strfun2"), StrFun2);
+				p2.DefineVar(_T("b"), &b2);
+				p2.DefineVar(_T("a"), &a2);
+				p2.DefineFun(_T("strfun2"), StrFun2);
+
+				// names are added in an order different from their sort order
+				ParserBundleWriter writer;
+				for (int i = 0; i < 100; ++i)
+				{
+					stringstream_type ssName, ssExpr;
+					ssName << _T("e") << (i * 37) % 100;
+					ssExpr << _T("a*") << i << _T("+strfun2(\"") << i << _T("\", b)");
+					p1.SetExpr(ssExpr.str());
+					iStat += (writer.Add(ssName.str(), p1) == i) ? 0 : 1;
+				}
+
+				try
+				{
+					writer.Add(_T("e0"), p1);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecNAME_CONFLICT) ? 0 : 1;
+				}
+
+				writer.Write(szFile);
+				iStat += (writer.GetSize() == 100) ? 0 : 1;
+
+				ParserBundle bundle(szFile);
+				iStat += (bundle.IsOpen() && bundle.GetSize() == 100) ? 0 : 1;
+				for (int i = 0; i < 100; ++i)
+				{
+					stringstream_type ssName;
+					ssName << _T("e") << (i * 37) % 100;
+					iStat += (bundle.Find(ssName.str()) == i && bundle.GetName(i) == ssName.str()) ? 0 : 1;
+
+					a2 = 2;
+					b2 = 3;
+					bundle.Load(ssName.str(), p2);
+					iStat += (p2.Eval() == 2 * i + i + 3) ? 0 : 1;
+				}
+
+				iStat += (bundle.Find(_T("e100")) == -1 && bundle.Find(_T("")) == -1) ? 0 : 1;
+				try
+				{
+					bundle.Load(_T("unknown"), p2);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_NAME) ? 0 : 1;
+				}
+
+				bundle.Close();
+				iStat += (!bundle.IsOpen() && bundle.GetSize() == 0) ? 0 : 1;
+
+				// a file which is no bundle
+				std::ofstream(szFile, std::ios::out | std::ios::binary) << "no bundle, just some text";
+				try
+				{
+					bundle.Open(szFile);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_BYTECODE && !bundle.IsOpen()) ? 0 : 1;
+				}
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			std::remove(szFile);
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestBatchCompile()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing batch compilation...");
+
+			try
+			{
+				value_type a = 2, b = 3;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.DefineFun(_T("strfun2"), StrFun2);
+
+				std::vector<string_type> vExpr;
+				for (int i = 0; i < 500; ++i)
+				{
+					stringstream_type ss;
+					switch (i % 5)
+					{
+					case 0: ss << _T("a*") << i << _T("+b"); break;
+					case 1: ss << _T("strfun2(\"") << i << _T("\", a), b"); break;
+					case 2: ss << _T("a>") << i << _T(" ? sin(b) : ") << i; break;
+					case 3: ss << _T("1+") << i << _T("*"); break;
+					case 4: ss << _T("undefined_var*") << i; break;
+					}
+
+					vExpr.push_back(ss.str());
+				}
+
+				std::vector<Parser::SBatchResult> vResult = p.CompileBatch(vExpr);
+				iStat += (vResult.size() == vExpr.size()) ? 0 : 1;
+
+				Parser p2;
+				p2.DefineVar(_T("a"), &a);
+				p2.DefineVar(_T("b"), &b);
+				p2.DefineFun(_T("strfun2"), StrFun2);
+				for (std::size_t i = 0; i < vResult.size(); ++i)
+				{
+					switch (i % 5)
+					{
+					case 3:
+						iStat += (!vResult[i].bOk && vResult[i].Error.GetCode() == ecUNEXPECTED_EOF) ? 0 : 1;
+						break;
+
+					case 4:
+						iStat += (!vResult[i].bOk && vResult[i].Error.GetCode() == ecUNASSIGNABLE_TOKEN) ? 0 : 1;
+						break;
+
+					default:
+						{
+							iStat += vResult[i].bOk ? 0 : 1;
+							p.SetExpr(vExpr[i]);
+							p2.LoadByteCode(vResult[i].sByteCode.data(), vResult[i].sByteCode.size());
+
+							int n1 = 0, n2 = 0;
+							value_type* v1 = p.Eval(n1);
+							std::vector<value_type> vRes1(v1, v1 + n1);
+							value_type* v2 = p2.Eval(n2);
+							iStat += (n1 == n2 && std::equal(vRes1.begin(), vRes1.end(), v2)) ? 0 : 1;
+						}
+						break;
+					}
+				}
+
+				// the symbol table is frozen, a variable factory does not create variables
+				value_type vVarBuf[4] = { 0 };
+				p.SetVarFactory(VarFactory, vVarBuf);
+				vResult = p.CompileBatch(std::vector<string_type>(1, _T("new_var*2")));
+				iStat += (vResult.size() == 1 && !vResult[0].bOk && vVarBuf[0] == 0) ? 0 : 1;
+
+				iStat += p.CompileBatch(std::vector<string_type>()).empty() ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestDependencyTracking()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing symbol dependency tracking...");
+
+			try
+			{
+				value_type a = 2, b = 3, c = 4;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.DefineConst(_T("k"), 10);
+				p.EnableExprCache(10);
+
+				p.SetExpr(_T("a*k + sin(b)"));
+				p.Eval();
+				p.SetExpr(_T("b+1"));
+				p.Eval();
+				p.SetExpr(_T("a*k + sin(b)"));
+				p.Eval();
+
+				// defining unrelated symbols keeps the bytecode and the cache entries
+				p.DefineVar(_T("c"), &c);
+				p.DefineConst(_T("k2"), 1);
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.RemoveVar(_T("c"));
+				iStat += (p.GetByteCode().GetSize() > 0) ? 0 : 1;
+				iStat += (p.GetExprCacheStats().nEntries == 2) ? 0 : 1;
+				iStat += (p.Eval() == 20 + std::sin(b)) ? 0 : 1;
+
+				// redefining a used variable resets the parser and drops only the dependent entries
+				p.DefineVar(_T("a"), &c);
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+				iStat += (p.GetExprCacheStats().nEntries == 1) ? 0 : 1;
+				iStat += (p.Eval() == 40 + std::sin(b)) ? 0 : 1;
+
+				// redefining a used function
+				p.DefineFun(_T("sin"), f1of1);
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+				iStat += (p.Eval() == 40 + b) ? 0 : 1;
+
+				// clearing the functions only affects expressions calling functions
+				p.SetExpr(_T("b+1"));
+				iStat += (p.GetByteCode().GetSize() > 0) ? 0 : 1;
+				p.ClearFun();
+				iStat += (p.GetByteCode().GetSize() > 0 && p.Eval() == 4) ? 0 : 1;
+				p.ClearVar();
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+
+				// operators may change the tokenization of any expression
+				p.DefineVar(_T("b"), &b);
+				p.SetExpr(_T("b+1"));
+				p.Eval();
+				p.DefineOprt(_T("add"), add, 0);
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+				p.SetExpr(_T("b+1"));
+				iStat += (p.GetByteCode().GetSize() == 0) ? 0 : 1;
+
+				// the dependencies of loaded bytecode are unknown
+				std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+				p.SaveByteCode(ss);
+				Parser p2;
+				p2.DefineVar(_T("b"), &b);
+				p2.DefineOprt(_T("add"), add, 0);
+				p2.LoadByteCode(ss);
+				iStat += (p2.GetByteCode().GetSize() > 0) ? 0 : 1;
+				p2.DefineConst(_T("k"), 1);
+				iStat += (p2.GetByteCode().GetSize() == 0 && p2.Eval() == 4) ? 0 : 1;
+
+				// numeric literals and repeated names are not recorded as dependencies
+				Parser p3, p4;
+				p3.DefineVar(_T("a"), &a);
+				p4.DefineVar(_T("a"), &a);
+				p3.SetExpr(_T("a"));
+				p4.SetExpr(_T("a + a*1 + a*2 + a*3 + a*4 + a*5 + a*6 + a*7"));
+				p3.Eval();
+				p4.Eval();
+				iStat += (p3.GetMemoryUsage().nStrings == p4.GetMemoryUsage().nStrings) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestReplaceRange()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing incremental expression editing...");
+
+			value_type a = 2, b = 3;
+
+			// Compare the result of an edited expression with a parser compiling the edited string from scratch
+			auto checkEdit = [&](Parser& p, std::size_t iPos, std::size_t iLen, const string_type& sText)
+			{
+				string_type sExpr = p.GetExpr();
+				sExpr = sExpr.substr(0, sExpr.length() - 1).replace(iPos, iLen, sText);
+
+				Parser ref;
+				ref.DefineVar(_T("a"), &a);
+				ref.DefineVar(_T("b"), &b);
+				ref.DefineFun(_T("strfun2"), StrFun2);
+				ref.SetExpr(sExpr);
+
+				value_type fRef = 0, fVal = 0;
+				int iRefErr = -1, iErr = -1, iRefPos = -1, iPosErr = -1;
+				try
+				{
+					fRef = ref.Eval();
+				}
+				catch (ParserError& e)
+				{
+					iRefErr = e.GetCode();
+					iRefPos = e.GetPos();
+				}
+
+				p.ReplaceRange(iPos, iLen, sText);
+				try
+				{
+					fVal = p.Eval();
+				}
+				catch (ParserError& e)
+				{
+					iErr = e.GetCode();
+					iPosErr = e.GetPos();
+				}
+
+				return (iErr == iRefErr && iPosErr == iRefPos && fVal == fRef && p.GetExpr() == ref.GetExpr()) ? 0 : 1;
+			};
+
+			try
+			{
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.DefineFun(_T("strfun2"), StrFun2);
+
+				// typing an expression character by character passes through invalid intermediate states
+				string_type sTyped = _T("a*sin(b) + strfun2(\"10\", a) - (a+b)^2");
+				p.SetExpr(_T(""));
+				for (std::size_t i = 0; i < sTyped.length(); ++i)
+					iStat += checkEdit(p, i, 0, sTyped.substr(i, 1));
+
+				// edits at the start, in the middle and at the end, joining and splitting tokens
+				iStat += checkEdit(p, 0, 1, _T("b"));
+				iStat += checkEdit(p, 0, 0, _T("a"));
+				iStat += checkEdit(p, 0, 1, _T(""));
+				iStat += checkEdit(p, 2, 3, _T("cos"));
+				iStat += checkEdit(p, 2, 3, _T("co s"));
+				iStat += checkEdit(p, 2, 4, _T("cos"));
+				iStat += checkEdit(p, 21, 2, _T("100"));
+				iStat += checkEdit(p, 6, 2, _T(")"));
+				iStat += checkEdit(p, 6, 1, _T("b)"));
+				iStat += checkEdit(p, p.GetExpr().length() - 2, 1, _T("3*a"));
+				iStat += checkEdit(p, p.GetExpr().length() - 1, 0, _T(" + 1"));
+				iStat += checkEdit(p, 0, p.GetExpr().length() - 1, _T("a<b ? 1 : 2"));
+				iStat += checkEdit(p, 4, 1, _T("?"));
+				iStat += checkEdit(p, 4, 1, _T("?"));
+
+				// symbol changes discard the recorded tokens
+				p.DefineConst(_T("k"), 1);
+				iStat += checkEdit(p, 0, 0, _T(" "));
+
+				// the replaced range must lie within the expression
+				try
+				{
+					p.SetExpr(_T("1+2"));
+					p.ReplaceRange(2, 2, _T("3"));
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecEDIT_OUT_OF_RANGE) ? 0 : 1;
+				}
+
+				// an argument separator equal to the decimal separator is rejected like in SetExpr
+				try
+				{
+					p.SetExpr(_T("1+2"));
+					p.SetArgSep('.');
+					p.ReplaceRange(0, 1, _T("3"));
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecLOCALE) ? 0 : 1;
+				}
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestSharedSymbols()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing shared symbol tables...");
+
+			try
+			{
+				// parsers share the tables of the built in symbols
+				Parser p1, p2;
+				iStat += (&p1.GetFunDef() == &p2.GetFunDef()) ? 0 : 1;
+				iStat += (&p1.GetConst() == &p2.GetConst()) ? 0 : 1;
+
+				// a definition copies the table of the modified parser only
+				std::size_t nFun = p2.GetFunDef().size();
+				p1.DefineFun(_T("f1of1"), f1of1);
+				iStat += (&p1.GetFunDef() != &p2.GetFunDef()) ? 0 : 1;
+				iStat += (p1.GetFunDef().size() == nFun + 1 && p2.GetFunDef().size() == nFun) ? 0 : 1;
+				iStat += (&p1.GetConst() == &p2.GetConst()) ? 0 : 1;
+
+				p2.DefineConst(_T("const1"), 1);
+				iStat += (p1.GetConst().count(_T("const1")) == 0) ? 0 : 1;
+
+				// copies share the user definitions until one of them changes
+				Parser p3(p1);
+				iStat += (&p1.GetFunDef() == &p3.GetFunDef()) ? 0 : 1;
+				p3.ClearFun();
+				iStat += (p3.GetFunDef().empty() && p1.GetFunDef().size() == nFun + 1) ? 0 : 1;
+
+				p1.SetExpr(_T("f1of1(sin(_pi/2))"));
+				iStat += (p1.Eval() == 1) ? 0 : 1;
+
+				p3.SetExpr(_T("sin(1)"));
+				try
+				{
+					p3.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+				}
+
+				// removing operators
+				p2.ClearInfixOprt();
+				p2.SetExpr(_T("-1"));
+				try
+				{
+					p2.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+				}
+
+				Parser p4;
+				p4.SetExpr(_T("-const1"));
+				p4.DefineConst(_T("const1"), 2);
+				iStat += (p4.Eval() == -2) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestClone()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing parser clones...");
+
+			try
+			{
+				value_type a = 2, b = 3, c = 10;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.DefineStrConst(_T("str"), _T("100"));
+				p.SetExpr(_T("a*b + strfun2(str, b)"));
+				p.DefineFun(_T("strfun2"), StrFun2);
+
+				// the expression is compiled once, the clones share its bytecode
+				std::unique_ptr<ParserBase> pClone1 = p.Clone();
+				std::unique_ptr<ParserBase> pClone2 = pClone1->Clone();
+				iStat += (&p.GetByteCode() == &pClone1->GetByteCode() && &p.GetByteCode() == &pClone2->GetByteCode()) ? 0 : 1;
+				iStat += (pClone1->Eval() == 109 && pClone2->Eval() == 109) ? 0 : 1;
+
+				// concurrent evaluation, each thread with its own clone
+				std::vector<std::unique_ptr<ParserBase>> vClone;
+				for (int i = 0; i < 4; ++i)
+					vClone.push_back(p.Clone());
+
+				std::vector<value_type> vSum(vClone.size(), 0);
+				std::vector<std::thread> vThread;
+				for (std::size_t i = 0; i < vClone.size(); ++i)
+				{
+					vThread.emplace_back([&vClone, &vSum, i]()
+						{
+							for (int k = 0; k < 1000; ++k)
+								vSum[i] += vClone[i]->Eval();
+						});
+				}
+
+				for (auto& thread : vThread)
+					thread.join();
+
+				for (value_type fSum : vSum)
+					iStat += (fSum == 109000) ? 0 : 1;
+
+				// redefining a variable in a clone compiles new bytecode for that clone only
+				pClone1->DefineVar(_T("a"), &c);
+				iStat += (pClone1->Eval() == 133 && p.Eval() == 109 && pClone2->Eval() == 109) ? 0 : 1;
+				iStat += (&p.GetByteCode() != &pClone1->GetByteCode()) ? 0 : 1;
+
+				// a new expression in the parser does not affect the clones
+				p.SetExpr(_T("a+b"));
+				iStat += (p.Eval() == 5 && pClone2->Eval() == 109) ? 0 : 1;
+
+				// the symbol tables are shared until a clone defines a symbol
+				pClone1->DefineVar(_T("d"), &c);
+				pClone2->DefineStrConst(_T("str2"), _T("5"));
+				pClone2->SetExpr(_T("strfun2(str2, d)"));
+				try
+				{
+					pClone2->Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+					// failure is expected, d is only defined in pClone1
+				}
+
+				pClone2->SetExpr(_T("strfun2(str2, b) + strfun2(str, b)"));
+				iStat += (pClone2->Eval() == 111 && p.GetVar().count(_T("d")) == 0) ? 0 : 1;
+				p.SetExpr(_T("strfun2(str2, b)"));
+				try
+				{
+					p.Eval();
+					iStat += 1;
+				}
+				catch (ParserError&)
+				{
+					// failure is expected...
+				}
+
+				// a clone owns only its stack and small per-instance state, not the variables
+				{
+					std::vector<value_type> vVar(1000);
+					Parser p3;
+					for (std::size_t i = 0; i < vVar.size(); ++i)
+					{
+						stringstream_type ss;
+						ss << _T("v") << i;
+						p3.DefineVar(ss.str(), &vVar[i]);
+					}
+
+					p3.SetExpr(_T("v1 + v999"));
+					std::unique_ptr<ParserBase> pClone3 = p3.Clone();
+					ParserBase::SMemoryUsage u = pClone3->GetMemoryUsage();
+					iStat += (u.nSharedSymbols > 10 * u.nTotal && u.nTokenReader < 1024) ? 0 : 1;
+				}
+
+				// a syntax error is reported by Clone
+				p.SetExpr(_T("a+"));
+				try
+				{
+					p.Clone();
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecUNEXPECTED_EOF) ? 0 : 1;
+				}
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
+
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestMemoryResource()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing memory resources...");
+
+			// forwards to the default resource and keeps track of the memory in use
+			class CountingResource final : public ParserMemoryResource
+			{
+			public:
+				void* Allocate(std::size_t a_nBytes, std::size_t a_nAlign) override
+				{
+					++nAlloc;
+					nInUse += a_nBytes;
+					return GetDefault()->Allocate(a_nBytes, a_nAlign);
+				}
+
+				void Deallocate(void* a_pMem, std::size_t a_nBytes, std::size_t a_nAlign) noexcept override
+				{
+					nInUse -= a_nBytes;
+					GetDefault()->Deallocate(a_pMem, a_nBytes, a_nAlign);
+				}
+
+				int nAlloc = 0;
+				std::size_t nInUse = 0;
+			};
+
+			try
+			{
+				value_type a = 2, b = 3;
+				CountingResource counter;
+				{
+					Parser p;
+					p.DefineVar(_T("a"), &a);
+					p.DefineVar(_T("b"), &b);
+					p.DefineFun(_T("strfun2"), StrFun2);
+					p.SetExpr(_T("a*b"));
+					p.Eval();
+
+					// the current expression is compiled again using the new resource
+					p.SetMemoryResource(&counter);
+					iStat += (p.GetMemoryResource() == &counter) ? 0 : 1;
+					iStat += (p.Eval() == 6 && counter.nAlloc > 0) ? 0 : 1;
+
+					p.SetExpr(_T("strfun2(\"100\", a) + (a<b ? sum(a,b,1) : 0)"));
+					iStat += (p.Eval() == 108) ? 0 : 1;
+
+					// copies and clones do not allocate from the resource
+					int nAlloc = counter.nAlloc;
+					Parser p2(p);
+					iStat += (p2.GetMemoryResource() == ParserMemoryResource::GetDefault()) ? 0 : 1;
+					iStat += (p2.Eval() == 108 && p.Clone()->Eval() == 108 && counter.nAlloc == nAlloc) ? 0 : 1;
+
+					p.SetMemoryResource(nullptr);
+					iStat += (p.GetMemoryResource() == ParserMemoryResource::GetDefault() && p.Eval() == 108) ? 0 : 1;
+				}
+				iStat += (counter.nInUse == 0) ? 0 : 1;
+
+				// an arena takes its blocks from the upstream resource and returns them in one go
+				ParserArenaResource arena(256, &counter);
+				{
+					Parser p;
+					p.DefineVar(_T("a"), &a);
+					p.DefineVar(_T("b"), &b);
+					p.SetMemoryResource(&arena);
+					for (int i = 0; i < 100; ++i)
+					{
+						stringstream_type ss;
+						ss << _T("a*b + sin(a) - ") << i;
+						p.SetExpr(ss.str());
+						iStat += (p.Eval() == a * b + std::sin(a) - i) ? 0 : 1;
+					}
+
+					iStat += (arena.GetBytesAllocated() > 0 && arena.GetBytesReserved() >= arena.GetBytesAllocated()) ? 0 : 1;
+				}
 
-			unsigned iVal(0);
+				iStat += (counter.nInUse == arena.GetBytesReserved()) ? 0 : 1;
+				arena.Release();
+				iStat += (counter.nInUse == 0 && arena.GetBytesAllocated() == 0) ? 0 : 1;
 
-			// New code based on streams for UNICODE compliance:
-			stringstream_type::pos_type nPos(0);
-			stringstream_type ss(a_szExpr + 2);
-			ss >> std::hex >> iVal;
-			nPos = ss.tellg();
+				// allocations honour the requested alignment
+				void* p1 = arena.Allocate(3, 1);
+				void* p2 = arena.Allocate(64, 64);
+				void* p3 = arena.Allocate(10000, 8);
+				iStat += (p1 != nullptr && ((std::uintptr_t)p2 % 64) == 0 && ((std::uintptr_t)p3 % 8) == 0) ? 0 : 1;
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
 
-			if (nPos == (stringstream_type::pos_type)0)
-				return 1;
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
 
-			*a_iPos += (int)(2 + nPos);
-			*a_fVal = (value_type)iVal;
-			return 1;
+			return iStat;
 		}
 
 		//---------------------------------------------------------------------------------------------
-		int ParserTester::TestInterface()
+		int ParserTester::TestStringPool()
 		{
 			int iStat = 0;
-			mu::console() << _T("testing member functions...");
-
-			// Test RemoveVar
-			value_type afVal[3] = { 1,2,3 };
-			Parser p;
+			mu::console() << _T("testing the string pool...");
 
 			try
 			{
-				p.DefineVar(_T("a"), &afVal[0]);
-				p.DefineVar(_T("b"), &afVal[1]);
-				p.DefineVar(_T("c"), &afVal[2]);
-				p.SetExpr(_T("a+b+c"));
-				p.Eval();
+				value_type a = 2;
+				std::vector<const char_type*> vAddr;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineFun(_T("hashfun2"), StrHashFun2);
+				p.DefineFunUserData(_T("hashfun1"), StrHashFunUd1, &vAddr);
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.DefineStrConst(_T("pair"), _T("EURUSD"));
+
+				// equal strings are stored once and passed to the callbacks at the same address
+				p.SetExpr(_T("hashfun1(\"EURUSD\") + hashfun1(pair) + hashfun1(\"abc\") + hashfun1(\"\")"));
+				iStat += (p.Eval() == 15) ? 0 : 1;
+				iStat += (vAddr.size() == 4 && vAddr[0] == vAddr[1] && vAddr[0] != vAddr[2]) ? 0 : 1;
+
+				// the short bytecode and the bulk mode
+				p.SetExpr(_T("hashfun1(\"abc\")"));
+				iStat += (p.Eval() == 3) ? 0 : 1;
+
+				value_type vRes[3];
+				p.SetExpr(_T("hashfun2(\"EURUSD\", 1) + strfun2(\"100\", 1)"));
+				p.Eval(vRes, 3);
+				iStat += (vRes[0] == 108 && vRes[2] == 108) ? 0 : 1;
+
+				p.SetExpr(_T("hashfun2(\"EURUSD\", a) + strfun2(\"100\", a)"));
+
+				// the signature is part of saved bytecode
+				std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+				p.SaveByteCode(ss);
+				std::string sData = ss.str();
+
+				Parser p2;
+				p2.DefineVar(_T("a"), &a);
+				p2.DefineFun(_T("hashfun2"), StrHashFun2);
+				p2.DefineFun(_T("strfun2"), StrFun2);
+				p2.LoadByteCode(sData.data(), sData.size());
+				iStat += (p2.Eval() == 110) ? 0 : 1;
+
+				try
+				{
+					p2.DefineFun(_T("hashfun2"), StrFun2);
+					p2.LoadByteCode(sData.data(), sData.size());
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecBYTECODE_SYMBOL_MISMATCH) ? 0 : 1;
+				}
+
+				// programs combining several expressions
+				std::vector<string_type> vExpr;
+				vExpr.push_back(_T("hashfun2(\"ab\", a)"));
+				vExpr.push_back(_T("hashfun2(\"EURUSD\", 1), strfun2(\"100\", a)"));
+
+				ParserProgram prog;
+				prog.Compile(p, vExpr);
+				value_type vProgRes[3];
+				prog.Eval(vProgRes);
+				iStat += (vProgRes[0] == 4 && vProgRes[1] == 7 && vProgRes[2] == 102) ? 0 : 1;
+
+				// interning looks strings up in the hash index of the pool, also after it has grown
+				ParserStringPool pool;
+				for (int i = 0; i < 1000; ++i)
+				{
+					stringstream_type ss;
+					ss << i;
+					iStat += (pool.Intern(ss.str()) == i) ? 0 : 1;
+				}
+
+				iStat += (pool.Add(_T("7")) == 1000 && pool.Intern(_T("7")) == 7) ? 0 : 1;
+				iStat += (pool.Intern(_T("999")) == 999 && pool.size() == 1001) ? 0 : 1;
+
+				ParserStringPool pool2;
+				pool2.Intern(_T("x"));
+				pool2.Append(pool);
+				iStat += (pool2.Intern(_T("0")) == 1 && pool2.Intern(_T("7")) == 8 && pool2.size() == 1002) ? 0 : 1;
+
+				pool2.clear();
+				iStat += (pool2.Intern(_T("7")) == 0 && pool2.size() == 1) ? 0 : 1;
 			}
 			catch (...)
 			{
-				iStat += 1;  // this is not supposed to happen 
+				iStat += 1;
 			}
 
+			if (iStat == 0)
+				mu::console() << _T("passed") << endl;
+			else
+				mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << endl;
+
+			return iStat;
+		}
+
+		//---------------------------------------------------------------------------------------------
+		int ParserTester::TestMemoryUsage()
+		{
+			int iStat = 0;
+			mu::console() << _T("testing memory usage reports...");
+
 			try
 			{
-				p.RemoveVar(_T("c"));
+				value_type a = 1, b = 2;
+				Parser p;
+				p.DefineVar(_T("a"), &a);
+				p.DefineVar(_T("b"), &b);
+				p.SetExpr(_T("a*b+1"));
 				p.Eval();
-				iStat += 1;  // not supposed to reach this, nonexisting variable "c" deleted...
+
+				ParserBase::SMemoryUsage u1 = p.GetMemoryUsage();
+				iStat += (u1.nSymbols > 0 && u1.nTokenReader > 0 && u1.nByteCode > 0 && u1.nStack > 0) ? 0 : 1;
+				iStat += (u1.nSharedByteCode == 0 && u1.nExprCache == 0) ? 0 : 1;
+				iStat += (u1.nCompiler > 0) ? 0 : 1;
+				iStat += (u1.nTotal >= sizeof(ParserBase) + u1.nSymbols + u1.nTokenReader + u1.nCompiler + u1.nStrings + u1.nByteCode + u1.nStack) ? 0 : 1;
+
+				// the built in functions are shared with other parsers until a function is defined
+				iStat += (u1.nSharedSymbols > 0) ? 0 : 1;
+				p.DefineFun(_T("strfun1"), StrFun1);
+				ParserBase::SMemoryUsage u2 = p.GetMemoryUsage();
+				iStat += (u2.nSharedSymbols < u1.nSharedSymbols && u2.nSymbols > u1.nSymbols) ? 0 : 1;
+
+				// bytecode grows by whole tokens, strings are reported with the string buffer
+				p.SetExpr(_T("a*b+1+strfun1(\"a string argument too long for the string object\")"));
+				p.Eval();
+				ParserBase::SMemoryUsage u3 = p.GetMemoryUsage();
+				iStat += (u3.nByteCode > u2.nByteCode && (u3.nByteCode - u2.nByteCode) % sizeof(SToken) == 0) ? 0 : 1;
+				iStat += (u3.nStrings > u2.nStrings) ? 0 : 1;
+
+				// the compiler keeps the buffers of a long formula for the next compilation
+				{
+					Parser p2;
+					p2.DefineVar(_T("a"), &a);
+					string_type sExpr = _T("a");
+					for (int i = 0; i < 200; ++i)
+						sExpr += _T("+(a*(a+1))");
+
+					p2.SetExpr(sExpr);
+					p2.Eval();
+					ParserBase::SMemoryUsage uLong = p2.GetMemoryUsage();
+					p2.SetExpr(_T("a"));
+					p2.Eval();
+					ParserBase::SMemoryUsage uShort = p2.GetMemoryUsage();
+					iStat += (uLong.nCompiler > 200 * sizeof(int) && uShort.nCompiler == uLong.nCompiler) ? 0 : 1;
+					iStat += (uShort.nTotal >= uShort.nCompiler + uShort.nSymbols) ? 0 : 1;
+				}
+
+				// clones share the bytecode until one of them compiles
+				std::unique_ptr<ParserBase> pClone = p.Clone();
+				ParserBase::SMemoryUsage u4 = pClone->GetMemoryUsage();
+				iStat += (u4.nByteCode == 0 && u4.nSharedByteCode > u3.nByteCode && u4.nStrings < u3.nStrings) ? 0 : 1;
+
+				pClone->SetExpr(_T("a"));
+				pClone->Eval();
+				iStat += (p.GetMemoryUsage().nSharedByteCode == 0 && pClone->GetMemoryUsage().nByteCode > 0) ? 0 : 1;
+
+				p.EnableExprCache(10);
+				p.SetExpr(_T("a+b"));
+				p.Eval();
+				iStat += (p.GetMemoryUsage().nExprCache > 0) ? 0 : 1;
 			}
 			catch (...)
 			{
-				// failure is expected...
+				iStat += 1;
 			}
 
 			if (iStat == 0)
@@ -132,50 +1680,116 @@ namespace mu
 		}
 
 		//---------------------------------------------------------------------------------------------
-		int ParserTester::TestOptimizer()
+		int ParserTester::TestFloatEngine()
 		{
 			int iStat = 0;
-			mu::console() << _T("testing optimizer...");
+			mu::console() << _T("testing the float engine...");
 
-			// Test RemoveVar
-			Parser p;
 			try
 			{
-				// test for #93 (https://github.com/beltoforion/muparser/issues/93)
-				// expected bytecode is:
-				// VAL, FUN
+				// more rows than a single block of the engine
+				const int nRows = 600;
+				std::vector<value_type> vA(nRows), vB(nRows), vRes(3 * nRows);
+				std::vector<float> vfA(nRows), vfB(nRows), vfRes(3 * nRows);
+				for (int i = 0; i < nRows; ++i)
 				{
-					p.DefineFun(_T("unoptimizable"), f1of1, false);
-					p.SetExpr(_T("unoptimizable(1)"));
-					p.Eval();
+					vfA[i] = (float)(i % 17) - 8.5f;
+					vfB[i] = (float)(i % 5) + 0.25f;
+					vA[i] = vfA[i];
+					vB[i] = vfB[i];
+				}
 
-					auto& bc = p.GetByteCode();
-					const SToken* tok = bc.GetBase();
-					if (bc.GetSize() != 2 && tok[1].Cmd != cmFUNC)
-					{
-						mu::console() << _T("#93 an unoptimizable expression was optimized!") << endl;
-						iStat += 1;
-					}
+				Parser p;
+				p.DefineVar(_T("a"), &vA[0]);
+				p.DefineVar(_T("b"), &vB[0]);
+				p.DefineFun(_T("strfun2"), StrFun2);
+				p.DefineFun(_T("ping"), Ping);
+
+				const char_type* szExpr[] = {
+					_T("a*b+1"),
+					_T("-a + b^2 - a*a*a"),
+					_T("a<b ? sin(a) : cos(b)*2"),
+					_T("sqrt(abs(a)) + exp(-b) + sum(a,b,3)"),
+					_T("a>0 && b>3 || a<-5"),
+					_T("strfun2(\"10\", a) + ping()*b + (a<0 ? (b<2 ? 1 : 2) : 3)")
+				};
+
+				for (const char_type* szFormula : szExpr)
+				{
+					p.SetExpr(szFormula);
+					p.Eval(&vRes[0], nRows);
+
+					ParserFloatEngine fe;
+					fe.Compile(p);
+					fe.DefineVar(_T("a"), &vfA[0]);
+					fe.DefineVar(_T("b"), &vfB[0]);
+					fe.Eval(&vfRes[0], nRows);
+
+					int iErr = 0;
+					for (int i = 0; i < nRows; ++i)
+						iErr += (std::fabs(vfRes[i] - vRes[i]) <= 1e-5 * (1 + std::fabs(vRes[i]))) ? 0 : 1;
+
+					iStat += (iErr == 0) ? 0 : 1;
 				}
 
+				// comma separated expressions, scalar variables
+				float fB = 2;
+				p.SetExpr(_T("a, a*b, a+b"));
+				ParserFloatEngine fe;
+				fe.Compile(p);
+				fe.DefineVar(_T("a"), &vfA[0]);
+				fe.DefineVar(_T("b"), &fB);
+				fe.SetVarStride(_T("b"), 0);
+
+				float* vCol[3] = { &vfRes[0], &vfRes[nRows], &vfRes[2 * nRows] };
+				fe.EvalColumns(vCol, nRows);
+				iStat += (fe.GetNumResults() == 3) ? 0 : 1;
+				iStat += (vCol[0][nRows - 1] == vfA[nRows - 1] && vCol[1][7] == vfA[7] * 2 && vCol[2][9] == vfA[9] + 2) ? 0 : 1;
+
+				// rebinding a variable is seen by the next evaluation
+				fB = 3;
+				fe.DefineVar(_T("b"), &vfB[0]);
+				fe.EvalColumns(vCol, nRows);
+				iStat += (vCol[1][7] == vfA[7] * vfB[7] && vCol[2][nRows - 1] == vfA[nRows - 1] + vfB[nRows - 1]) ? 0 : 1;
+
+				try
 				{
-					p.ClearFun();
-					p.DefineFun(_T("unoptimizable"), f1of1, true);
-					p.SetExpr(_T("unoptimizable(1)"));
-					p.Eval();
+					fe.ClearVar();
+					fe.EvalColumns(vCol, nRows);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_VAR_PTR) ? 0 : 1;
+				}
 
-					auto& bc = p.GetByteCode();
-					const SToken* tok = bc.GetBase();
-					if (bc.GetSize() != 1 && tok[0].Cmd != cmVAL)
-					{
-						mu::console() << _T("#93 optimizer error") << endl;
-						iStat += 1;
-					}
+				// unbound variables and assignments are rejected
+				try
+				{
+					ParserFloatEngine fe2;
+					fe2.Compile(p);
+					fe2.Eval(&vfRes[0], nRows);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecINVALID_VAR_PTR) ? 0 : 1;
+				}
+
+				try
+				{
+					p.SetExpr(_T("a=b"));
+					fe.Compile(p);
+					iStat += 1;
+				}
+				catch (ParserError& e)
+				{
+					iStat += (e.GetCode() == ecUNEXPECTED_OPERATOR) ? 0 : 1;
 				}
 			}
 			catch (...)
 			{
-				iStat += 1;  // this is not supposed to happen 
+				iStat += 1;
 			}
 
 			if (iStat == 0)
@@ -274,6 +1888,288 @@ namespace mu
 			EQN_TEST_BULK("c*(a+b)", 9, 12, 15, 18, true)
 #undef EQN_TEST_BULK
 
+			// strided variables and results (array of structs)
+			{
+				struct SRecord { value_type x, y, res; };
+				SRecord rec[] = { { 1, 10, 0 }, { 2, 20, 0 }, { 3, 30, 0 }, { 4, 40, 0 } };
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("x"), &rec[0].x);
+					p.DefineVar(_T("y"), &rec[0].y);
+					p.SetVarStride(_T("x"), sizeof(SRecord));
+					p.SetVarStride(_T("y"), sizeof(SRecord));
+
+					// exercises cmVARPOW2, cmVARMUL and the merging of identical variables
+					p.SetExpr(_T("x*x + 2*y + y - x"));
+					p.Eval(&rec[0].res, 4, sizeof(SRecord));
+					for (int i = 0; i < 4; ++i)
+						iStat += (rec[i].res == rec[i].x * rec[i].x + 3 * rec[i].y - rec[i].x) ? 0 : 1;
+
+					// assignment to a strided variable
+					p.SetExpr(_T("y = x*2"));
+					p.Eval(&rec[0].res, 4, sizeof(SRecord));
+					for (int i = 0; i < 4; ++i)
+						iStat += (rec[i].y == 2 * rec[i].x && rec[i].res == rec[i].y) ? 0 : 1;
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+
+				try
+				{
+					Parser p;
+					p.SetVarStride(_T("undefined"), sizeof(SRecord));
+					iStat += 1;  // stride of an undefined variable must not be accepted
+				}
+				catch (ParserError&)
+				{
+					// failure is expected...
+				}
+			}
+
+			// broadcast (scalar) parameters mixed with bulk variables
+			{
+				value_type vA[] = { 1, 2, 3, 4 };
+				value_type vRes[] = { 0, 0, 0, 0 };
+				value_type fRate = 0.5, fOffset = 10;
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA);
+					p.DefineVar(_T("rate"), &fRate);
+					p.DefineVar(_T("ofs"), &fOffset);
+					p.SetVarBroadcast(_T("rate"));
+					p.SetVarBroadcast(_T("ofs"));
+
+					p.SetExpr(_T("a*rate + ofs + 2*ofs + rate^2"));
+					p.Eval(vRes, 4);
+					for (int i = 0; i < 4; ++i)
+						iStat += (vRes[i] == vA[i] * fRate + 3 * fOffset + fRate * fRate) ? 0 : 1;
+
+					// switching back to a dense variable
+					value_type vRate[] = { 1, 2, 3, 4 };
+					p.DefineVar(_T("rate"), vRate);
+					p.SetVarBroadcast(_T("rate"), false);
+					p.SetExpr(_T("a*rate"));
+					p.Eval(vRes, 4);
+					for (int i = 0; i < 4; ++i)
+						iStat += (vRes[i] == vA[i] * vRate[i]) ? 0 : 1;
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+			}
+
+			// packed stacks without cache line padding give the same results
+			{
+				value_type vA[] = { 1, 2, 3, 4 }, vB[] = { 4, 3, 2, 1 };
+				value_type vRes1[4] = { 0 }, vRes2[4] = { 0 };
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA);
+					p.DefineVar(_T("b"), vB);
+					p.SetExpr(_T("a<b ? a*(b+1) : sin(a)*b + a^2"));
+					p.Eval(vRes1, 4);
+					p.EnableStackPadding(false);
+					p.Eval(vRes2, 4);
+					iStat += std::equal(vRes1, vRes1 + 4, vRes2) ? 0 : 1;
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+			}
+
+			// NUMA aware bulk mode must produce the same results as the default partitioning
+			{
+#if defined(__linux__)
+				cpu_set_t affinityBefore;
+				CPU_ZERO(&affinityBefore);
+				sched_getaffinity(0, sizeof(affinityBefore), &affinityBefore);
+#endif
+				const int nSize = 1000;
+				value_type* pA = Parser::AllocBulkBuffer(nSize);
+				value_type* pRes = Parser::AllocBulkBuffer(nSize);
+
+				try
+				{
+					for (int i = 0; i < nSize; ++i)
+						pA[i] = i;
+
+					Parser p;
+					p.DefineVar(_T("a"), pA);
+					p.SetExpr(_T("a*2+1"));
+					p.EnableNumaBulk();
+					p.Eval(pRes, nSize);
+
+					for (int i = 0; i < nSize; ++i)
+						iStat += (pRes[i] == 2 * i + 1) ? 0 : 1;
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+
+				Parser::FreeBulkBuffer(pA);
+				Parser::FreeBulkBuffer(pRes);
+
+#if defined(__linux__)
+				// the calling thread must not stay bound to a node
+				cpu_set_t affinityAfter;
+				CPU_ZERO(&affinityAfter);
+				sched_getaffinity(0, sizeof(affinityAfter), &affinityAfter);
+				iStat += CPU_EQUAL(&affinityBefore, &affinityAfter) ? 0 : 1;
+#endif
+
+				// row ranges must cover all rows without gaps
+				int iPrevEnd = 0;
+				for (int i = 0; i < 7; ++i)
+				{
+					int iBegin, iEnd;
+					ParserNumaTopology::GetThreadRange(i, 7, 100, iBegin, iEnd);
+					iStat += (iBegin == iPrevEnd) ? 0 : 1;
+					iPrevEnd = iEnd;
+				}
+				iStat += (iPrevEnd == 100) ? 0 : 1;
+			}
+
+			// all results of comma separated expressions in bulk mode
+			{
+				value_type vA[] = { 1, 2, 3, 4 }, vB[] = { 2, 2, 2, 2 };
+				value_type vRes[3][4];
+				value_type* vCol[] = { vRes[0], vRes[1], vRes[2] };
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA);
+					p.DefineVar(_T("b"), vB);
+					p.SetExpr(_T("a+b, a*b, sin(a)"));
+					p.EvalColumns(vCol, 4);
+
+					iStat += (p.GetNumResults() == 3) ? 0 : 1;
+					for (int i = 0; i < 4; ++i)
+					{
+						iStat += (vRes[0][i] == vA[i] + vB[i]) ? 0 : 1;
+						iStat += (vRes[1][i] == vA[i] * vB[i]) ? 0 : 1;
+						iStat += (vRes[2][i] == std::sin(vA[i])) ? 0 : 1;
+					}
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+			}
+
+			// asynchronous evaluation with several batches in flight
+			{
+				value_type vA1[] = { 1, 2, 3, 4 }, vA2[] = { 5, 6, 7, 8 };
+				value_type vRes1[4] = { 0 }, vRes2[4] = { 0 };
+				value_type fB = 10;
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA1);
+					p.DefineVar(_T("b"), &fB);
+					p.SetVarBroadcast(_T("b"));
+					p.SetExpr(_T("a*a + b"));
+
+					varmap_type vBatch1, vBatch2;
+					vBatch1[_T("a")] = vA1;
+					vBatch2[_T("a")] = vA2;
+
+					std::future<void> f1 = p.EvalAsync(vBatch1, vRes1, 4);
+					std::future<void> f2 = p.EvalAsync(vBatch2, vRes2, 4);
+					f1.get();
+					f2.get();
+
+					for (int i = 0; i < 4; ++i)
+					{
+						iStat += (vRes1[i] == vA1[i] * vA1[i] + fB) ? 0 : 1;
+						iStat += (vRes2[i] == vA2[i] * vA2[i] + fB) ? 0 : 1;
+					}
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA1);
+					p.SetExpr(_T("a"));
+
+					varmap_type vBatch;
+					vBatch[_T("undefined")] = vA2;
+					p.EvalAsync(vBatch, vRes1, 4);
+					iStat += 1;  // input for an undefined variable must be rejected
+				}
+				catch (ParserError&)
+				{
+					// failure is expected...
+				}
+
+				// input columns are dense even if the variable is broadcast
+				try
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA1);
+					p.DefineVar(_T("b"), &fB);
+					p.SetVarBroadcast(_T("b"));
+					p.SetExpr(_T("a*b"));
+
+					varmap_type vBatch;
+					vBatch[_T("b")] = vA2;
+					p.EvalAsync(vBatch, vRes1, 4).get();
+
+					for (int i = 0; i < 4; ++i)
+						iStat += (vRes1[i] == vA1[i] * vA2[i]) ? 0 : 1;
+				}
+				catch (...)
+				{
+					iStat += 1;
+				}
+
+				// bytecode that was not accepted by the compiler must not be executed
+				const char_type* szInvalid[] = { _T("a+b"), _T("a*a+") };
+				for (const char_type* szExpr : szInvalid)
+				{
+					Parser p;
+					p.DefineVar(_T("a"), vA1);
+					p.SetExpr(szExpr);
+
+					try
+					{
+						p.GetUsedVar();
+					}
+					catch (ParserError&)
+					{
+					}
+
+					for (int k = 0; k < 2; ++k)
+					{
+						try
+						{
+							p.EvalAsync(varmap_type(), vRes1, 4).get();
+							iStat += 1;
+						}
+						catch (ParserError& e)
+						{
+							iStat += (e.GetCode() == ecUNASSIGNABLE_TOKEN || e.GetCode() == ecUNEXPECTED_EOF) ? 0 : 1;
+						}
+					}
+				}
+			}
+
 			if (iStat == 0)
 				mu::console() << _T("passed") << endl;
 			else
@@ -414,6 +2310,34 @@ namespace mu
 			iStat += EqnTestInt(_T("c * b == 6 * a"), 1, true);
 			iStat += EqnTestInt(_T("2^2^3"), 256, true);
 
+			// longest match among many user defined operators sharing prefixes
+			try
+			{
+				Parser p;
+				for (char_type c1 = 'a'; c1 <= 'z'; ++c1)
+				{
+					for (char_type c2 = 'a'; c2 <= 'z'; ++c2)
+						p.DefineOprt(string_type(_T("q")) + c1 + c2, add, prADD_SUB);
+				}
+
+				p.DefineOprt(_T("o"), add, prADD_SUB);
+				p.DefineOprt(_T("oo"), Max, prADD_SUB);
+				p.DefineOprt(_T("ooo"), Min, prADD_SUB);
+				p.DefinePostfixOprt(_T("k"), Milli);
+				p.DefinePostfixOprt(_T("kk"), Mega);
+
+				const char_type* szExpr[] = { _T("1 o 2"), _T("1 oo 2"), _T("1ooo2"), _T("1 qzz 2"), _T("2kk"), _T("2k") };
+				value_type fExpected[] = { 3, 2, 1, 3, 2e6, 2e-3 };
+				for (int i = 0; i < 6; ++i)
+				{
+					p.SetExpr(szExpr[i]);
+					iStat += (p.Eval() == fExpected[i]) ? 0 : 1;
+				}
+			}
+			catch (...)
+			{
+				iStat += 1;
+			}
 
 			if (iStat == 0)
 				mu::console() << _T("passed") << endl;
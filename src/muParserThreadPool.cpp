@@ -0,0 +1,112 @@
+/*
+
+	 _____  __ _____________ _______  ______ ___________
+	/     \|  |  \____ \__  \\_  __ \/  ___// __ \_  __ \
+   |  Y Y  \  |  /  |_> > __ \|  | \/\___ \\  ___/|  | \/
+   |__|_|  /____/|   __(____  /__|  /____  >\___  >__|
+		 \/      |__|       \/           \/     \/
+   Copyright (C) 2004 - 2022 Ingo Berg
+
+	Redistribution and use in source and binary forms, with or without modification, are permitted
+	provided that the following conditions are met:
+
+	  * Redistributions of source code must retain the above copyright notice, this list of
+		conditions and the following disclaimer.
+	  * Redistributions in binary form must reproduce the above copyright notice, this list of
+		conditions and the following disclaimer in the documentation and/or other materials provided
+		with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+	OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "muParserThreadPool.h"
+
+#include <algorithm>
+
+/** \file
+	\brief Implementation of the worker pool used for asynchronous evaluation.
+*/
+
+namespace mu
+{
+	//------------------------------------------------------------------------------
+	/** \brief Returns the shared pool.
+
+		The pool has one worker per hardware thread, limited to the maximum number of
+		threads the bulk mode supports.
+	*/
+	ParserThreadPool& ParserThreadPool::Instance()
+	{
+		static ParserThreadPool instance(std::max(1, std::min((int)std::thread::hardware_concurrency(), 16)));
+		return instance;
+	}
+
+	//------------------------------------------------------------------------------
+	ParserThreadPool::ParserThreadPool(int a_nThreads)
+		: m_vThreads(), m_Tasks(), m_Mutex(), m_Cond(), m_bStop(false)
+	{
+		for (int i = 0; i < a_nThreads; ++i)
+			m_vThreads.push_back(std::thread(&ParserThreadPool::WorkerLoop, this, i));
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Finish all queued tasks and join the workers. */
+	ParserThreadPool::~ParserThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bStop = true;
+		}
+
+		m_Cond.notify_all();
+		for (std::size_t i = 0; i < m_vThreads.size(); ++i)
+			m_vThreads[i].join();
+	}
+
+	//------------------------------------------------------------------------------
+	int ParserThreadPool::GetNumThreads() const
+	{
+		return (int)m_vThreads.size();
+	}
+
+	//------------------------------------------------------------------------------
+	/** \brief Queue a task for execution by the next free worker. */
+	void ParserThreadPool::Submit(task_type a_Task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Tasks.push_back(std::move(a_Task));
+		}
+
+		m_Cond.notify_one();
+	}
+
+	//------------------------------------------------------------------------------
+	void ParserThreadPool::WorkerLoop(int a_iWorker)
+	{
+		for (;;)
+		{
+			task_type task;
+
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Cond.wait(lock, [this] { return m_bStop || !m_Tasks.empty(); });
+
+				if (m_Tasks.empty())
+					return;
+
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+
+			task(a_iWorker);
+		}
+	}
+} // namespace mu
@@ -80,6 +80,10 @@ namespace mu
 
 	/** \brief Assign state of a token reader to this token reader.
 
+		Only the formula and the settings are copied. The reading position, the bracket stack, 
+		the last token and the used variables belong to the last compilation of the source 
+		reader, this reader starts at the beginning of the formula.
+
 		\param a_Reader Object from which the state should be copied.
 		\throw nothrow
 	*/
@@ -87,10 +91,7 @@ namespace mu
 	{
 		m_pParser = a_Reader.m_pParser;
 		m_strFormula = a_Reader.m_strFormula;
-		m_iPos = a_Reader.m_iPos;
-		m_iSynFlags = a_Reader.m_iSynFlags;
 
-		m_UsedVar = a_Reader.m_UsedVar;
 		m_pFunDef = a_Reader.m_pFunDef;
 		m_pConstDef = a_Reader.m_pConstDef;
 		m_pVarDef = a_Reader.m_pVarDef;
@@ -102,10 +103,35 @@ namespace mu
 		m_vIdentFun = a_Reader.m_vIdentFun;
 		m_pFactory = a_Reader.m_pFactory;
 		m_pFactoryData = a_Reader.m_pFactoryData;
-		m_bracketStack = a_Reader.m_bracketStack;
 		m_cArgSep = a_Reader.m_cArgSep;
 		m_fZero = a_Reader.m_fZero;
-		m_lastTok = a_Reader.m_lastTok;
+		m_bSymbolIndex = a_Reader.m_bSymbolIndex;
+
+		// The indices reference the maps of the source parser, they are rebuilt on first use
+		m_bSymbolIndexValid = false;
+		m_nSymbolIndexVersion = 0;
+		m_nSymbolIndexLocale = 0;
+		m_FunIdx.Clear();
+		m_ConstIdx.Clear();
+		m_VarIdx.Clear();
+		m_StrVarIdx.Clear();
+
+		m_bOprtTrieValid = false;
+		m_nOprtTrieVersion = 0;
+		m_nOprtTrieLocale = 0;
+		m_OprtTrie.Clear();
+		m_InfixOprtTrie.Clear();
+		m_PostOprtTrie.Clear();
+
+		m_szExtractCharSet = nullptr;
+
+		// Recorded tokens reference the callbacks of the source parser, they are read again
+		m_bTokenLog = a_Reader.m_bTokenLog;
+		ClearTokenLog();
+		m_iExtractPos = 0;
+		m_iExtractEnd = 0;
+
+		ReInit();
 	}
 
 
@@ -138,16 +164,41 @@ namespace mu
 		, m_bracketStack()
 		, m_lastTok()
 		, m_cArgSep(',')
+		, m_bSymbolIndex(false)
+		, m_bSymbolIndexValid(false)
+		, m_nSymbolIndexVersion(0)
+		, m_nSymbolIndexLocale(0)
+		, m_FunIdx()
+		, m_ConstIdx()
+		, m_VarIdx()
+		, m_StrVarIdx()
+		, m_bOprtTrieValid(false)
+		, m_nOprtTrieVersion(0)
+		, m_nOprtTrieLocale(0)
+		, m_OprtTrie()
+		, m_InfixOprtTrie()
+		, m_PostOprtTrie()
+		, m_szExtractCharSet(nullptr)
+		, m_iExtractPos(0)
+		, m_iExtractEnd(0)
+		, m_bTokenLog(false)
+		, m_nTokenLogVersion(0)
+		, m_nTokenLogLocale(0)
+		, m_vTokenLog()
+		, m_vTokenTail()
+		, m_nTokenLogPos(0)
+		, m_nTokenTailPos(0)
 	{
 		MUP_ASSERT(m_pParser != nullptr);
 		SetParent(m_pParser);
 	}
 
 
-	/** \brief Create instance of a ParserTokenReader identical with this
+	/** \brief Create a ParserTokenReader with the formula and the settings of this one
 				and return its pointer.
 
 		This is a factory method the calling function must take care of the object destruction.
+		The new reader does not share any state of a compilation with this one, see Assign.
 
 		\return A new ParserTokenReader object.
 		\throw nothrow
@@ -167,7 +218,11 @@ namespace mu
 	}
 
 
-	void ParserTokenReader::AddValIdent(identfun_type a_pCallback)
+	/** \brief Add a value recognition callback.
+		\param a_pCallback The callback.
+		\param a_szFirstChars If not null the callback is only called at positions starting with one of these characters.
+	*/
+	void ParserTokenReader::AddValIdent(identfun_type a_pCallback, const char_type* a_szFirstChars)
 	{
 		// Use push_front is used to give user defined callbacks a higher priority than
 		// the built in ones. Otherwise reading hex numbers would not work
@@ -175,7 +230,10 @@ namespace mu
 		// the rest impossible.
 		// reference:
 		// http://sourceforge.net/projects/muparser/forums/forum/462843/topic/4824956
-		m_vIdentFun.push_front(a_pCallback);
+		SValIdent ident;
+		ident.pFun = a_pCallback;
+		ident.sFirstChars = (a_szFirstChars != nullptr) ? a_szFirstChars : _T("");
+		m_vIdentFun.push_front(ident);
 	}
 
 
@@ -223,10 +281,111 @@ namespace mu
 	void ParserTokenReader::SetFormula(const string_type& a_strFormula)
 	{
 		m_strFormula = a_strFormula;
+		ClearTokenLog();
+		ReInit();
+	}
+
+
+	/** \brief Replace a part of the formula and keep the tokens not affected by the edit.
+		\param a_iPos Position of the first replaced character.
+		\param a_iLen Number of replaced characters.
+		\param a_sText The replacement.
+		\pre [assert] a_iPos + a_iLen must not exceed the length of the formula.
+
+		Enables recording of the tokens read. The recorded tokens in front of the edit are
+		replayed by ReadNextToken without reading them again. The tokens behind the edit are
+		kept as well and reused as soon as the reader reaches one of them in the state it
+		had when the token was read originally. Only the text in between is read again.
+	*/
+	void ParserTokenReader::ReplaceFormula(std::size_t a_iPos, std::size_t a_iLen, const string_type& a_sText)
+	{
+		MUP_ASSERT(a_iPos + a_iLen <= m_strFormula.length());
+
+		if (!m_bTokenLog || !IsTokenLogValid())
+		{
+			m_bTokenLog = true;
+			ClearTokenLog();
+		}
+		else
+		{
+			const int iEditEnd = (int)(a_iPos + a_iLen);
+			const int iShift = (int)a_sText.length() - (int)a_iLen;
+
+			// The tokens behind the edit are taken from a complete recording. If the last
+			// formula could not be read to its end the tail of the previous edit is used.
+			bool bComplete = !m_vTokenLog.empty() && m_vTokenLog.back().Tok.GetCode() == cmEND;
+			const tokenlog_type& vSource = bComplete ? m_vTokenLog : m_vTokenTail;
+
+			tokenlog_type vTail(m_vTokenTail.get_allocator());
+			for (const auto& entry : vSource)
+			{
+				if (entry.iBegin < iEditEnd)
+					continue;
+
+				vTail.push_back(entry);
+				vTail.back().iBegin += iShift;
+				vTail.back().iEnd += iShift;
+			}
+
+			// The token ending at the edit may be extended by it and the token in front of it may
+			// have looked ahead into the edited text, both are read again.
+			std::size_t nKeep = 0;
+			while (nKeep < m_vTokenLog.size() && m_vTokenLog[nKeep].iEnd < (int)a_iPos)
+				++nKeep;
+
+			if (nKeep > 0)
+				--nKeep;
+
+			m_vTokenLog.erase(m_vTokenLog.begin() + nKeep, m_vTokenLog.end());
+			m_vTokenTail.swap(vTail);
+		}
+
+		m_strFormula.replace(a_iPos, a_iLen, a_sText);
 		ReInit();
 	}
 
 
+	/** \brief Discard all recorded tokens. */
+	void ParserTokenReader::ClearTokenLog()
+	{
+		m_vTokenLog.clear();
+		m_vTokenTail.clear();
+		m_nTokenLogPos = 0;
+		m_nTokenTailPos = 0;
+		m_nTokenLogVersion = (m_pParser) ? m_pParser->m_nSymbolVersion : 0;
+		m_nTokenLogLocale = ParserBase::s_nLocaleVersion;
+	}
+
+
+	/** \brief Returns true if the recorded tokens were read with the current symbols and locale.
+
+		The locale is shared by all parsers, it may have been changed by another parser.
+	*/
+	bool ParserTokenReader::IsTokenLogValid() const
+	{
+		return m_nTokenLogVersion == m_pParser->m_nSymbolVersion && m_nTokenLogLocale == ParserBase::s_nLocaleVersion;
+	}
+
+
+	/** \brief Return a recorded token and restore the reader state after it. */
+	ParserTokenReader::token_type ParserTokenReader::ReplayToken(const STokenLogEntry& a_Entry)
+	{
+		m_iPos = a_Entry.iEnd;
+		m_iSynFlags = a_Entry.iSynFlags;
+
+		while ((int)m_bracketStack.size() > a_Entry.nBrackets)
+			m_bracketStack.pop();
+
+		while ((int)m_bracketStack.size() < a_Entry.nBrackets)
+			m_bracketStack.push(cmBO);
+
+		if (a_Entry.Tok.GetCode() == cmVAR)
+			m_UsedVar[a_Entry.Tok.GetAsString()] = (value_type*)a_Entry.Tok.GetVar();
+
+		return SaveBeforeReturn(a_Entry.Tok);
+	}
+
+
 	/** \brief Set Flag that controls behaviour in case of undefined variables being found.
 
 	  If true, the parser does not throw an exception if an undefined variable is found.
@@ -253,9 +412,14 @@ namespace mu
 	{
 		m_iPos = 0;
 		m_iSynFlags = sfSTART_OF_LINE;
-		m_bracketStack = std::stack<int>();
+		while (!m_bracketStack.empty())
+			m_bracketStack.pop();
+
 		m_UsedVar.clear();
 		m_lastTok = token_type();
+		m_szExtractCharSet = nullptr;
+		m_nTokenLogPos = 0;
+		m_nTokenTailPos = 0;
 	}
 
 
@@ -264,9 +428,65 @@ namespace mu
 	{
 		MUP_ASSERT(m_pParser != nullptr);
 
+		// Undefined variables are accepted when collecting the used variables, such tokens must not be recorded
+		if (!m_bTokenLog || m_bIgnoreUndefVar)
+			return LexNextToken();
+
+		if (!IsTokenLogValid())
+			ClearTokenLog();
+
+		if (m_nTokenLogPos < m_vTokenLog.size())
+			return ReplayToken(m_vTokenLog[m_nTokenLogPos++]);
+
+		STokenLogEntry entry;
+		entry.iBegin = m_iPos;
+		entry.iSynFlagsBefore = m_iSynFlags;
+		entry.nBracketsBefore = (int)m_bracketStack.size();
+		entry.eLastCodeBefore = m_lastTok.GetCode();
+		entry.Tok = LexNextToken();
+		entry.iEnd = m_iPos;
+		entry.iSynFlags = m_iSynFlags;
+		entry.nBrackets = (int)m_bracketStack.size();
+
+		m_vTokenLog.push_back(entry);
+		m_nTokenLogPos = m_vTokenLog.size();
+
+		// Once the reader arrives at an unchanged token behind the edit in the state it had when
+		// the token was read originally, the rest of the formula yields the recorded tokens again.
+		while (m_nTokenTailPos < m_vTokenTail.size() && m_vTokenTail[m_nTokenTailPos].iBegin < m_iPos)
+			++m_nTokenTailPos;
+
+		if (m_nTokenTailPos < m_vTokenTail.size())
+		{
+			const STokenLogEntry& next = m_vTokenTail[m_nTokenTailPos];
+			if (next.iBegin == m_iPos &&
+				next.iSynFlagsBefore == m_iSynFlags &&
+				next.nBracketsBefore == (int)m_bracketStack.size() &&
+				next.eLastCodeBefore == entry.Tok.GetCode())
+			{
+				m_vTokenLog.insert(m_vTokenLog.end(), m_vTokenTail.begin() + m_nTokenTailPos, m_vTokenTail.end());
+				m_vTokenTail.clear();
+				m_nTokenTailPos = 0;
+			}
+		}
+
+		return entry.Tok;
+	}
+
+
+	/** \brief Read the next token from the formula string.
+
+		\throw ParserException if the token can not be identified or is not allowed at its position.
+	*/
+	ParserTokenReader::token_type ParserTokenReader::LexNextToken()
+	{
 		const char_type* szExpr = m_strFormula.c_str();
 		token_type tok;
 
+		UpdateOprtTrie();
+		if (m_bSymbolIndex)
+			UpdateSymbolIndex();
+
 		// Ignore all non printable characters when reading the expression
 		while (szExpr[m_iPos] > 0 && szExpr[m_iPos] <= 0x20)
 		{
@@ -356,6 +576,109 @@ namespace mu
 		m_pVarDef = &a_pParent->m_VarDef;
 		m_pStrVarDef = &a_pParent->m_StrVarDef;
 		m_pConstDef = &a_pParent->m_ConstDef;
+		m_bSymbolIndexValid = false;
+		m_bOprtTrieValid = false;
+	}
+
+
+	/** \brief Enable or disable hash indices for function, constant and variable lookups.
+
+		By default identifiers are looked up in the ordered symbol maps of the parser. With 
+		many thousand symbols the tree walks dominate the tokenization. The indices are 
+		rebuilt lazily when the symbol version of the parser changed.
+	*/
+	void ParserTokenReader::EnableSymbolIndex(bool bEnable)
+	{
+		m_bSymbolIndex = bEnable;
+		m_bSymbolIndexValid = false;
+
+		if (!bEnable)
+		{
+			m_FunIdx.Clear();
+			m_ConstIdx.Clear();
+			m_VarIdx.Clear();
+			m_StrVarIdx.Clear();
+		}
+	}
+
+
+	/** \brief Use the given memory resource for the bracket stack and the token log.
+
+		The recorded tokens are discarded.
+	*/
+	void ParserTokenReader::SetMemoryResource(ParserMemoryResource* a_pResource)
+	{
+		ParserAllocator<int> alloc(a_pResource);
+		m_bracketStack = bracketstack_type(bracketstack_type::container_type(alloc));
+		m_vTokenLog = tokenlog_type(alloc);
+		m_vTokenTail = tokenlog_type(alloc);
+		ClearTokenLog();
+	}
+
+
+	/** \brief Returns an estimate of the memory held by the token reader in bytes.
+
+		Includes the reader object, the formula, the variables used by the formula, the 
+		symbol indices, the operator tries and the recorded tokens. The symbol maps belong 
+		to the parent parser and are not included.
+	*/
+	std::size_t ParserTokenReader::GetMemoryUsage() const
+	{
+		std::size_t nBytes = sizeof(ParserTokenReader) 
+			+ GetHeapSize(m_strFormula)
+			+ GetMapHeapSize(m_UsedVar)
+			+ m_FunIdx.GetMemoryUsage()
+			+ m_ConstIdx.GetMemoryUsage()
+			+ m_VarIdx.GetMemoryUsage()
+			+ m_StrVarIdx.GetMemoryUsage()
+			+ m_OprtTrie.GetMemoryUsage()
+			+ m_InfixOprtTrie.GetMemoryUsage()
+			+ m_PostOprtTrie.GetMemoryUsage()
+			+ (m_vTokenLog.capacity() + m_vTokenTail.capacity()) * sizeof(STokenLogEntry)
+			+ m_bracketStack.size() * sizeof(int);
+
+		for (const auto& item : m_vIdentFun)
+			nBytes += sizeof(SValIdent) + 2 * sizeof(void*) + GetHeapSize(item.sFirstChars);
+
+		return nBytes;
+	}
+
+
+	/** \brief Rebuild the symbol indices if the symbol maps were changed since they were built. 
+	
+		Every change of the symbol maps goes through the parent parser which increments 
+		its symbol version. The only exception are variables created by the variable 
+		factory, these are added to the index directly.
+	*/
+	void ParserTokenReader::UpdateSymbolIndex()
+	{
+		if (m_bSymbolIndexValid && m_nSymbolIndexVersion == m_pParser->m_nSymbolVersion && m_nSymbolIndexLocale == ParserBase::s_nLocaleVersion)
+			return;
+
+		m_FunIdx.Build(*m_pFunDef);
+		m_ConstIdx.Build(*m_pConstDef);
+		m_VarIdx.Build(*m_pVarDef);
+		m_StrVarIdx.Build(*m_pStrVarDef);
+		m_nSymbolIndexVersion = m_pParser->m_nSymbolVersion;
+		m_nSymbolIndexLocale = ParserBase::s_nLocaleVersion;
+		m_bSymbolIndexValid = true;
+	}
+
+
+	/** \brief Rebuild the tries of the binary, infix and postfix operators if the operator 
+				definitions may have changed since they were built.
+	*/
+	void ParserTokenReader::UpdateOprtTrie()
+	{
+		if (m_bOprtTrieValid && m_nOprtTrieVersion == m_pParser->m_nSymbolVersion && m_nOprtTrieLocale == ParserBase::s_nLocaleVersion)
+			return;
+
+		m_OprtTrie.Build(*m_pOprtDef);
+		m_InfixOprtTrie.Build(*m_pInfixOprtDef);
+		m_PostOprtTrie.Build(*m_pPostOprtDef);
+		m_nOprtTrieVersion = m_pParser->m_nSymbolVersion;
+		m_nOprtTrieLocale = ParserBase::s_nLocaleVersion;
+		m_bOprtTrieValid = true;
 	}
 
 
@@ -369,16 +692,24 @@ namespace mu
 	*/
 	int ParserTokenReader::ExtractToken(const char_type* a_szCharSet, string_type& a_sTok, std::size_t a_iPos) const
 	{
-		auto iEnd = m_strFormula.find_first_not_of(a_szCharSet, a_iPos);
+		// The identifier at a position is requested by several token checks in a row,
+		// scan the formula only once per position and charset.
+		if (a_szCharSet != m_szExtractCharSet || a_iPos != m_iExtractPos)
+		{
+			auto iEnd = m_strFormula.find_first_not_of(a_szCharSet, a_iPos);
+			if (iEnd == string_type::npos)
+				iEnd = m_strFormula.length();
 
-		if (iEnd == string_type::npos)
-			iEnd = m_strFormula.length();
+			m_szExtractCharSet = a_szCharSet;
+			m_iExtractPos = a_iPos;
+			m_iExtractEnd = iEnd;
+		}
 
 		// Assign token string if there was something found
-		if (a_iPos != iEnd)
-			a_sTok = string_type(m_strFormula.begin() + a_iPos, m_strFormula.begin() + iEnd);
+		if (a_iPos != m_iExtractEnd)
+			a_sTok.assign(m_strFormula, a_iPos, m_iExtractEnd - a_iPos);
 
-		return static_cast<int>(iEnd);
+		return static_cast<int>(m_iExtractEnd);
 	}
 
 
@@ -424,8 +755,9 @@ namespace mu
 		// check string for operator/function
 		for (int i = 0; pOprtDef[i]; i++)
 		{
+			// compare in place without creating temporary strings
 			std::size_t len(std::char_traits<char_type>::length(pOprtDef[i]));
-			if (string_type(pOprtDef[i]) == string_type(szFormula + m_iPos, szFormula + m_iPos + len))
+			if (m_strFormula.length() - m_iPos >= len && std::char_traits<char_type>::compare(pOprtDef[i], szFormula + m_iPos, len) == 0)
 			{
 				switch (i)
 				{
@@ -577,24 +909,19 @@ namespace mu
 		if (iEnd == m_iPos)
 			return false;
 
-		// iterate over all postfix operator strings
-		funmap_type::const_reverse_iterator it = m_pInfixOprtDef->rbegin();
-		for (; it != m_pInfixOprtDef->rend(); ++it)
-		{
-			if (sTok.find(it->first) != 0)
-				continue;
-
-			a_Tok.Set(it->second, it->first);
-			m_iPos += (int)it->first.length();
+		// find the longest infix operator the token starts with
+		funmap_type::const_iterator it;
+		if (m_InfixOprtTrie.Match(sTok.c_str(), sTok.length(), it) == 0)
+			return false;
 
-			if (m_iSynFlags & noINFIXOP)
-				Error(ecUNEXPECTED_OPERATOR, m_iPos, a_Tok.GetAsString());
+		a_Tok.Set(it->second, it->first);
+		m_iPos += (int)it->first.length();
 
-			m_iSynFlags = noPOSTOP | noINFIXOP | noOPT | noBC | noSTR | noASSIGN | noARG_SEP;
-			return true;
-		}
+		if (m_iSynFlags & noINFIXOP)
+			Error(ecUNEXPECTED_OPERATOR, m_iPos, a_Tok.GetAsString());
 
-		return false;
+		m_iSynFlags = noPOSTOP | noINFIXOP | noOPT | noBC | noSTR | noASSIGN | noARG_SEP;
+		return true;
 
 		/*
 			a_Tok.Set(item->second, sTok);
@@ -622,9 +949,18 @@ namespace mu
 		if (iEnd == m_iPos)
 			return false;
 
-		funmap_type::const_iterator item = m_pFunDef->find(strTok);
-		if (item == m_pFunDef->end())
-			return false;
+		funmap_type::const_iterator item;
+		if (m_bSymbolIndex)
+		{
+			if (!m_FunIdx.Find(strTok, item))
+				return false;
+		}
+		else
+		{
+			item = m_pFunDef->find(strTok);
+			if (item == m_pFunDef->end())
+				return false;
+		}
 
 		// Check if the next sign is an opening bracket
 		const char_type* szFormula = m_strFormula.c_str();
@@ -659,49 +995,43 @@ namespace mu
 		const char_type** const pOprtDef = m_pParser->GetOprtDef();
 		for (int i = 0; m_pParser->HasBuiltInOprt() && pOprtDef[i]; ++i)
 		{
-			if (string_type(pOprtDef[i]) == strTok)
+			if (strTok == pOprtDef[i])
 				return false;
 		}
 
 		// Note:
-		// All tokens in oprt_bin_maptype are have been sorted by their length
-		// Long operators must come first! Otherwise short names (like: "add") that
+		// Long operators must take precedence! Otherwise short names (like: "add") that
 		// are part of long token names (like: "add123") will be found instead 
-		// of the long ones.
-		// Length sorting is done with ascending length so we use a reverse iterator here.
-		funmap_type::const_reverse_iterator it = m_pOprtDef->rbegin();
-		for (; it != m_pOprtDef->rend(); ++it)
-		{
-			const string_type& sID = it->first;
-			if (sID == string_type(szExpr + m_iPos, szExpr + m_iPos + sID.length()))
-			{
-				a_Tok.Set(it->second, strTok);
-
-				// operator was found
-				if (m_iSynFlags & noOPT)
-				{
-					// An operator was found but is not expected to occur at
-					// this position of the formula, maybe it is an infix 
-					// operator, not a binary operator. Both operator types
-					// can share characters in their identifiers.
-					if (IsInfixOpTok(a_Tok))
-						return true;
-					else
-					{
-						// nope, no infix operator
-						return false;
-						//Error(ecUNEXPECTED_OPERATOR, m_iPos, a_Tok.GetAsString()); 
-					}
+		// of the long ones. The trie returns the longest operator name at the current 
+		// position.
+		funmap_type::const_iterator it;
+		std::size_t nLen = m_OprtTrie.Match(szExpr + m_iPos, m_strFormula.length() - (std::size_t)m_iPos, it);
+		if (nLen == 0)
+			return false;
 
-				}
+		a_Tok.Set(it->second, strTok);
 
-				m_iPos += (int)sID.length();
-				m_iSynFlags = noBC | noOPT | noARG_SEP | noPOSTOP | noEND | noASSIGN;
+		// operator was found
+		if (m_iSynFlags & noOPT)
+		{
+			// An operator was found but is not expected to occur at
+			// this position of the formula, maybe it is an infix 
+			// operator, not a binary operator. Both operator types
+			// can share characters in their identifiers.
+			if (IsInfixOpTok(a_Tok))
 				return true;
+			else
+			{
+				// nope, no infix operator
+				return false;
+				//Error(ecUNEXPECTED_OPERATOR, m_iPos, a_Tok.GetAsString()); 
 			}
+
 		}
 
-		return false;
+		m_iPos += (int)nLen;
+		m_iSynFlags = noBC | noOPT | noARG_SEP | noPOSTOP | noEND | noASSIGN;
+		return true;
 	}
 
 
@@ -733,21 +1063,16 @@ namespace mu
 		if (iEnd == m_iPos)
 			return false;
 
-		// iterate over all postfix operator strings
-		funmap_type::const_reverse_iterator it = m_pPostOprtDef->rbegin();
-		for (; it != m_pPostOprtDef->rend(); ++it)
-		{
-			if (sTok.find(it->first) != 0)
-				continue;
-
-			a_Tok.Set(it->second, sTok);
-			m_iPos += (int)it->first.length();
+		// find the longest postfix operator the token starts with
+		funmap_type::const_iterator it;
+		if (m_PostOprtTrie.Match(sTok.c_str(), sTok.length(), it) == 0)
+			return false;
 
-			m_iSynFlags = noVAL | noVAR | noFUN | noBO | noPOSTOP | noSTR | noASSIGN;
-			return true;
-		}
+		a_Tok.Set(it->second, sTok);
+		m_iPos += (int)it->first.length();
 
-		return false;
+		m_iSynFlags = noVAL | noVAR | noFUN | noBO | noPOSTOP | noSTR | noASSIGN;
+		return true;
 	}
 
 
@@ -771,8 +1096,9 @@ namespace mu
 		auto iEnd = ExtractToken(m_pParser->ValidNameChars(), strTok, (std::size_t)m_iPos);
 		if (iEnd != m_iPos)
 		{
-			valmap_type::const_iterator item = m_pConstDef->find(strTok);
-			if (item != m_pConstDef->end())
+			valmap_type::const_iterator item;
+			bool bFound = (m_bSymbolIndex) ? m_ConstIdx.Find(strTok, item) : (item = m_pConstDef->find(strTok)) != m_pConstDef->end();
+			if (bFound)
 			{
 				m_iPos = iEnd;
 				a_Tok.SetVal(item->second, strTok);
@@ -787,11 +1113,16 @@ namespace mu
 
 		// 3.call the value recognition functions provided by the user
 		// Call user defined value recognition functions
-		std::list<identfun_type>::const_iterator item = m_vIdentFun.begin();
+		const char_type cFirst = m_strFormula[m_iPos];
+		std::list<SValIdent>::const_iterator item = m_vIdentFun.begin();
 		for (item = m_vIdentFun.begin(); item != m_vIdentFun.end(); ++item)
 		{
+			// First character dispatch: skip callbacks that can not detect a value here
+			if (!item->sFirstChars.empty() && item->sFirstChars.find(cFirst) == string_type::npos)
+				continue;
+
 			int iStart = m_iPos;
-			if ((*item)(m_strFormula.c_str() + m_iPos, &m_iPos, &fVal) == 1)
+			if ((item->pFun)(m_strFormula.c_str() + m_iPos, &m_iPos, &fVal) == 1)
 			{
 				// 2013-11-27 Issue 2:  https://code.google.com/p/muparser/issues/detail?id=2
 				strTok.assign(m_strFormula.c_str(), iStart, (std::size_t)m_iPos - iStart);
@@ -823,14 +1154,24 @@ namespace mu
 		if (iEnd == m_iPos)
 			return false;
 
-		varmap_type::const_iterator item = m_pVarDef->find(strTok);
-		if (item == m_pVarDef->end())
-			return false;
+		varmap_type::const_iterator item;
+		if (m_bSymbolIndex)
+		{
+			if (!m_VarIdx.Find(strTok, item))
+				return false;
+		}
+		else
+		{
+			item = m_pVarDef->find(strTok);
+			if (item == m_pVarDef->end())
+				return false;
+		}
 
 		if (m_iSynFlags & noVAR)
 			Error(ecUNEXPECTED_VAR, m_iPos, strTok);
 
 		m_pParser->OnDetectVar(&m_strFormula, m_iPos, iEnd);
+		m_szExtractCharSet = nullptr;  // the formula may have been changed
 
 		m_iPos = iEnd;
 		a_Tok.SetVar(item->second, strTok);
@@ -854,18 +1195,28 @@ namespace mu
 		if (iEnd == m_iPos)
 			return false;
 
-		strmap_type::const_iterator item = m_pStrVarDef->find(strTok);
-		if (item == m_pStrVarDef->end())
-			return false;
+		strmap_type::const_iterator item;
+		if (m_bSymbolIndex)
+		{
+			if (!m_StrVarIdx.Find(strTok, item))
+				return false;
+		}
+		else
+		{
+			item = m_pStrVarDef->find(strTok);
+			if (item == m_pStrVarDef->end())
+				return false;
+		}
 
 		if (m_iSynFlags & noSTR)
 			Error(ecUNEXPECTED_VAR, m_iPos, strTok);
 
 		m_iPos = iEnd;
-		if (!m_pParser->m_vStringVarBuf.size())
+		const auto& vStringVarBuf = *m_pParser->m_pStringVarBuf;
+		if (!vStringVarBuf.size())
 			Error(ecINTERNAL_ERROR);
 
-		a_Tok.SetString(m_pParser->m_vStringVarBuf[item->second], m_pParser->m_vStringVarBuf.size());
+		a_Tok.SetString(vStringVarBuf[item->second], vStringVarBuf.size());
 
 		m_iSynFlags = noANY ^ (noBC | noOPT | noEND | noARG_SEP);
 		return true;
@@ -907,8 +1258,19 @@ namespace mu
 			// from the list
 			// This is safe because the new variable can never override an existing one
 			// because they are checked first!
+			// Adding the variable copies the map if it is shared with a copy or a clone 
+			// of the parser, the index then references the old map and must be rebuilt.
+			const bool bShared = m_pVarDef->IsShared();
 			(*m_pVarDef)[strTok] = fVar;
 			m_UsedVar[strTok] = fVar;  // Add variable to used-var-list
+
+			if (m_bSymbolIndex)
+			{
+				if (bShared)
+					m_bSymbolIndexValid = false;
+				else
+					m_VarIdx.Insert(m_pVarDef->find(strTok));
+			}
 		}
 		else
 		{
@@ -955,8 +1317,8 @@ namespace mu
 		if (m_iSynFlags & noSTR)
 			Error(ecUNEXPECTED_STR, m_iPos, strTok);
 
-		m_pParser->m_vStringBuf.push_back(strTok); // Store string in internal buffer
-		a_Tok.SetString(strTok, m_pParser->m_vStringBuf.size());
+		// The string is interned into the string pool of the parser when the bytecode is created
+		a_Tok.SetString(strTok, 0);
 
 		m_iPos += (int)strTok.length() + 2 + (int)iSkip;  // +2 for quotes; +iSkip for escape characters 
 		m_iSynFlags = noANY ^ (noARG_SEP | noBC | noOPT | noEND);
@@ -0,0 +1,144 @@
+/*
+	Checks that evaluating a compiled expression does not allocate heap memory.
+
+	The global operator new is replaced by a version counting the allocations, so this
+	test must live in its own executable.
+*/
+
+#include "muParser.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	std::atomic<long> g_nAlloc(0);
+
+	void* CountedAlloc(std::size_t a_nSize)
+	{
+		++g_nAlloc;
+		void* p = std::malloc(a_nSize ? a_nSize : 1);
+		if (p == nullptr)
+			throw std::bad_alloc();
+
+		return p;
+	}
+}
+
+void* operator new(std::size_t a_nSize) { return CountedAlloc(a_nSize); }
+void* operator new[](std::size_t a_nSize) { return CountedAlloc(a_nSize); }
+void* operator new(std::size_t a_nSize, const std::nothrow_t&) noexcept { ++g_nAlloc; return std::malloc(a_nSize ? a_nSize : 1); }
+void* operator new[](std::size_t a_nSize, const std::nothrow_t&) noexcept { ++g_nAlloc; return std::malloc(a_nSize ? a_nSize : 1); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace mu;
+
+namespace
+{
+	value_type StrLen(const char_type* a_szMsg)
+	{
+		int nLen = 0;
+		while (a_szMsg[nLen])
+			++nLen;
+
+		return (value_type)nLen;
+	}
+
+	/** \brief Evaluate an expression repeatedly and return the number of heap allocations. */
+	template<typename TEval>
+	long CountAllocs(TEval a_Eval)
+	{
+		// The first calls compile the expression and warm up the thread pool of the OpenMP runtime
+		a_Eval();
+		a_Eval();
+
+		long nBefore = g_nAlloc.load();
+		for (int i = 0; i < 100; ++i)
+			a_Eval();
+
+		return g_nAlloc.load() - nBefore;
+	}
+
+	int Check(const char_type* a_szName, long a_nAlloc)
+	{
+		if (a_nAlloc == 0)
+			return 0;
+
+		mu::console() << _T("  ") << a_szName << _T(": ") << a_nAlloc << _T(" heap allocations") << std::endl;
+		return 1;
+	}
+}
+
+int main(int, char**)
+{
+	mu::console() << _T("testing allocation free evaluation...");
+
+	int iStat = 0;
+	try
+	{
+		const int nBulk = 100;
+		std::vector<value_type> vA(nBulk, 1), vB(nBulk, 2), vRes(3 * nBulk);
+		value_type* vCol[3] = { &vRes[0], &vRes[nBulk], &vRes[2 * nBulk] };
+		value_type a = 1, b = 2;
+
+		Parser p;
+		p.DefineVar(_T("a"), &a);
+		p.DefineVar(_T("b"), &b);
+		p.DefineFun(_T("strlen"), StrLen);
+
+		p.SetExpr(_T("sin(a)*b + (a<b ? sum(a,b,3) : 0) + strlen(\"abc\")"));
+		iStat += Check(_T("Eval()"), CountAllocs([&]() { p.Eval(); }));
+
+		p.SetExpr(_T("a"));
+		p.Compile();
+		iStat += Check(_T("Eval() of a short expression"), CountAllocs([&]() { p.Eval(); }));
+
+		p.SetExpr(_T("a+b, a*b, b=a+1"));
+		int nNum = 0;
+		iStat += Check(_T("Eval(int&)"), CountAllocs([&]() { p.Eval(nNum); }));
+
+		// bulk mode, variables bound to arrays
+		Parser pb;
+		pb.DefineVar(_T("a"), &vA[0]);
+		pb.DefineVar(_T("b"), &vB[0]);
+		pb.SetExpr(_T("a*b + sin(a)"));
+		iStat += Check(_T("Eval(results, n)"), CountAllocs([&]() { pb.Eval(&vRes[0], nBulk); }));
+		iStat += Check(_T("Eval(results, n, stride)"), CountAllocs([&]() { pb.Eval(&vRes[0], nBulk / 2, 2 * sizeof(value_type)); }));
+
+		pb.SetExpr(_T("a+b, a*b, a-b"));
+		iStat += Check(_T("EvalColumns(columns, n)"), CountAllocs([&]() { pb.EvalColumns(vCol, nBulk); }));
+
+		// clones and loaded bytecode
+		p.SetExpr(_T("a*b+1"));
+		std::unique_ptr<ParserBase> pClone = p.Clone();
+		iStat += Check(_T("Eval() of a clone"), CountAllocs([&]() { pClone->Eval(); }));
+
+		std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+		p.SaveByteCode(ss);
+		Parser pl;
+		pl.DefineVar(_T("a"), &a);
+		pl.DefineVar(_T("b"), &b);
+		pl.LoadByteCode(ss);
+		iStat += Check(_T("Eval() of loaded bytecode"), CountAllocs([&]() { pl.Eval(); }));
+	}
+	catch (ParserError& e)
+	{
+		mu::console() << _T("\n  unexpected error: ") << e.GetMsg() << std::endl;
+		iStat += 1;
+	}
+
+	if (iStat == 0)
+		mu::console() << _T("passed") << std::endl;
+	else
+		mu::console() << _T("\n  failed with ") << iStat << _T(" errors") << std::endl;
+
+	return iStat;
+}